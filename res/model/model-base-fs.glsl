@@ -8,6 +8,7 @@ uniform vec3 diffuseColor;
 uniform sampler2D diffuseTexture;
 uniform bool wireframeEnabled;
 uniform vec4 wireframeLineColor;
+uniform uint materialIndex;
 
 in fragmentData
 {
@@ -17,7 +18,10 @@ in fragmentData
 	noperspective vec3 edgeDistance;
 } fragment;
 
-out vec4 fragColor;
+// the surface attributes are only kept when drawing into the G-buffer, see GBuffer
+layout(location = 0) out vec4 fragColor;
+layout(location = 1) out vec4 fragNormal;
+layout(location = 2) out uint fragMaterial;
 
 void main()
 {
@@ -31,4 +35,6 @@ void main()
 	}
 
 	fragColor = result;
+	fragNormal = vec4(fragment.normal, 0.0);
+	fragMaterial = materialIndex;
 }
\ No newline at end of file
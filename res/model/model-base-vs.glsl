@@ -4,6 +4,11 @@
 
 uniform mat4 modelViewProjectionMatrix;
 
+// packed vertices store positions relative to the model bounds and octahedral normals in the first two components
+uniform bool packedVertices;
+uniform vec3 positionOffset;
+uniform vec3 positionScale;
+
 layout (location = 0) in vec3 position;
 layout (location = 1) in vec3 normal;
 layout (location = 2) in vec2 texCoord;
@@ -15,13 +20,26 @@ out vertexData
 	vec2 texCoord;
 } vertex;
 
+vec3 decodeOctahedral(vec2 e)
+{
+	vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+
+	if (n.z < 0.0)
+		n.xy = (1.0 - abs(n.yx)) * mix(vec2(-1.0), vec2(1.0), greaterThanEqual(n.xy, vec2(0.0)));
+
+	return normalize(n);
+}
+
 void main()
 {
-	vec4 pos = modelViewProjectionMatrix*vec4(position,1.0);
+	vec3 objectPosition = packedVertices ? positionOffset + position * positionScale : position;
+	vec3 objectNormal = packedVertices ? decodeOctahedral(normal.xy) : normal;
+
+	vec4 pos = modelViewProjectionMatrix*vec4(objectPosition,1.0);
 
-	vertex.position = position; 
-	vertex.normal = normal;
+	vertex.position = objectPosition; 
+	vertex.normal = objectNormal;
 	vertex.texCoord = texCoord;	
 	
 	gl_Position = pos;
-}
\ No newline at end of file
+}
@@ -0,0 +1,24 @@
+#version 400
+#extension GL_ARB_shading_language_include : require
+#include "/raytrace-globals.glsl"
+
+// sums of the samples with their coverage in alpha, and the depth of the first sample
+uniform sampler2D accumulationTexture;
+uniform sampler2D depthTexture;
+uniform int sampleCount;
+
+in vec2 fragPosition;
+out vec4 fragColor;
+
+void main()
+{
+	ivec2 texel = ivec2(gl_FragCoord.xy);
+	vec4 sum = texelFetch(accumulationTexture, texel, 0);
+
+	if (sum.a == 0.0)
+		discard;
+
+	// pixels that are only partially covered by the model are blended with what is behind them
+	fragColor = vec4(sum.rgb / sum.a, sum.a / float(sampleCount));
+	gl_FragDepth = texelFetch(depthTexture, texel, 0).r;
+}
@@ -5,8 +5,51 @@
 uniform mat4 modelViewProjectionMatrix;
 uniform mat4 inverseModelViewProjectionMatrix;
 
+// image traced on the CPU with one texel per pixel, the depth is already computed like calcDepth() does
+uniform bool cpuBackendEnabled;
+uniform sampler2D colorTexture;
+uniform sampler2D depthTexture;
+
+// hierarchy of the model with four texels per node and three per triangle, see Model::bvhNodeTexture()
+uniform bool bvhEnabled;
+uniform samplerBuffer bvhNodes;
+uniform samplerBuffer bvhTriangles;
+uniform samplerBuffer materialColors;
+// tests all triangles instead of traversing the hierarchy, for comparison and for hierarchies too deep for the stack
+uniform bool bruteForceEnabled;
+uniform int triangleCount;
+uniform vec3 minimumBounds;
+uniform vec3 maximumBounds;
+uniform vec3 worldLightPosition;
+
+// surfaces rasterized by the model renderer, from which only shadow and ambient occlusion rays are traced, see GBuffer
+uniform bool hybridEnabled;
+uniform sampler2D gBufferDepth;
+uniform sampler2D gBufferNormal;
+uniform usampler2D gBufferMaterial;
+uniform bool shadowsEnabled;
+uniform int ambientOcclusionSampleCount;
+// distance up to which occluders count, relative to the diagonal of the model bounds
+uniform float ambientOcclusionRadius;
+// varies the directions of the ambient occlusion rays between accumulated samples
+uniform int sampleIndex;
+
+// offset of the ray within the pixel in normalized device coordinates, and whether the result is a sample added to
+// the accumulation target instead of the final color
+uniform vec2 jitter;
+uniform bool accumulationEnabled;
+uniform bool firstSample;
+
 in vec2 fragPosition;
-out vec4 fragColor;
+layout(location = 0) out vec4 fragColor;
+layout(location = 1) out float sampleDepth;
+
+// nodes waiting for traversal, at most one per level below the root, so Bvh::maximumDepth levels always fit
+#define STACK_SIZE 32
+const float noHit = 3.0e38;
+// distance of the origins of secondary rays from the surface relative to the diagonal of the model bounds, which
+// keeps the imprecision of the reconstructed positions from intersecting the surface itself
+const float rayOffset = 1.0e-3;
 
 float calcDepth(vec3 pos)
 {
@@ -17,23 +60,303 @@ float calcDepth(vec3 pos)
 	return (((far - near) * ndc_depth) + near + far) / 2.0;
 }
 
+// returns the distance at which the ray enters the box, or noHit if it misses the box before the maximum distance
+float intersectBox(vec3 origin, vec3 inverseDirection, vec3 minimum, vec3 maximum, float maximumDistance)
+{
+	vec3 t0 = (minimum - origin) * inverseDirection;
+	vec3 t1 = (maximum - origin) * inverseDirection;
+	vec3 near = min(t0, t1);
+	vec3 far = max(t0, t1);
+	float entry = max(max(near.x, near.y), max(near.z, 0.0));
+	float exit = min(min(far.x, far.y), min(far.z, maximumDistance));
+	return entry <= exit ? entry : noHit;
+}
+
+// keeps the closer hit with the triangle (Moeller and Trumbore)
+void intersectTriangle(vec3 origin, vec3 direction, int triangle, inout float hitDistance, inout int hitTriangle)
+{
+	vec3 position = texelFetch(bvhTriangles, 3 * triangle).xyz;
+	vec3 edge1 = texelFetch(bvhTriangles, 3 * triangle + 1).xyz;
+	vec3 edge2 = texelFetch(bvhTriangles, 3 * triangle + 2).xyz;
+
+	vec3 p = cross(direction, edge2);
+	float determinant = dot(edge1, p);
+
+	if (determinant == 0.0)
+		return;
+
+	float inverseDeterminant = 1.0 / determinant;
+	vec3 s = origin - position;
+	float u = dot(s, p) * inverseDeterminant;
+
+	if (u < 0.0 || u > 1.0)
+		return;
+
+	vec3 q = cross(s, edge1);
+	float v = dot(direction, q) * inverseDeterminant;
+
+	if (v < 0.0 || u + v > 1.0)
+		return;
+
+	float t = dot(edge2, q) * inverseDeterminant;
+
+	if (t > 0.0 && t < hitDistance)
+	{
+		hitDistance = t;
+		hitTriangle = triangle;
+	}
+}
+
+// visits the closer child first and intersects the triangles of leaves as soon as their bounds are hit
+// with anyHit, the traversal stops at the first hit found, which is enough for occlusion tests
+void traverse(vec3 origin, vec3 direction, inout float hitDistance, inout int hitTriangle, bool anyHit)
+{
+	if (bruteForceEnabled)
+	{
+		for (int i = 0; i < triangleCount && !(anyHit && hitTriangle >= 0); i++)
+			intersectTriangle(origin, direction, i, hitDistance, hitTriangle);
+
+		return;
+	}
+
+	// avoids infinite products with zero distances to the slabs, which would result in NaN
+	vec3 inverseDirection = 1.0 / mix(direction, vec3(1e-20), lessThan(abs(direction), vec3(1e-20)));
+
+	if (intersectBox(origin, inverseDirection, minimumBounds, maximumBounds, hitDistance) == noHit)
+		return;
+
+	int stack[STACK_SIZE];
+	int stackSize = 0;
+	int node = 0;
+
+	while (node >= 0)
+	{
+		vec4 firstMinimum = texelFetch(bvhNodes, 4 * node);
+		vec4 firstMaximum = texelFetch(bvhNodes, 4 * node + 1);
+		vec4 secondMinimum = texelFetch(bvhNodes, 4 * node + 2);
+		vec4 secondMaximum = texelFetch(bvhNodes, 4 * node + 3);
+
+		int firstOffset = int(floatBitsToUint(firstMinimum.w));
+		int firstCount = int(floatBitsToUint(firstMaximum.w));
+		int secondOffset = int(floatBitsToUint(secondMinimum.w));
+		int secondCount = int(floatBitsToUint(secondMaximum.w));
+
+		float firstEntry = intersectBox(origin, inverseDirection, firstMinimum.xyz, firstMaximum.xyz, hitDistance);
+		float secondEntry = intersectBox(origin, inverseDirection, secondMinimum.xyz, secondMaximum.xyz, hitDistance);
+
+		if (firstEntry != noHit && firstCount > 0)
+		{
+			for (int i = firstOffset; i < firstOffset + firstCount; i++)
+				intersectTriangle(origin, direction, i, hitDistance, hitTriangle);
+
+			firstEntry = noHit;
+		}
+
+		if (secondEntry != noHit && secondCount > 0)
+		{
+			for (int i = secondOffset; i < secondOffset + secondCount; i++)
+				intersectTriangle(origin, direction, i, hitDistance, hitTriangle);
+
+			secondEntry = noHit;
+		}
+
+		if (anyHit && hitTriangle >= 0)
+			return;
+
+		if (firstEntry != noHit && secondEntry != noHit)
+		{
+			bool secondCloser = secondEntry < firstEntry;
+			node = secondCloser ? secondOffset : firstOffset;
+
+			stack[stackSize++] = secondCloser ? firstOffset : secondOffset;
+		}
+		else if (firstEntry != noHit)
+		{
+			node = firstOffset;
+		}
+		else if (secondEntry != noHit)
+		{
+			node = secondOffset;
+		}
+		else
+		{
+			// nodes behind the closest hit are rejected with the bounds of their children
+			node = stackSize > 0 ? stack[--stackSize] : -1;
+		}
+	}
+}
+
+uint hash(uint x)
+{
+	x ^= x >> 16;
+	x *= 0x7feb352du;
+	x ^= x >> 15;
+	x *= 0x846ca68bu;
+	x ^= x >> 16;
+	return x;
+}
+
+// uniformly distributed in [0, 1)
+float random(inout uint state)
+{
+	state = hash(state);
+	return float(state >> 8) * (1.0 / 16777216.0);
+}
+
+void writeResult(vec4 color, float depth)
+{
+	if (accumulationEnabled)
+	{
+		// hits add their color with a coverage of one, only the first sample keeps its depth
+		fragColor = depth < 1.0 ? vec4(color.rgb, 1.0) : vec4(0.0);
+		sampleDepth = firstSample ? depth : 0.0;
+	}
+	else
+	{
+		fragColor = color;
+	}
+
+	gl_FragDepth = depth;
+}
+
+// lights a rasterized surface where the shadow ray reaches the light, and the ambient part by the fraction of rays
+// leaving the surface without hitting anything within the occlusion radius
+vec4 shadeSurface(ivec2 texel, float depth)
+{
+	float far = gl_DepthRange.far;
+	float near = gl_DepthRange.near;
+	float ndcDepth = (2.0 * depth - near - far) / (far - near);
+
+	vec4 position = inverseModelViewProjectionMatrix*vec4(fragPosition,ndcDepth,1.0);
+	position /= position.w;
+
+	vec4 nearPosition = inverseModelViewProjectionMatrix*vec4(fragPosition,-1.0,1.0);
+	nearPosition /= nearPosition.w;
+
+	vec3 viewDirection = normalize(position.xyz - nearPosition.xyz);
+
+	// models without normals are lit as if facing the camera
+	vec3 normal = texelFetch(gBufferNormal, texel, 0).xyz;
+	normal = dot(normal, normal) > 0.0 ? normalize(normal) : -viewDirection;
+
+	// both sides of a surface are lit
+	if (dot(normal, viewDirection) > 0.0)
+		normal = -normal;
+
+	float extent = length(maximumBounds - minimumBounds);
+	vec3 origin = position.xyz + rayOffset * extent * normal;
+
+	vec3 lightVector = worldLightPosition - origin;
+	float lightDistance = length(lightVector);
+	vec3 lightDirection = lightVector / lightDistance;
+	float diffuseLight = max(dot(normal, lightDirection), 0.0);
+
+	// surfaces facing away from the light are dark anyway
+	if (shadowsEnabled && diffuseLight > 0.0)
+	{
+		float hitDistance = lightDistance;
+		int hitTriangle = -1;
+		traverse(origin, lightDirection, hitDistance, hitTriangle, true);
+
+		if (hitTriangle >= 0)
+			diffuseLight = 0.0;
+	}
+
+	float ambientLight = 1.0;
+
+	if (ambientOcclusionSampleCount > 0)
+	{
+		// orthonormal basis around the normal without branches (Duff et al.)
+		float s = normal.z >= 0.0 ? 1.0 : -1.0;
+		float a = -1.0 / (s + normal.z);
+		float b = normal.x * normal.y * a;
+		vec3 tangent = vec3(1.0 + s * normal.x * normal.x * a, s * b, -s * normal.x);
+		vec3 bitangent = vec3(b, s + normal.y * normal.y * a, -normal.y);
+
+		uint state = hash(uint(texel.x) ^ hash(uint(texel.y) ^ hash(uint(sampleIndex))));
+		int occludedCount = 0;
+
+		for (int i = 0; i < ambientOcclusionSampleCount; i++)
+		{
+			// cosine weighted directions, so that every unoccluded ray contributes the same amount of light
+			float radius = sqrt(random(state));
+			float angle = 6.2831853 * random(state);
+			vec2 disk = radius * vec2(cos(angle), sin(angle));
+			vec3 direction = normalize(disk.x * tangent + disk.y * bitangent + sqrt(max(1.0 - radius * radius, 0.0)) * normal);
+
+			float hitDistance = ambientOcclusionRadius * extent;
+			int hitTriangle = -1;
+			traverse(origin, direction, hitDistance, hitTriangle, true);
+
+			if (hitTriangle >= 0)
+				occludedCount++;
+		}
+
+		ambientLight = 1.0 - float(occludedCount) / float(ambientOcclusionSampleCount);
+	}
+
+	vec3 diffuse = texelFetch(materialColors, int(texelFetch(gBufferMaterial, texel, 0).r)).rgb;
+	return vec4(diffuse * (0.2 * ambientLight + 0.8 * diffuseLight), 1.0);
+}
+
 void main()
 {
-	vec4 near = inverseModelViewProjectionMatrix*vec4(fragPosition,-1.0,1.0);
+	if (cpuBackendEnabled)
+	{
+		ivec2 texel = ivec2(gl_FragCoord.xy);
+		writeResult(texelFetch(colorTexture, texel, 0), texelFetch(depthTexture, texel, 0).r);
+		return;
+	}
+
+	// the primary visibility was rasterized at the pixel centers, so there is no jitter
+	if (hybridEnabled)
+	{
+		ivec2 texel = ivec2(gl_FragCoord.xy);
+		float depth = texelFetch(gBufferDepth, texel, 0).r;
+		writeResult(depth < 1.0 ? shadeSurface(texel, depth) : vec4(1.0), depth);
+		return;
+	}
+
+	vec2 samplePosition = fragPosition + jitter;
+
+	vec4 near = inverseModelViewProjectionMatrix*vec4(samplePosition,-1.0,1.0);
 	near /= near.w;
 
-	vec4 far = inverseModelViewProjectionMatrix*vec4(fragPosition,1.0,1.0);
+	vec4 far = inverseModelViewProjectionMatrix*vec4(samplePosition,1.0,1.0);
 	far /= far.w;
 
 	// this is the setup for our viewing ray
 	vec3 rayOrigin = near.xyz;
 	vec3 rayDirection = normalize((far-near).xyz);
 
-	fragColor = vec4(1.0);
+	if (bvhEnabled)
+	{
+		float hitDistance = noHit;
+		int hitTriangle = -1;
+
+		traverse(rayOrigin, rayDirection, hitDistance, hitTriangle, false);
+
+		if (hitTriangle >= 0)
+		{
+			vec3 position = rayOrigin + hitDistance * rayDirection;
+			vec4 edge1 = texelFetch(bvhTriangles, 3 * hitTriangle + 1);
+			vec3 edge2 = texelFetch(bvhTriangles, 3 * hitTriangle + 2).xyz;
+			vec3 normal = normalize(cross(edge1.xyz, edge2));
+
+			// both sides of a triangle are lit
+			if (dot(normal, rayDirection) > 0.0)
+				normal = -normal;
+
+			vec3 diffuse = texelFetch(materialColors, int(floatBitsToUint(edge1.w))).rgb;
+			vec3 lightDirection = normalize(worldLightPosition - position);
+			writeResult(vec4(diffuse * (0.2 + 0.8 * max(dot(normal, lightDirection), 0.0)), 1.0), calcDepth(position));
+			return;
+		}
+	}
 
 	// using calcDepth, you can convert a ray position to an OpenGL z-value, so that intersections/occlusions with the
 	// model geometry are handled correctly, e.g.: gl_FragDepth = calcDepth(nearestHit);
 	// in case there is no intersection, you should get gl_FragDepth to 1.0, i.e., the output of the shader will be ignored
 
-	gl_FragDepth = 1.0;
+	writeResult(vec4(1.0), 1.0);
 }
\ No newline at end of file
@@ -0,0 +1,495 @@
+#include "Bvh.h"
+#include "Model.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <limits>
+#include <memory>
+
+using namespace minity;
+using namespace glm;
+
+namespace
+{
+	constexpr int binCount = 16;
+	// nodes with more triangles are split on the calling task and their children are built as separate tasks
+	constexpr std::size_t taskSize = 16 * 1024;
+	// nodes with more triangles fill their bins in parallel, in chunks of the given size
+	constexpr std::size_t parallelBinningSize = 256 * 1024;
+	constexpr std::size_t chunkSize = 64 * 1024;
+
+	struct Bounds
+	{
+		vec3 minimum = vec3(std::numeric_limits<float>::max());
+		vec3 maximum = vec3(-std::numeric_limits<float>::max());
+
+		void extend(const vec3& point)
+		{
+			minimum = min(minimum, point);
+			maximum = max(maximum, point);
+		}
+
+		void extend(const Bounds& bounds)
+		{
+			minimum = min(minimum, bounds.minimum);
+			maximum = max(maximum, bounds.maximum);
+		}
+
+		vec3 center() const
+		{
+			return 0.5f * (minimum + maximum);
+		}
+
+		float area() const
+		{
+			const vec3 extent = max(maximum - minimum, vec3(0.0f));
+			return 2.0f * (extent.x * extent.y + extent.y * extent.z + extent.z * extent.x);
+		}
+	};
+
+	// triangle with its bounds, which are moved together so that the builder reads them sequentially
+	struct Reference
+	{
+		Bounds bounds;
+		uint triangle = 0;
+	};
+
+	struct Bin
+	{
+		Bounds bounds;
+		std::size_t count = 0;
+
+		void extend(const Bin& bin)
+		{
+			bounds.extend(bin.bounds);
+			count += bin.count;
+		}
+	};
+
+	using Bins = std::array<std::array<Bin, binCount>, 3>;
+
+	// two children of a node, the first one covers the references before the middle
+	struct Split
+	{
+		std::size_t middle = 0;
+		Bounds bounds[2];
+		Bounds centroidBounds[2];
+	};
+
+	// subtree built by one task, nodes are in depth-first order with offsets relative to the first node
+	struct Subtree
+	{
+		std::vector<BvhNode> nodes;
+		// children built as separate tasks, the nodes only contain their parent then
+		std::unique_ptr<Subtree> children[2];
+		std::size_t nodeCount = 0;
+	};
+
+	class Builder
+	{
+	public:
+		Builder(std::vector<Reference>& references, ThreadPool& pool) : m_references(references), m_pool(pool)
+		{
+		}
+
+		// the depth of the root is one
+		std::unique_ptr<Subtree> buildTask(std::size_t begin, std::size_t end, const Bounds& bounds, const Bounds& centroidBounds, std::size_t depth)
+		{
+			auto subtree = std::make_unique<Subtree>();
+
+			if (end - begin <= taskSize)
+			{
+				buildSerial(subtree->nodes, begin, end, bounds, centroidBounds, depth);
+				subtree->nodeCount = subtree->nodes.size();
+				return subtree;
+			}
+
+			Split split;
+			subtree->nodes.push_back(makeNode(bounds));
+
+			if (!findSplit(begin, end, bounds, centroidBounds, depth, split))
+			{
+				makeLeaf(subtree->nodes.back(), begin, end);
+				subtree->nodeCount = 1;
+				return subtree;
+			}
+
+			m_pool.parallelFor(2, [&](std::size_t i) {
+				subtree->children[i] = buildTask(i == 0 ? begin : split.middle, i == 0 ? split.middle : end, split.bounds[i], split.centroidBounds[i], depth + 1);
+			});
+
+			subtree->nodeCount = 1 + subtree->children[0]->nodeCount + subtree->children[1]->nodeCount;
+			return subtree;
+		}
+
+		// writes the nodes of a subtree to their final position, where the offsets of inner nodes become absolute
+		void flatten(const Subtree& subtree, std::vector<BvhNode>& nodes, std::size_t position)
+		{
+			if (subtree.children[0])
+			{
+				BvhNode node = subtree.nodes.front();
+				node.offset = uint(position + 1 + subtree.children[0]->nodeCount);
+				nodes[position] = node;
+
+				m_pool.parallelFor(2, [&](std::size_t i) {
+					flatten(*subtree.children[i], nodes, i == 0 ? position + 1 : node.offset);
+				});
+			}
+			else
+			{
+				for (std::size_t i = 0; i < subtree.nodes.size(); i++)
+				{
+					BvhNode node = subtree.nodes[i];
+
+					if (node.triangleCount == 0)
+						node.offset += uint(position);
+
+					nodes[position + i] = node;
+				}
+			}
+		}
+
+	private:
+		static BvhNode makeNode(const Bounds& bounds)
+		{
+			BvhNode node;
+			node.minimumBounds = bounds.minimum;
+			node.maximumBounds = bounds.maximum;
+			return node;
+		}
+
+		static void makeLeaf(BvhNode& node, std::size_t begin, std::size_t end)
+		{
+			node.offset = uint(begin);
+			node.triangleCount = uint(end - begin);
+		}
+
+		// returns the index of the node relative to the first node of the subtree
+		uint buildSerial(std::vector<BvhNode>& nodes, std::size_t begin, std::size_t end, const Bounds& bounds, const Bounds& centroidBounds, std::size_t depth)
+		{
+			const uint index = uint(nodes.size());
+			nodes.push_back(makeNode(bounds));
+
+			Split split;
+
+			if (!findSplit(begin, end, bounds, centroidBounds, depth, split))
+			{
+				makeLeaf(nodes[index], begin, end);
+				return index;
+			}
+
+			buildSerial(nodes, begin, split.middle, split.bounds[0], split.centroidBounds[0], depth + 1);
+			const uint second = buildSerial(nodes, split.middle, end, split.bounds[1], split.centroidBounds[1], depth + 1);
+			nodes[index].offset = second;
+
+			return index;
+		}
+
+		// the same computation is used for binning and partitioning, so that both agree on every reference
+		static int binIndex(float centroid, float minimum, float scale, int nodeBinCount)
+		{
+			return std::min(nodeBinCount - 1, int((centroid - minimum) * scale));
+		}
+
+		void fillBins(std::size_t begin, std::size_t end, const Bounds& centroidBounds, const vec3& scale, int nodeBinCount, Bins& bins) const
+		{
+			for (std::size_t i = begin; i < end; i++)
+			{
+				const Bounds& triangleBounds = m_references[i].bounds;
+				const vec3 centroid = triangleBounds.center();
+
+				for (int axis = 0; axis < 3; axis++)
+				{
+					Bin& bin = bins[axis][binIndex(centroid[axis], centroidBounds.minimum[axis], scale[axis], nodeBinCount)];
+					bin.bounds.extend(triangleBounds);
+					bin.count++;
+				}
+			}
+		}
+
+		// returns false if the node becomes a leaf, which nodes at the maximum depth always do regardless of their size
+		bool findSplit(std::size_t begin, std::size_t end, const Bounds& bounds, const Bounds& centroidBounds, std::size_t depth, Split& split)
+		{
+			const std::size_t count = end - begin;
+
+			if (count <= 1 || depth >= Bvh::maximumDepth)
+				return false;
+
+			// small nodes use fewer bins, since most nodes are small and the cost of a node grows with its bins
+			const int nodeBinCount = int(std::min(std::size_t(binCount), count));
+			const vec3 extent = centroidBounds.maximum - centroidBounds.minimum;
+			vec3 scale(0.0f);
+
+			for (int axis = 0; axis < 3; axis++)
+				scale[axis] = extent[axis] > 0.0f ? float(nodeBinCount) / extent[axis] : 0.0f;
+
+			Bins bins;
+
+			if (count < parallelBinningSize)
+			{
+				fillBins(begin, end, centroidBounds, scale, nodeBinCount, bins);
+			}
+			else
+			{
+				std::vector<Bins> chunkBins((count + chunkSize - 1) / chunkSize);
+
+				m_pool.parallelFor(chunkBins.size(), [&](std::size_t c) {
+					fillBins(begin + c * chunkSize, std::min(end, begin + (c + 1) * chunkSize), centroidBounds, scale, nodeBinCount, chunkBins[c]);
+				});
+
+				for (const auto& chunk : chunkBins)
+				{
+					for (int axis = 0; axis < 3; axis++)
+					{
+						for (int b = 0; b < nodeBinCount; b++)
+							bins[axis][b].extend(chunk[axis][b]);
+					}
+				}
+			}
+
+			// surface area heuristic, the cost of splitting after each bin is the sum of area times count of both sides
+			float bestCost = std::numeric_limits<float>::max();
+			int bestAxis = -1;
+			int bestBin = 0;
+
+			for (int axis = 0; axis < 3; axis++)
+			{
+				if (extent[axis] <= 0.0f)
+					continue;
+
+				std::array<float, binCount> rightCosts;
+				Bounds right;
+				std::size_t rightCount = 0;
+
+				for (int b = nodeBinCount - 1; b > 0; b--)
+				{
+					right.extend(bins[axis][b].bounds);
+					rightCount += bins[axis][b].count;
+					rightCosts[b] = rightCount > 0 ? right.area() * float(rightCount) : 0.0f;
+				}
+
+				Bounds left;
+				std::size_t leftCount = 0;
+
+				for (int b = 0; b < nodeBinCount - 1; b++)
+				{
+					left.extend(bins[axis][b].bounds);
+					leftCount += bins[axis][b].count;
+
+					if (leftCount == 0 || leftCount == count)
+						continue;
+
+					const float cost = left.area() * float(leftCount) + rightCosts[b + 1];
+
+					if (cost < bestCost)
+					{
+						bestCost = cost;
+						bestAxis = axis;
+						bestBin = b;
+					}
+				}
+			}
+
+			if (bestAxis < 0)
+			{
+				// all centroids are equal, large nodes are split in the middle of their references
+				if (count <= Bvh::maximumLeafSize)
+					return false;
+
+				split.middle = begin + count / 2;
+
+				for (std::size_t i = begin; i < end; i++)
+					split.bounds[i < split.middle ? 0 : 1].extend(m_references[i].bounds);
+
+				computeCentroidBounds(begin, end, split);
+				return true;
+			}
+
+			// both costs are scaled by the area of the node, which may be zero for degenerate triangles
+			if (count <= Bvh::maximumLeafSize && Bvh::traversalCost * bounds.area() + bestCost >= float(count) * bounds.area())
+				return false;
+
+			const float minimum = centroidBounds.minimum[bestAxis];
+			const float axisScale = scale[bestAxis];
+
+			auto middle = std::partition(m_references.begin() + begin, m_references.begin() + end, [&](const Reference& reference) {
+				return binIndex(reference.bounds.center()[bestAxis], minimum, axisScale, nodeBinCount) <= bestBin;
+			});
+
+			split.middle = std::size_t(middle - m_references.begin());
+
+			for (int b = 0; b < nodeBinCount; b++)
+				split.bounds[b <= bestBin ? 0 : 1].extend(bins[bestAxis][b].bounds);
+
+			computeCentroidBounds(begin, end, split);
+			return true;
+		}
+
+		// centroid bounds are not kept in the bins, since a pass over the partitioned references is cheaper than binning them
+		void computeCentroidBounds(std::size_t begin, std::size_t end, Split& split) const
+		{
+			for (std::size_t i = begin; i < split.middle; i++)
+				split.centroidBounds[0].extend(m_references[i].bounds.center());
+
+			for (std::size_t i = split.middle; i < end; i++)
+				split.centroidBounds[1].extend(m_references[i].bounds.center());
+		}
+
+		std::vector<Reference>& m_references;
+		ThreadPool& m_pool;
+	};
+}
+
+void Bvh::build(const Vertex* vertices, const uint* indices, std::size_t indexCount, unsigned int threadCount)
+{
+	const auto buildStart = std::chrono::steady_clock::now();
+
+	clear();
+
+	const std::size_t triangleCount = indexCount / 3;
+
+	if (triangleCount == 0)
+		return;
+
+	ThreadPool pool(threadCount);
+	const std::size_t chunkCount = (triangleCount + chunkSize - 1) / chunkSize;
+
+	// bounds of the triangles and of all triangles and their centroids, reduced over chunks
+	std::vector<Reference> references(triangleCount);
+	std::vector<Bounds> chunkBounds(chunkCount);
+	std::vector<Bounds> chunkCentroidBounds(chunkCount);
+
+	pool.parallelFor(chunkCount, [&](std::size_t c) {
+		for (std::size_t t = c * chunkSize; t < std::min(triangleCount, (c + 1) * chunkSize); t++)
+		{
+			Bounds& bounds = references[t].bounds;
+
+			for (int k = 0; k < 3; k++)
+				bounds.extend(vertices[indices[t * 3 + k]].position);
+
+			references[t].triangle = uint(t);
+			chunkBounds[c].extend(bounds);
+			chunkCentroidBounds[c].extend(bounds.center());
+		}
+	});
+
+	Bounds bounds;
+	Bounds centroidBounds;
+
+	for (std::size_t c = 0; c < chunkCount; c++)
+	{
+		bounds.extend(chunkBounds[c]);
+		centroidBounds.extend(chunkCentroidBounds[c]);
+	}
+
+	Builder builder(references, pool);
+	std::unique_ptr<Subtree> root = builder.buildTask(0, triangleCount, bounds, centroidBounds, 1);
+
+	m_nodes.resize(root->nodeCount);
+	builder.flatten(*root, m_nodes, 0);
+	root.reset();
+
+	// triangles are stored in the order of the leaves, so that a leaf reads consecutive memory
+	m_triangles.resize(triangleCount);
+
+	pool.parallelFor(chunkCount, [&](std::size_t c) {
+		for (std::size_t i = c * chunkSize; i < std::min(triangleCount, (c + 1) * chunkSize); i++)
+		{
+			const uint t = references[i].triangle;
+			BvhTriangle& triangle = m_triangles[i];
+
+			for (int k = 0; k < 3; k++)
+				triangle.indices[k] = indices[std::size_t(t) * 3 + k];
+
+			triangle.triangle = t;
+		}
+	});
+
+	computeStatistics();
+
+	const std::chrono::duration<double> buildTime = std::chrono::steady_clock::now() - buildStart;
+	m_statistics.buildTime = buildTime.count();
+}
+
+void Bvh::assign(std::vector<BvhNode>&& nodes, std::vector<BvhTriangle>&& triangles)
+{
+	m_nodes = std::move(nodes);
+	m_triangles = std::move(triangles);
+	computeStatistics();
+}
+
+void Bvh::clear()
+{
+	m_nodes.clear();
+	m_triangles.clear();
+	m_statistics = Statistics();
+}
+
+bool Bvh::empty() const
+{
+	return m_nodes.empty();
+}
+
+const std::vector<BvhNode>& Bvh::nodes() const
+{
+	return m_nodes;
+}
+
+const std::vector<BvhTriangle>& Bvh::triangles() const
+{
+	return m_triangles;
+}
+
+const Bvh::Statistics& Bvh::statistics() const
+{
+	return m_statistics;
+}
+
+void Bvh::computeStatistics()
+{
+	m_statistics = Statistics();
+	m_statistics.nodeCount = m_nodes.size();
+	m_statistics.triangleCount = m_triangles.size();
+
+	if (m_nodes.empty())
+		return;
+
+	auto area = [](const BvhNode& node) {
+		Bounds bounds;
+		bounds.minimum = node.minimumBounds;
+		bounds.maximum = node.maximumBounds;
+		return bounds.area();
+	};
+
+	const float rootArea = area(m_nodes.front());
+	double cost = 0.0;
+
+	// nodes with their depth, the first child is always the next node
+	std::vector<std::pair<std::size_t, std::size_t>> stack = { { 0, 1 } };
+
+	while (!stack.empty())
+	{
+		const auto [index, depth] = stack.back();
+		stack.pop_back();
+
+		const BvhNode& node = m_nodes[index];
+		const float relativeArea = rootArea > 0.0f ? area(node) / rootArea : 1.0f;
+		m_statistics.depth = std::max(m_statistics.depth, depth);
+
+		if (node.triangleCount > 0)
+		{
+			m_statistics.leafCount++;
+			cost += double(relativeArea) * double(node.triangleCount);
+		}
+		else
+		{
+			cost += double(relativeArea) * double(traversalCost);
+			stack.emplace_back(index + 1, depth + 1);
+			stack.emplace_back(node.offset, depth + 1);
+		}
+	}
+
+	m_statistics.sahCost = float(cost);
+}
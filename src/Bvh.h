@@ -0,0 +1,74 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <vector>
+
+namespace minity
+{
+	struct Vertex;
+
+	// node of the flattened hierarchy, the first child of an inner node directly follows it
+	struct BvhNode
+	{
+		glm::vec3 minimumBounds = glm::vec3(0.0f);
+		// index of the second child for inner nodes, of the first triangle for leaves
+		glm::uint offset = 0;
+		glm::vec3 maximumBounds = glm::vec3(0.0f);
+		// number of triangles of a leaf, zero for inner nodes
+		glm::uint triangleCount = 0;
+	};
+
+	static_assert(sizeof(BvhNode) == 32, "nodes have to fit two to a cache line");
+
+	// triangle in the order of the leaves
+	struct BvhTriangle
+	{
+		glm::uint indices[3] = { 0, 0, 0 };
+		// position of the triangle in the index buffer divided by three
+		glm::uint triangle = 0;
+	};
+
+	// bounding volume hierarchy over triangles, built with the surface area heuristic evaluated on bins of the centroids
+	class Bvh
+	{
+	public:
+		struct Statistics
+		{
+			std::size_t nodeCount = 0;
+			std::size_t leafCount = 0;
+			std::size_t triangleCount = 0;
+			std::size_t depth = 0;
+			// expected cost of a ray query relative to intersecting one triangle, from the surface areas of the nodes
+			float sahCost = 0.0f;
+			// zero if the hierarchy was not built but assigned
+			double buildTime = 0.0;
+		};
+
+		// cost of visiting a node relative to intersecting a triangle
+		static constexpr float traversalCost = 1.0f;
+		static constexpr glm::uint maximumLeafSize = 8;
+		// counting the root, deeper nodes would overflow the fixed traversal stack of the raytrace shader
+		static constexpr std::size_t maximumDepth = 32;
+
+		// builds the hierarchy over a triangle list on a thread pool, zero threads uses all hardware threads
+		void build(const Vertex* vertices, const glm::uint* indices, std::size_t indexCount, unsigned int threadCount = 0);
+
+		// takes a hierarchy built before, for example from a cache
+		void assign(std::vector<BvhNode>&& nodes, std::vector<BvhTriangle>&& triangles);
+		void clear();
+
+		bool empty() const;
+		const std::vector<BvhNode>& nodes() const;
+		const std::vector<BvhTriangle>& triangles() const;
+		const Statistics& statistics() const;
+
+	private:
+		void computeStatistics();
+
+		std::vector<BvhNode> m_nodes;
+		std::vector<BvhTriangle> m_triangles;
+		Statistics m_statistics;
+	};
+}
@@ -0,0 +1,48 @@
+#include "Frustum.h"
+
+using namespace minity;
+using namespace glm;
+
+Frustum::Frustum(const mat4& transform)
+{
+	const vec4 row0(transform[0][0], transform[1][0], transform[2][0], transform[3][0]);
+	const vec4 row1(transform[0][1], transform[1][1], transform[2][1], transform[3][1]);
+	const vec4 row2(transform[0][2], transform[1][2], transform[2][2], transform[3][2]);
+	const vec4 row3(transform[0][3], transform[1][3], transform[2][3], transform[3][3]);
+
+	// left, right, bottom, top, near and far plane after Gribb and Hartmann
+	m_planes = { row3 + row0, row3 - row0, row3 + row1, row3 - row1, row3 + row2, row3 - row2 };
+
+	for (auto& p : m_planes)
+	{
+		const float l = length(vec3(p));
+
+		if (l > 0.0f)
+			p /= l;
+	}
+}
+
+bool Frustum::intersectsSphere(const vec3& center, float radius) const
+{
+	for (const auto& p : m_planes)
+	{
+		if (dot(vec3(p), center) + p.w < -radius)
+			return false;
+	}
+
+	return true;
+}
+
+bool Frustum::intersectsBox(const vec3& minimumBounds, const vec3& maximumBounds) const
+{
+	for (const auto& p : m_planes)
+	{
+		// the corner furthest along the plane normal
+		const vec3 corner(p.x >= 0.0f ? maximumBounds.x : minimumBounds.x, p.y >= 0.0f ? maximumBounds.y : minimumBounds.y, p.z >= 0.0f ? maximumBounds.z : minimumBounds.z);
+
+		if (dot(vec3(p), corner) + p.w < 0.0f)
+			return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <array>
+
+namespace minity
+{
+	// view frustum given by the planes of the clip space cube, in the space the transformation is applied to
+	class Frustum
+	{
+	public:
+		// with a model view projection matrix, the planes are in object space and bounds can be tested without transforming them
+		Frustum(const glm::mat4& transform);
+
+		// conservative tests, which may report an intersection for objects close to the corners of the frustum
+		bool intersectsSphere(const glm::vec3& center, float radius) const;
+		bool intersectsBox(const glm::vec3& minimumBounds, const glm::vec3& maximumBounds) const;
+
+	private:
+		// normalized, pointing inwards
+		std::array<glm::vec4, 6> m_planes;
+	};
+}
@@ -0,0 +1,86 @@
+#include "GBuffer.h"
+
+using namespace minity;
+using namespace gl;
+using namespace glm;
+using namespace globjects;
+
+void GBuffer::request()
+{
+	m_requested = true;
+	m_filled = false;
+}
+
+bool GBuffer::begin(const ivec2& size)
+{
+	if (!m_requested)
+	{
+		m_filled = false;
+		return false;
+	}
+
+	if (!m_framebuffer || m_size != size)
+	{
+		m_depthTexture = Texture::create(GL_TEXTURE_2D);
+		m_normalTexture = Texture::create(GL_TEXTURE_2D);
+		m_materialTexture = Texture::create(GL_TEXTURE_2D);
+
+		for (Texture *texture : { m_depthTexture.get(), m_normalTexture.get(), m_materialTexture.get() })
+		{
+			texture->setParameter(GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+			texture->setParameter(GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+			texture->setParameter(GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+			texture->setParameter(GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		}
+
+		m_depthTexture->image2D(0, GL_DEPTH_COMPONENT32F, size, 0, GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
+		m_normalTexture->image2D(0, GL_RGBA16F, size, 0, GL_RGBA, GL_FLOAT, nullptr);
+		m_materialTexture->image2D(0, GL_R32UI, size, 0, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+
+		// the color output of the model shader at location zero is dropped
+		m_framebuffer = Framebuffer::create();
+		m_framebuffer->attachTexture(GL_DEPTH_ATTACHMENT, m_depthTexture.get());
+		m_framebuffer->attachTexture(GL_COLOR_ATTACHMENT0, m_normalTexture.get());
+		m_framebuffer->attachTexture(GL_COLOR_ATTACHMENT1, m_materialTexture.get());
+		m_framebuffer->setDrawBuffers({ GL_NONE, GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 });
+		m_size = size;
+	}
+
+	// normals and materials are only read where the depth was written
+	m_framebuffer->bind();
+	m_framebuffer->clearBuffer(GL_DEPTH, 0, 1.0f);
+
+	m_requested = false;
+	m_filled = true;
+	return true;
+}
+
+void GBuffer::end()
+{
+	Framebuffer::unbind();
+}
+
+bool GBuffer::isFilled() const
+{
+	return m_filled;
+}
+
+const ivec2& GBuffer::size() const
+{
+	return m_size;
+}
+
+Texture* GBuffer::depthTexture()
+{
+	return m_depthTexture.get();
+}
+
+Texture* GBuffer::normalTexture()
+{
+	return m_normalTexture.get();
+}
+
+Texture* GBuffer::materialTexture()
+{
+	return m_materialTexture.get();
+}
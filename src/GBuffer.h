@@ -0,0 +1,43 @@
+#pragma once
+
+#include <memory>
+
+#include <glm/glm.hpp>
+#include <globjects/Framebuffer.h>
+#include <globjects/Texture.h>
+
+namespace minity
+{
+	// offscreen targets for the rasterized visibility of the model, from which secondary rays are traced
+	// a reader requests the targets for the next frame, the model is then drawn into them instead of the screen
+	class GBuffer
+	{
+	public:
+		// asks for the targets to be filled in the next frame, the request has to be repeated every frame
+		void request();
+
+		// binds the targets for drawing if they were requested, resizing and clearing them as needed
+		bool begin(const glm::ivec2& size);
+		void end();
+
+		// whether the last frame was drawn into the targets, which is reset by the next request
+		bool isFilled() const;
+		const glm::ivec2& size() const;
+
+		// window space depth of the closest surfaces, 1 where nothing was drawn
+		globjects::Texture* depthTexture();
+		// object space normals of the surfaces as they were interpolated, neither normalized nor facing the camera
+		globjects::Texture* normalTexture();
+		// index of the material of the surfaces, unsigned integer texture
+		globjects::Texture* materialTexture();
+
+	private:
+		std::unique_ptr<globjects::Framebuffer> m_framebuffer;
+		std::unique_ptr<globjects::Texture> m_depthTexture;
+		std::unique_ptr<globjects::Texture> m_normalTexture;
+		std::unique_ptr<globjects::Texture> m_materialTexture;
+		glm::ivec2 m_size = glm::ivec2(0);
+		bool m_requested = false;
+		bool m_filled = false;
+	};
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <string>
+#include <cstddef>
+
+namespace minity
+{
+	// read-only memory mapping of a whole file, so that parsers can work directly on the file contents
+	class MappedFile
+	{
+	public:
+		MappedFile();
+		MappedFile(const std::string& filename);
+		~MappedFile();
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		bool open(const std::string& filename);
+		void close();
+
+		bool isOpen() const;
+		const char* data() const;
+		std::size_t size() const;
+
+	private:
+		bool m_open = false;
+		const char* m_data = nullptr;
+		std::size_t m_size = 0;
+
+#ifdef _WIN32
+		void* m_file = nullptr;
+		void* m_mapping = nullptr;
+#else
+		int m_file = -1;
+#endif
+	};
+}
@@ -0,0 +1,81 @@
+#include "MemoryUsage.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#elif defined(__APPLE__)
+#include <mach/mach.h>
+#include <sys/resource.h>
+#else
+#include <fstream>
+#include <string>
+#endif
+
+#if !defined(_WIN32) && !defined(__APPLE__)
+namespace
+{
+	// reads a value given in kilobytes from /proc/self/status
+	std::size_t readStatusValue(const std::string& key)
+	{
+		std::ifstream is("/proc/self/status");
+		std::string line;
+
+		while (std::getline(is, line))
+		{
+			if (line.compare(0, key.size(), key) == 0)
+				return std::size_t(std::stoull(line.substr(key.size()))) * 1024;
+		}
+
+		return 0;
+	}
+}
+#endif
+
+namespace minity
+{
+	std::size_t currentMemoryUsage()
+	{
+#ifdef _WIN32
+		PROCESS_MEMORY_COUNTERS counters;
+
+		if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+			return std::size_t(counters.WorkingSetSize);
+
+		return 0;
+#elif defined(__APPLE__)
+		mach_task_basic_info_data_t info;
+		mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+
+		if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO, reinterpret_cast<task_info_t>(&info), &count) == KERN_SUCCESS)
+			return std::size_t(info.resident_size);
+
+		return 0;
+#else
+		return readStatusValue("VmRSS:");
+#endif
+	}
+
+	std::size_t peakMemoryUsage()
+	{
+#ifdef _WIN32
+		PROCESS_MEMORY_COUNTERS counters;
+
+		if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+			return std::size_t(counters.PeakWorkingSetSize);
+
+		return 0;
+#elif defined(__APPLE__)
+		struct rusage usage;
+
+		// ru_maxrss is given in bytes on macOS
+		if (getrusage(RUSAGE_SELF, &usage) == 0)
+			return std::size_t(usage.ru_maxrss);
+
+		return 0;
+#else
+		return readStatusValue("VmHWM:");
+#endif
+	}
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <cstddef>
+
+namespace minity
+{
+	// resident memory of the current process in bytes, zero if it cannot be determined on this platform
+	std::size_t currentMemoryUsage();
+
+	// highest resident memory of the current process so far in bytes, zero if it cannot be determined on this platform
+	std::size_t peakMemoryUsage();
+}
@@ -0,0 +1,390 @@
+#include "MeshOptimizer.h"
+#include "Model.h"
+
+#include <algorithm>
+#include <numeric>
+#include <vector>
+
+using namespace minity;
+using namespace glm;
+
+namespace
+{
+	// indices into the list of distinct vertices a part of an index buffer refers to, sorted by vertex
+	struct LocalIndices
+	{
+		std::vector<uint> vertices;
+		std::vector<uint> indices;
+
+		LocalIndices(const uint* globalIndices, std::size_t indexCount) : vertices(globalIndices, globalIndices + indexCount), indices(indexCount)
+		{
+			std::sort(vertices.begin(), vertices.end());
+			vertices.erase(std::unique(vertices.begin(), vertices.end()), vertices.end());
+
+			for (std::size_t i = 0; i < indexCount; i++)
+				indices[i] = uint(std::lower_bound(vertices.begin(), vertices.end(), globalIndices[i]) - vertices.begin());
+		}
+	};
+
+	// FIFO cache, an entry is cached as long as fewer than cacheSize misses happened since it was transformed
+	struct CacheSimulation
+	{
+		std::vector<std::size_t> transformed;
+		std::size_t misses = 0;
+		// misses before the last reset, entries transformed before are not cached anymore
+		std::size_t resetMisses = 0;
+		unsigned int cacheSize;
+
+		CacheSimulation(std::size_t vertexCount, unsigned int cacheSize) : transformed(vertexCount, 0), cacheSize(cacheSize)
+		{
+		}
+
+		// returns the number of misses of a triangle
+		unsigned int access(const uint* triangle)
+		{
+			unsigned int triangleMisses = 0;
+
+			for (int i = 0; i < 3; i++)
+			{
+				const uint v = triangle[i];
+
+				if (transformed[v] <= resetMisses || misses - transformed[v] >= cacheSize)
+				{
+					misses++;
+					triangleMisses++;
+					transformed[v] = misses;
+				}
+			}
+
+			return triangleMisses;
+		}
+
+		std::size_t missesSinceReset() const
+		{
+			return misses - resetMisses;
+		}
+
+		void reset()
+		{
+			resetMisses = misses;
+		}
+	};
+}
+
+float VertexCacheStatistics::acmr() const
+{
+	return triangleCount > 0 ? float(transformedCount) / float(triangleCount) : 0.0f;
+}
+
+float VertexCacheStatistics::atvr() const
+{
+	return vertexCount > 0 ? float(transformedCount) / float(vertexCount) : 0.0f;
+}
+
+VertexCacheStatistics& VertexCacheStatistics::operator+=(const VertexCacheStatistics& other)
+{
+	triangleCount += other.triangleCount;
+	vertexCount += other.vertexCount;
+	transformedCount += other.transformedCount;
+
+	return *this;
+}
+
+VertexCacheStatistics minity::analyzeVertexCache(const uint* indices, std::size_t indexCount, unsigned int cacheSize)
+{
+	indexCount -= indexCount % 3;
+
+	const LocalIndices local(indices, indexCount);
+	CacheSimulation cache(local.vertices.size(), cacheSize);
+
+	for (std::size_t i = 0; i < indexCount; i += 3)
+		cache.access(&local.indices[i]);
+
+	VertexCacheStatistics statistics;
+	statistics.triangleCount = indexCount / 3;
+	statistics.vertexCount = local.vertices.size();
+	statistics.transformedCount = cache.misses;
+
+	return statistics;
+}
+
+void minity::optimizeVertexCache(uint* indices, std::size_t indexCount, unsigned int cacheSize)
+{
+	indexCount -= indexCount % 3;
+
+	const std::size_t triangleCount = indexCount / 3;
+
+	if (triangleCount < 2)
+		return;
+
+	const LocalIndices local(indices, indexCount);
+	const std::size_t vertexCount = local.vertices.size();
+
+	// triangles adjacent to each vertex
+	std::vector<uint> adjacencyOffsets(vertexCount + 1, 0);
+
+	for (uint v : local.indices)
+		adjacencyOffsets[v + 1]++;
+
+	std::partial_sum(adjacencyOffsets.begin(), adjacencyOffsets.end(), adjacencyOffsets.begin());
+
+	std::vector<uint> adjacency(indexCount);
+	std::vector<uint> liveTriangles(vertexCount);
+
+	{
+		std::vector<uint> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+
+		for (std::size_t i = 0; i < indexCount; i++)
+			adjacency[fill[local.indices[i]]++] = uint(i / 3);
+
+		for (std::size_t v = 0; v < vertexCount; v++)
+			liveTriangles[v] = adjacencyOffsets[v + 1] - adjacencyOffsets[v];
+	}
+
+	std::vector<std::size_t> cacheTime(vertexCount, 0);
+	std::vector<bool> emitted(triangleCount, false);
+	std::vector<uint> deadEnd;
+	std::vector<uint> candidates;
+	std::vector<uint> output;
+	output.reserve(indexCount);
+
+	std::size_t time = cacheSize + 1;
+	std::size_t cursor = 0;
+	std::ptrdiff_t fanning = 0;
+
+	while (fanning >= 0)
+	{
+		candidates.clear();
+
+		// all remaining triangles around the fanning vertex are emitted at once
+		for (uint a = adjacencyOffsets[fanning]; a < adjacencyOffsets[fanning + 1]; a++)
+		{
+			const uint t = adjacency[a];
+
+			if (emitted[t])
+				continue;
+
+			for (int k = 0; k < 3; k++)
+			{
+				const uint v = local.indices[t * 3 + k];
+				output.push_back(indices[t * 3 + k]);
+				deadEnd.push_back(v);
+				candidates.push_back(v);
+				liveTriangles[v]--;
+
+				if (time - cacheTime[v] > cacheSize)
+				{
+					cacheTime[v] = time;
+					time++;
+				}
+			}
+
+			emitted[t] = true;
+		}
+
+		// the next fanning vertex is the one among the candidates that will still be cached after its triangles are emitted,
+		// preferring the oldest one, otherwise the most recent vertex with live triangles or any vertex in input order
+		fanning = -1;
+		std::ptrdiff_t best = -1;
+
+		for (uint v : candidates)
+		{
+			if (liveTriangles[v] == 0)
+				continue;
+
+			std::ptrdiff_t priority = 0;
+
+			if (time - cacheTime[v] + 2 * liveTriangles[v] <= cacheSize)
+				priority = std::ptrdiff_t(time - cacheTime[v]);
+
+			if (priority > best)
+			{
+				best = priority;
+				fanning = v;
+			}
+		}
+
+		if (fanning < 0)
+		{
+			while (!deadEnd.empty() && fanning < 0)
+			{
+				const uint v = deadEnd.back();
+				deadEnd.pop_back();
+
+				if (liveTriangles[v] > 0)
+					fanning = v;
+			}
+
+			while (cursor < vertexCount && fanning < 0)
+			{
+				if (liveTriangles[cursor] > 0)
+					fanning = std::ptrdiff_t(cursor);
+
+				cursor++;
+			}
+		}
+	}
+
+	std::copy(output.begin(), output.end(), indices);
+}
+
+void minity::optimizeOverdraw(uint* indices, std::size_t indexCount, const Vertex* vertices, float threshold, unsigned int cacheSize)
+{
+	indexCount -= indexCount % 3;
+
+	const std::size_t triangleCount = indexCount / 3;
+
+	if (triangleCount < 2)
+		return;
+
+	const LocalIndices local(indices, indexCount);
+	CacheSimulation cache(local.vertices.size(), cacheSize);
+
+	// hard boundaries are where the vertex cache optimization started over, since all vertices of a triangle missed
+	std::vector<std::size_t> hardBoundaries;
+
+	for (std::size_t t = 0; t < triangleCount; t++)
+	{
+		if (cache.access(&local.indices[t * 3]) == 3)
+			hardBoundaries.push_back(t);
+	}
+
+	hardBoundaries.push_back(triangleCount);
+
+	// hard clusters are split further as long as the first part alone does not miss much more often than the whole cluster
+	std::vector<std::size_t> clusters;
+
+	for (std::size_t h = 0; h + 1 < hardBoundaries.size(); h++)
+	{
+		const std::size_t begin = hardBoundaries[h];
+		const std::size_t end = hardBoundaries[h + 1];
+
+		cache.reset();
+
+		for (std::size_t t = begin; t < end; t++)
+			cache.access(&local.indices[t * 3]);
+
+		const float clusterRatio = float(cache.missesSinceReset()) / float(end - begin);
+
+		cache.reset();
+		clusters.push_back(begin);
+
+		for (std::size_t t = begin, start = begin; t < end; t++)
+		{
+			cache.access(&local.indices[t * 3]);
+
+			if (t + 1 < end && float(cache.missesSinceReset()) / float(t + 1 - start) <= threshold * clusterRatio)
+			{
+				start = t + 1;
+				clusters.push_back(start);
+				cache.reset();
+			}
+		}
+	}
+
+	clusters.push_back(triangleCount);
+
+	const std::size_t clusterCount = clusters.size() - 1;
+
+	if (clusterCount < 2)
+		return;
+
+	// clusters whose area weighted normal points away from the centroid of the mesh are drawn first
+	std::vector<vec3> clusterCentroids(clusterCount, vec3(0.0f));
+	std::vector<vec3> clusterNormals(clusterCount, vec3(0.0f));
+	vec3 meshCentroid(0.0f);
+	float meshArea = 0.0f;
+
+	for (std::size_t c = 0; c < clusterCount; c++)
+	{
+		float clusterArea = 0.0f;
+
+		for (std::size_t t = clusters[c]; t < clusters[c + 1]; t++)
+		{
+			const vec3 &a = vertices[indices[t * 3]].position;
+			const vec3 &b = vertices[indices[t * 3 + 1]].position;
+			const vec3 &p = vertices[indices[t * 3 + 2]].position;
+
+			const vec3 normal = cross(b - a, p - a);
+			const float area = length(normal);
+			const vec3 centroid = (a + b + p) / 3.0f;
+
+			clusterCentroids[c] += centroid * area;
+			clusterNormals[c] += normal;
+			clusterArea += area;
+		}
+
+		meshCentroid += clusterCentroids[c];
+		meshArea += clusterArea;
+
+		if (clusterArea > 0.0f)
+			clusterCentroids[c] /= clusterArea;
+	}
+
+	if (meshArea > 0.0f)
+		meshCentroid /= meshArea;
+
+	std::vector<float> sortKeys(clusterCount);
+
+	for (std::size_t c = 0; c < clusterCount; c++)
+	{
+		const float normalLength = length(clusterNormals[c]);
+		sortKeys[c] = normalLength > 0.0f ? dot(clusterCentroids[c] - meshCentroid, clusterNormals[c] / normalLength) : 0.0f;
+	}
+
+	std::vector<std::size_t> order(clusterCount);
+	std::iota(order.begin(), order.end(), 0);
+	std::stable_sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) { return sortKeys[a] > sortKeys[b]; });
+
+	std::vector<uint> output;
+	output.reserve(indexCount);
+
+	for (std::size_t c : order)
+		output.insert(output.end(), indices + clusters[c] * 3, indices + clusters[c + 1] * 3);
+
+	std::copy(output.begin(), output.end(), indices);
+}
+
+void minity::optimizeVertexFetch(Vertex* vertices, uint* indices, std::size_t indexCount, std::size_t firstVertex, std::size_t vertexCount, uint* remap)
+{
+	if (vertexCount <= firstVertex)
+		return;
+
+	static constexpr uint unused = ~uint(0);
+	const std::size_t count = vertexCount - firstVertex;
+
+	std::vector<uint> newIndices(count, unused);
+	std::size_t next = 0;
+
+	for (std::size_t i = 0; i < indexCount; i++)
+	{
+		const uint v = indices[i];
+
+		if (v < firstVertex || v >= vertexCount)
+			continue;
+
+		uint &newIndex = newIndices[v - firstVertex];
+
+		if (newIndex == unused)
+			newIndex = uint(firstVertex + next++);
+
+		indices[i] = newIndex;
+	}
+
+	// vertices that are not referenced keep their relative order behind the others
+	for (auto &newIndex : newIndices)
+	{
+		if (newIndex == unused)
+			newIndex = uint(firstVertex + next++);
+	}
+
+	std::vector<Vertex> reordered(count);
+
+	for (std::size_t i = 0; i < count; i++)
+	{
+		reordered[newIndices[i] - firstVertex] = vertices[firstVertex + i];
+		remap[firstVertex + i] = newIndices[i];
+	}
+
+	std::copy(reordered.begin(), reordered.end(), vertices + firstVertex);
+}
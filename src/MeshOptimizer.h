@@ -0,0 +1,45 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+
+namespace minity
+{
+	struct Vertex;
+
+	// number of entries of the simulated post-transform vertex cache, used for optimizing and for measuring
+	constexpr unsigned int vertexCacheSize = 16;
+
+	struct VertexCacheStatistics
+	{
+		std::size_t triangleCount = 0;
+		std::size_t vertexCount = 0;
+		// vertices transformed with a FIFO cache of the given size
+		std::size_t transformedCount = 0;
+
+		// average cache miss ratio, transformed vertices per triangle
+		float acmr() const;
+		// average transformed vertex ratio, transformed vertices per referenced vertex
+		float atvr() const;
+
+		VertexCacheStatistics& operator+=(const VertexCacheStatistics& other);
+	};
+
+	// the functions work on parts of a larger index buffer, like the triangles of one group, and only need memory for the
+	// vertices the given indices refer to
+
+	// simulates a FIFO vertex cache for a triangle list
+	VertexCacheStatistics analyzeVertexCache(const glm::uint* indices, std::size_t indexCount, unsigned int cacheSize = vertexCacheSize);
+
+	// reorders the triangles for the post-transform vertex cache with the Tipsify algorithm by Sander et al.
+	void optimizeVertexCache(glm::uint* indices, std::size_t indexCount, unsigned int cacheSize = vertexCacheSize);
+
+	// reorders clusters of triangles from a vertex cache optimized list, so that clusters facing outwards come first and
+	// cover the clusters behind them, clusters are only split where this increases the cache misses by less than the threshold
+	void optimizeOverdraw(glm::uint* indices, std::size_t indexCount, const Vertex* vertices, float threshold = 1.05f, unsigned int cacheSize = vertexCacheSize);
+
+	// reorders the vertices from the first one on in the order they are first used, remap receives the new index of each
+	// reordered vertex at its old index, indices are updated accordingly and may refer to vertices before the first one
+	void optimizeVertexFetch(Vertex* vertices, glm::uint* indices, std::size_t indexCount, std::size_t firstVertex, std::size_t vertexCount, glm::uint* remap);
+}
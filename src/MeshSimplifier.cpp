@@ -0,0 +1,380 @@
+#include "MeshSimplifier.h"
+#include "Model.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+using namespace minity;
+using namespace glm;
+
+namespace
+{
+	// boundary edges are kept in place by planes perpendicular to their triangles, weighted more than the surface itself
+	constexpr double borderWeight = 10.0;
+
+	// sum of weighted squared distances to a set of planes
+	struct Quadric
+	{
+		double a00 = 0.0, a01 = 0.0, a02 = 0.0, a11 = 0.0, a12 = 0.0, a22 = 0.0;
+		double b0 = 0.0, b1 = 0.0, b2 = 0.0;
+		double c = 0.0;
+		double weight = 0.0;
+
+		static Quadric plane(const dvec3& normal, double distance, double weight)
+		{
+			Quadric q;
+			q.a00 = weight * normal.x * normal.x;
+			q.a01 = weight * normal.x * normal.y;
+			q.a02 = weight * normal.x * normal.z;
+			q.a11 = weight * normal.y * normal.y;
+			q.a12 = weight * normal.y * normal.z;
+			q.a22 = weight * normal.z * normal.z;
+			q.b0 = weight * normal.x * distance;
+			q.b1 = weight * normal.y * distance;
+			q.b2 = weight * normal.z * distance;
+			q.c = weight * distance * distance;
+			q.weight = weight;
+
+			return q;
+		}
+
+		Quadric& operator+=(const Quadric& other)
+		{
+			a00 += other.a00;
+			a01 += other.a01;
+			a02 += other.a02;
+			a11 += other.a11;
+			a12 += other.a12;
+			a22 += other.a22;
+			b0 += other.b0;
+			b1 += other.b1;
+			b2 += other.b2;
+			c += other.c;
+			weight += other.weight;
+
+			return *this;
+		}
+
+		double evaluate(const dvec3& p) const
+		{
+			const double rx = a00 * p.x + a01 * p.y + a02 * p.z;
+			const double ry = a01 * p.x + a11 * p.y + a12 * p.z;
+			const double rz = a02 * p.x + a12 * p.y + a22 * p.z;
+
+			return std::max(0.0, rx * p.x + ry * p.y + rz * p.z + 2.0 * (b0 * p.x + b1 * p.y + b2 * p.z) + c);
+		}
+	};
+
+	struct Collapse
+	{
+		uint from;
+		uint to;
+		// squared distance
+		double error;
+	};
+
+	dvec3 triangleNormal(const dvec3& a, const dvec3& b, const dvec3& c)
+	{
+		return cross(b - a, c - a);
+	}
+}
+
+std::vector<uint> minity::simplifyMesh(const uint* indices, std::size_t indexCount, const Vertex* vertices, std::size_t targetIndexCount, float maximumError, float& error)
+{
+	error = 0.0f;
+	indexCount -= indexCount % 3;
+
+	// distinct vertices of the input and their positions, vertices sharing a position are collapsed as one
+	std::vector<uint> localVertices(indices, indices + indexCount);
+	std::sort(localVertices.begin(), localVertices.end());
+	localVertices.erase(std::unique(localVertices.begin(), localVertices.end()), localVertices.end());
+
+	std::vector<uint> corners(indexCount);
+
+	for (std::size_t i = 0; i < indexCount; i++)
+		corners[i] = uint(std::lower_bound(localVertices.begin(), localVertices.end(), indices[i]) - localVertices.begin());
+
+	std::vector<uint> byPosition(localVertices.size());
+	std::iota(byPosition.begin(), byPosition.end(), 0);
+
+	auto positionLess = [&](uint a, uint b) {
+		const vec3 &p = vertices[localVertices[a]].position;
+		const vec3 &q = vertices[localVertices[b]].position;
+		return p.x < q.x || (p.x == q.x && (p.y < q.y || (p.y == q.y && p.z < q.z)));
+	};
+
+	std::sort(byPosition.begin(), byPosition.end(), positionLess);
+
+	// position of each local vertex and the vertex representing each position
+	std::vector<uint> vertexPosition(localVertices.size());
+	std::vector<uint> representative;
+	std::vector<dvec3> positions;
+
+	for (std::size_t i = 0; i < byPosition.size(); i++)
+	{
+		if (i == 0 || positionLess(byPosition[i - 1], byPosition[i]))
+		{
+			representative.push_back(byPosition[i]);
+			positions.push_back(dvec3(vertices[localVertices[byPosition[i]]].position));
+		}
+
+		vertexPosition[byPosition[i]] = uint(positions.size() - 1);
+	}
+
+	const std::size_t positionCount = positions.size();
+
+	auto cornerPosition = [&](std::size_t corner) { return vertexPosition[corners[corner]]; };
+
+	// triangles that are degenerate in position do not contribute anything
+	{
+		std::size_t kept = 0;
+
+		for (std::size_t i = 0; i < indexCount; i += 3)
+		{
+			const uint a = cornerPosition(i), b = cornerPosition(i + 1), c = cornerPosition(i + 2);
+
+			if (a != b && b != c && a != c)
+			{
+				corners[kept++] = corners[i];
+				corners[kept++] = corners[i + 1];
+				corners[kept++] = corners[i + 2];
+			}
+		}
+
+		corners.resize(kept);
+	}
+
+	std::vector<Quadric> quadrics(positionCount);
+
+	for (std::size_t i = 0; i < corners.size(); i += 3)
+	{
+		const dvec3 &a = positions[cornerPosition(i)];
+		const dvec3 &b = positions[cornerPosition(i + 1)];
+		const dvec3 &c = positions[cornerPosition(i + 2)];
+
+		const dvec3 normal = triangleNormal(a, b, c);
+		const double area = length(normal);
+
+		if (area <= 0.0)
+			continue;
+
+		const Quadric q = Quadric::plane(normal / area, -dot(normal / area, a), area);
+
+		for (int k = 0; k < 3; k++)
+			quadrics[cornerPosition(i + k)] += q;
+	}
+
+	// edges used by only one triangle get an additional plane through the edge, perpendicular to the triangle
+	{
+		struct Edge
+		{
+			uint a, b;
+			std::size_t triangle;
+		};
+
+		std::vector<Edge> edges;
+		edges.reserve(corners.size());
+
+		for (std::size_t i = 0; i < corners.size(); i += 3)
+		{
+			for (int k = 0; k < 3; k++)
+			{
+				const uint a = cornerPosition(i + k);
+				const uint b = cornerPosition(i + (k + 1) % 3);
+				edges.push_back({ std::min(a, b), std::max(a, b), i });
+			}
+		}
+
+		std::sort(edges.begin(), edges.end(), [](const Edge& x, const Edge& y) { return x.a < y.a || (x.a == y.a && x.b < y.b); });
+
+		for (std::size_t i = 0; i < edges.size(); i++)
+		{
+			const bool shared = (i > 0 && edges[i - 1].a == edges[i].a && edges[i - 1].b == edges[i].b) || (i + 1 < edges.size() && edges[i + 1].a == edges[i].a && edges[i + 1].b == edges[i].b);
+
+			if (shared)
+				continue;
+
+			const std::size_t t = edges[i].triangle;
+			const dvec3 normal = triangleNormal(positions[cornerPosition(t)], positions[cornerPosition(t + 1)], positions[cornerPosition(t + 2)]);
+			const dvec3 &a = positions[edges[i].a];
+			const dvec3 &b = positions[edges[i].b];
+			const dvec3 perpendicular = cross(b - a, normal);
+			const double perpendicularLength = length(perpendicular);
+
+			if (perpendicularLength <= 0.0)
+				continue;
+
+			const dvec3 planeNormal = perpendicular / perpendicularLength;
+			const Quadric q = Quadric::plane(planeNormal, -dot(planeNormal, a), borderWeight * dot(b - a, b - a));
+			quadrics[edges[i].a] += q;
+			quadrics[edges[i].b] += q;
+		}
+	}
+
+	const double maximumSquaredError = double(maximumError) * double(maximumError);
+	double largestError = 0.0;
+
+	std::vector<uint> adjacencyOffsets(positionCount + 1);
+	std::vector<uint> adjacency;
+	std::vector<std::pair<uint, uint>> edges;
+	std::vector<Collapse> collapses;
+	std::vector<uint> collapseTarget(positionCount);
+	std::vector<bool> locked(positionCount);
+
+	// each pass collapses a set of edges whose neighborhoods do not overlap, so that every collapse can be checked on its own
+	while (corners.size() > targetIndexCount)
+	{
+		const std::size_t triangleCount = corners.size() / 3;
+
+		std::fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0);
+
+		for (std::size_t i = 0; i < corners.size(); i++)
+			adjacencyOffsets[cornerPosition(i) + 1]++;
+
+		std::partial_sum(adjacencyOffsets.begin(), adjacencyOffsets.end(), adjacencyOffsets.begin());
+		adjacency.resize(corners.size());
+
+		{
+			std::vector<uint> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+
+			for (std::size_t i = 0; i < corners.size(); i++)
+				adjacency[fill[cornerPosition(i)]++] = uint(i / 3);
+		}
+
+		edges.clear();
+
+		for (std::size_t i = 0; i < corners.size(); i += 3)
+		{
+			for (int k = 0; k < 3; k++)
+			{
+				const uint a = cornerPosition(i + k);
+				const uint b = cornerPosition(i + (k + 1) % 3);
+				edges.emplace_back(std::min(a, b), std::max(a, b));
+			}
+		}
+
+		std::sort(edges.begin(), edges.end());
+		edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+
+		// the cheaper direction of each edge, with the error as squared distance
+		collapses.clear();
+
+		for (const auto& e : edges)
+		{
+			Quadric q = quadrics[e.first];
+			q += quadrics[e.second];
+
+			const double weight = std::max(q.weight, std::numeric_limits<double>::min());
+			const double toSecond = q.evaluate(positions[e.second]) / weight;
+			const double toFirst = q.evaluate(positions[e.first]) / weight;
+
+			if (toSecond <= toFirst)
+				collapses.push_back({ e.first, e.second, toSecond });
+			else
+				collapses.push_back({ e.second, e.first, toFirst });
+		}
+
+		std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) { return a.error < b.error; });
+
+		std::iota(collapseTarget.begin(), collapseTarget.end(), 0);
+		std::fill(locked.begin(), locked.end(), false);
+
+		std::size_t remainingTriangles = triangleCount;
+		std::size_t collapseCount = 0;
+
+		for (const auto& collapse : collapses)
+		{
+			if (remainingTriangles * 3 <= targetIndexCount || collapse.error > maximumSquaredError)
+				break;
+
+			if (locked[collapse.from] || locked[collapse.to])
+				continue;
+
+			// triangles around the removed position must not flip or become degenerate
+			bool valid = true;
+			std::size_t removedTriangles = 0;
+
+			for (uint a = adjacencyOffsets[collapse.from]; a < adjacencyOffsets[collapse.from + 1] && valid; a++)
+			{
+				const std::size_t t = adjacency[a] * std::size_t(3);
+				uint p[3] = { cornerPosition(t), cornerPosition(t + 1), cornerPosition(t + 2) };
+
+				if (p[0] == collapse.to || p[1] == collapse.to || p[2] == collapse.to)
+				{
+					removedTriangles++;
+					continue;
+				}
+
+				const dvec3 before = triangleNormal(positions[p[0]], positions[p[1]], positions[p[2]]);
+
+				for (auto& v : p)
+				{
+					if (v == collapse.from)
+						v = collapse.to;
+				}
+
+				const dvec3 after = triangleNormal(positions[p[0]], positions[p[1]], positions[p[2]]);
+
+				if (dot(before, after) <= 0.0 || length(after) <= 1e-3 * length(before))
+					valid = false;
+			}
+
+			if (!valid)
+				continue;
+
+			// the neighborhood of the removed position is left unchanged for the rest of this pass
+			for (uint a = adjacencyOffsets[collapse.from]; a < adjacencyOffsets[collapse.from + 1]; a++)
+			{
+				const std::size_t t = adjacency[a] * std::size_t(3);
+
+				for (int k = 0; k < 3; k++)
+					locked[cornerPosition(t + k)] = true;
+			}
+
+			collapseTarget[collapse.from] = collapse.to;
+			quadrics[collapse.to] += quadrics[collapse.from];
+			largestError = std::max(largestError, collapse.error);
+			remainingTriangles -= std::min(remainingTriangles, removedTriangles);
+			collapseCount++;
+		}
+
+		if (collapseCount == 0)
+			break;
+
+		// corners at removed positions use the vertex representing the position they were moved to
+		std::size_t kept = 0;
+
+		for (std::size_t i = 0; i < corners.size(); i += 3)
+		{
+			uint triangle[3];
+
+			for (int k = 0; k < 3; k++)
+			{
+				const uint position = cornerPosition(i + k);
+				triangle[k] = collapseTarget[position] == position ? corners[i + k] : representative[collapseTarget[position]];
+			}
+
+			const uint a = vertexPosition[triangle[0]], b = vertexPosition[triangle[1]], c = vertexPosition[triangle[2]];
+
+			if (a != b && b != c && a != c)
+			{
+				corners[kept++] = triangle[0];
+				corners[kept++] = triangle[1];
+				corners[kept++] = triangle[2];
+			}
+		}
+
+		corners.resize(kept);
+	}
+
+	error = float(std::sqrt(largestError));
+
+	std::vector<uint> result(corners.size());
+
+	for (std::size_t i = 0; i < corners.size(); i++)
+		result[i] = localVertices[corners[i]];
+
+	return result;
+}
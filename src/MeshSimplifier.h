@@ -0,0 +1,17 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <vector>
+
+namespace minity
+{
+	struct Vertex;
+
+	// simplifies a triangle list by collapsing edges onto existing vertices in the order of their quadric error (Garland and
+	// Heckbert), until at most the target number of indices remains or further collapses would exceed the maximum error
+	// vertices at the same position are collapsed together, so that seams of normals or texture coordinates stay closed
+	// returns the new indices, which refer to the same vertices, and the largest distance to the input surface in error
+	std::vector<glm::uint> simplifyMesh(const glm::uint* indices, std::size_t indexCount, const Vertex* vertices, std::size_t targetIndexCount, float maximumError, float& error);
+}
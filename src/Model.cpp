@@ -14,6 +14,20 @@
 #include <cctype>
 #include <locale>
 #include <filesystem>
+#include <charconv>
+#include <chrono>
+#include <cstring>
+#include <string_view>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <deque>
+#include <map>
+#include <functional>
+#include <condition_variable>
+#include <memory_resource>
+#include <cstdint>
+#include <cstddef>
 #include <globjects/globjects.h>
 #include <globjects/logging.h>
 
@@ -22,6 +36,19 @@
 
 #define GLM_ENABLE_EXPERIMENTAL
 #include <glm/gtx/string_cast.hpp>
+#include <glm/gtc/packing.hpp>
+
+#include "MappedFile.h"
+#include "ModelCache.h"
+#include "MemoryUsage.h"
+#include "ThreadPool.h"
+#include "TextureCache.h"
+#include "TextureImage.h"
+#include "TextureFile.h"
+#include "TextureEncoder.h"
+#include "TextureStreamer.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
 
 using namespace minity;
 using namespace gl;
@@ -51,6 +78,63 @@ std::string trim(const std::string &str, const std::string &whitespace = "\n\r\t
 	return trimRight(trimLeft(str, whitespace), whitespace);
 }
 
+// helpers for the mapped parser, which works on character ranges instead of streams
+bool isWhitespace(char c)
+{
+	return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\v' || c == '\f';
+}
+
+const char *skipWhitespace(const char *first, const char *last)
+{
+	while (first != last && isWhitespace(*first))
+		first++;
+
+	return first;
+}
+
+const char *skipToken(const char *first, const char *last)
+{
+	while (first != last && !isWhitespace(*first))
+		first++;
+
+	return first;
+}
+
+template <class T>
+bool parseNumber(const char *&first, const char *last, T &value)
+{
+	const char *begin = skipWhitespace(first, last);
+
+	// std::from_chars does not accept an explicit plus sign, but the stream operators do
+	if (begin != last && *begin == '+' && begin + 1 != last && *(begin + 1) != '-')
+		begin++;
+
+	const std::from_chars_result result = std::from_chars(begin, last, value);
+
+	if (result.ec != std::errc())
+		return false;
+
+	first = result.ptr;
+	return true;
+}
+
+bool parseLiteral(const char *&first, const char *last, const char *literal)
+{
+	const char *begin = skipWhitespace(first, last);
+	const std::size_t length = std::strlen(literal);
+
+	if (std::size_t(last - begin) < length || std::strncmp(begin, literal, length) != 0)
+		return false;
+
+	first = begin + length;
+	return true;
+}
+
+uint resolveIndex(int index, std::size_t count)
+{
+	return index < 0 ? (uint)(index + count) : (uint)(index);
+}
+
 template <class e, class t, int N>
 std::basic_istream<e, t> &operator>>(std::basic_istream<e, t> &in, const e (&sliteral)[N])
 {
@@ -80,18 +164,450 @@ std::basic_istream<e, t> &operator>>(std::basic_istream<e, t> &in, e (&carray)[N
 	return std::operator>>(in, carray);
 }
 
+// can be called from several threads at once, so the images are flipped here instead of using the global flag of stb_image
+TextureImage decodeTexture(const std::string &filename)
+{
+	TextureImage image;
+	unsigned char *data = stbi_load(filename.c_str(), &image.width, &image.height, &image.channels, 0);
+
+	if (data)
+	{
+		std::cout << "Loaded " << filename << std::endl;
+		image.data = std::shared_ptr<const unsigned char>(data, stbi_image_free);
+		image.levelOffsets.push_back(0);
+
+		// OpenGL expects the first row at the bottom
+		const std::size_t rowSize = std::size_t(image.width) * std::size_t(image.channels);
+
+		for (int y = 0; y < image.height / 2; y++)
+		{
+			unsigned char *top = data + std::size_t(y) * rowSize;
+			unsigned char *bottom = data + std::size_t(image.height - 1 - y) * rowSize;
+			std::swap_ranges(top, top + rowSize, bottom);
+		}
+	}
+
+	return image;
+}
+
+// maps the image and its mip chain from a texture cache file, or decodes it, builds the mip chain on the CPU and writes the cache file
+TextureImage loadTexture(const std::string &filename, const LoadOptions &options, TextureUsage usage, ThreadPool *pool)
+{
+	// the compression format depends on the usage, so each usage has its own cache file
+	static const std::array<std::string, 3> usageNames = { "color", "scalar", "bump" };
+
+	TextureFile file(filename, options.cacheDirectory, options.compressTextures ? usageNames[std::size_t(usage)] : std::string());
+
+	if (options.cache && file.read())
+		return file.image();
+
+	TextureImage image = decodeTexture(filename);
+	image.generateMipmaps();
+
+	if (options.compressTextures && image.data)
+		image = compressTexture(image, chooseTextureCompression(image, usage), pool);
+
+	if (options.cache && image.data && !file.write(image))
+		globjects::debug() << "Could not write texture cache file " << file.cacheFilename();
+
+	return image;
+}
+
+// splits a complete group into meshlets of consecutive triangles, which are spatially coherent once the triangles are optimized
+void computeMeshlets(Group &group, const Vertex *vertices, const uint *indices, std::vector<Meshlet> &meshlets)
+{
+	group.firstMeshlet = uint(meshlets.size());
+
+	std::array<vec3, Meshlet::maximumTriangleCount> normals;
+
+	for (uint start = group.startIndex; start + 2 < group.endIndex; start += Meshlet::maximumTriangleCount * 3)
+	{
+		Meshlet meshlet;
+		meshlet.startIndex = start;
+		meshlet.indexCount = std::min(Meshlet::maximumTriangleCount * 3, (group.endIndex - start) / 3 * 3);
+
+		const uint end = start + meshlet.indexCount;
+		vec3 minimumBounds(std::numeric_limits<float>::max());
+		vec3 maximumBounds(-std::numeric_limits<float>::max());
+		vec3 normalSum(0.0f);
+
+		for (uint i = start; i < end; i += 3)
+		{
+			const vec3 &a = vertices[indices[i]].position;
+			const vec3 &b = vertices[indices[i + 1]].position;
+			const vec3 &c = vertices[indices[i + 2]].position;
+
+			minimumBounds = min(minimumBounds, min(a, min(b, c)));
+			maximumBounds = max(maximumBounds, max(a, max(b, c)));
+
+			// degenerate triangles have no normal and do not restrict the cone
+			const vec3 normal = cross(b - a, c - a);
+			const float normalLength = length(normal);
+			normals[(i - start) / 3] = normalLength > 0.0f ? normal / normalLength : vec3(0.0f);
+			normalSum += normals[(i - start) / 3];
+		}
+
+		const vec3 center = 0.5f * (minimumBounds + maximumBounds);
+		float radiusSquared = 0.0f;
+
+		for (uint i = start; i < end; i++)
+		{
+			const vec3 offset = vertices[indices[i]].position - center;
+			radiusSquared = std::max(radiusSquared, dot(offset, offset));
+		}
+
+		meshlet.boundingSphereCenter = center;
+		meshlet.boundingSphereRadius = std::sqrt(radiusSquared);
+
+		const float axisLength = length(normalSum);
+
+		if (axisLength > 0.0f)
+		{
+			const vec3 axis = normalSum / axisLength;
+			float minimumDot = 1.0f;
+
+			for (uint t = 0; t < meshlet.indexCount / 3; t++)
+			{
+				if (normals[t] != vec3(0.0f))
+					minimumDot = std::min(minimumDot, dot(normals[t], axis));
+			}
+
+			// cones wider than about 84 degrees leave too few viewing directions for culling
+			if (minimumDot > 0.1f)
+			{
+				meshlet.coneAxis = axis;
+				meshlet.coneCutoff = std::sqrt(1.0f - minimumDot * minimumDot);
+			}
+		}
+
+		meshlets.push_back(meshlet);
+	}
+
+	group.meshletCount = uint(meshlets.size()) - group.firstMeshlet;
+}
+
+// positions are mapped from the given offset and inverse scale to the unit cube and quantized to 16 bits
+PackedVertex packVertex(const Vertex &vertex, const vec3 &positionOffset, const vec3 &inverseScale)
+{
+	PackedVertex packed;
+
+	const vec3 position = clamp((vertex.position - positionOffset) * inverseScale, vec3(0.0f), vec3(1.0f)) * 65535.0f + 0.5f;
+	packed.position[0] = std::uint16_t(position.x);
+	packed.position[1] = std::uint16_t(position.y);
+	packed.position[2] = std::uint16_t(position.z);
+	packed.position[3] = 0;
+
+	// the normal is projected onto the octahedron and the lower half is folded over the upper one
+	const vec3 &n = vertex.normal;
+	const float sum = abs(n.x) + abs(n.y) + abs(n.z);
+	vec2 octahedral = sum > 0.0f ? vec2(n.x, n.y) / sum : vec2(0.0f);
+
+	if (n.z < 0.0f)
+	{
+		const vec2 signs(octahedral.x >= 0.0f ? 1.0f : -1.0f, octahedral.y >= 0.0f ? 1.0f : -1.0f);
+		octahedral = (vec2(1.0f) - abs(vec2(octahedral.y, octahedral.x))) * signs;
+	}
+
+	octahedral = round(clamp(octahedral, vec2(-1.0f), vec2(1.0f)) * 32767.0f);
+	packed.normal[0] = std::int16_t(octahedral.x);
+	packed.normal[1] = std::int16_t(octahedral.y);
+
+	packed.texcoord[0] = packHalf1x16(vertex.texcoord.x);
+	packed.texcoord[1] = packHalf1x16(vertex.texcoord.y);
+
+	return packed;
+}
+
+// bounds, bounding sphere and texture coordinate density of a complete group
+void computeGroupBounds(Group &group, const Vertex *vertices, const uint *indices)
+{
+	vec3 minimumBounds(std::numeric_limits<float>::max());
+	vec3 maximumBounds(-std::numeric_limits<float>::max());
+	double area = 0.0;
+	double texCoordArea = 0.0;
+
+	for (uint i = group.startIndex; i + 2 < group.endIndex; i += 3)
+	{
+		const Vertex &a = vertices[indices[i]];
+		const Vertex &b = vertices[indices[i + 1]];
+		const Vertex &c = vertices[indices[i + 2]];
+
+		minimumBounds = min(minimumBounds, min(a.position, min(b.position, c.position)));
+		maximumBounds = max(maximumBounds, max(a.position, max(b.position, c.position)));
+
+		const vec2 u = b.texcoord - a.texcoord;
+		const vec2 v = c.texcoord - a.texcoord;
+		area += double(length(cross(b.position - a.position, c.position - a.position)));
+		texCoordArea += double(abs(u.x * v.y - u.y * v.x));
+	}
+
+	if (group.endIndex < group.startIndex + 3)
+		return;
+
+	group.minimumBounds = minimumBounds;
+	group.maximumBounds = maximumBounds;
+
+	// tighter than the half diagonal of the bounds, since vertices rarely lie in the corners
+	const vec3 center = 0.5f * (minimumBounds + maximumBounds);
+	float radiusSquared = 0.0f;
+
+	for (uint i = group.startIndex; i < group.endIndex; i++)
+	{
+		const vec3 offset = vertices[indices[i]].position - center;
+		radiusSquared = std::max(radiusSquared, dot(offset, offset));
+	}
+
+	group.boundingSphereCenter = center;
+	group.boundingSphereRadius = std::sqrt(radiusSquared);
+	group.texCoordDensity = area > 0.0 ? float(std::sqrt(texCoordArea / area)) : 0.0f;
+}
+
+// appends data to a buffer and grows its storage if necessary, returns true if the buffer object has been replaced
+bool appendToBuffer(std::unique_ptr<Buffer> &buffer, std::size_t &capacity, std::size_t size, const void *data, std::size_t dataSize)
+{
+	static constexpr std::size_t minimumCapacity = 1024 * 1024;
+
+	bool replaced = false;
+
+	if (size + dataSize > capacity)
+	{
+		const std::size_t newCapacity = std::max(std::max(size + dataSize, capacity * 2), minimumCapacity);
+
+		auto newBuffer = std::make_unique<Buffer>();
+		newBuffer->setData(GLsizeiptr(newCapacity), nullptr, GL_STATIC_DRAW);
+
+		if (size > 0)
+			buffer->copySubData(newBuffer.get(), 0, 0, GLsizeiptr(size));
+
+		buffer = std::move(newBuffer);
+		capacity = newCapacity;
+		replaced = true;
+	}
+
+	if (dataSize > 0)
+		buffer->setSubData(GLintptr(size), GLsizeiptr(dataSize), data);
+
+	return replaced;
+}
+
+// splits the range [0, count) into contiguous parts that are processed by separate threads, zero threads uses all hardware threads
+void parallelFor(std::size_t count, uint threadCount, const std::function<void(std::size_t begin, std::size_t end)> &function)
+{
+	// ranges smaller than this are not worth a thread of their own
+	static constexpr std::size_t minimumRangeSize = 64 * 1024;
+
+	if (threadCount == 0)
+		threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+	const std::size_t rangeCount = std::max(std::size_t(1), std::min(std::size_t(threadCount), count / minimumRangeSize));
+	std::vector<std::thread> threads;
+	threads.reserve(rangeCount - 1);
+
+	for (std::size_t i = 1; i < rangeCount; i++)
+		threads.emplace_back(function, count * i / rangeCount, count * (i + 1) / rangeCount);
+
+	function(0, count / rangeCount);
+
+	for (auto &t : threads)
+		t.join();
+}
+
+template <class T>
+void atomicMax(std::atomic<T> &value, T candidate)
+{
+	T current = value.load(std::memory_order_relaxed);
+
+	while (current < candidate && !value.compare_exchange_weak(current, candidate, std::memory_order_relaxed))
+		;
+}
+
+double megabytes(std::size_t bytes)
+{
+	return double(bytes) / (1024.0 * 1024.0);
+}
+
+void reportVertexCache(const VertexCacheStatistics &originalStatistics, const VertexCacheStatistics &optimizedStatistics)
+{
+	globjects::debug() << "Vertex cache (" << vertexCacheSize << " entries): ACMR " << originalStatistics.acmr() << " -> " << optimizedStatistics.acmr() << ", ATVR " << originalStatistics.atvr() << " -> " << optimizedStatistics.atvr();
+}
+
+// memory resource that keeps track of the memory requested through it, so that the temporary memory of a load can be reported
+class CountingMemoryResource : public std::pmr::memory_resource
+{
+public:
+	CountingMemoryResource(std::pmr::memory_resource *upstream = std::pmr::new_delete_resource()) : m_upstream(upstream)
+	{
+	}
+
+	std::size_t size() const
+	{
+		return m_size;
+	}
+
+	std::size_t peakSize() const
+	{
+		return m_peakSize;
+	}
+
+private:
+	void *do_allocate(std::size_t bytes, std::size_t alignment) override
+	{
+		void *p = m_upstream->allocate(bytes, alignment);
+		atomicMax(m_peakSize, m_size += bytes);
+		return p;
+	}
+
+	void do_deallocate(void *p, std::size_t bytes, std::size_t alignment) override
+	{
+		m_upstream->deallocate(p, bytes, alignment);
+		m_size -= bytes;
+	}
+
+	bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override
+	{
+		return this == &other;
+	}
+
+	std::pmr::memory_resource *m_upstream;
+	std::atomic<std::size_t> m_size = 0;
+	std::atomic<std::size_t> m_peakSize = 0;
+};
+
+// open addressing hash table mapping combinations of position, texture coordinate and normal indices to vertex indices
+class VertexTable
+{
+public:
+	VertexTable(std::size_t expectedSize)
+	{
+		std::size_t capacity = 16;
+
+		while (capacity < expectedSize * 2)
+			capacity *= 2;
+
+		m_entries.resize(capacity);
+	}
+
+	// returns the vertex index stored for the given combination, or stores and returns newIndex if there is none yet
+	uint insert(uint position, uint texCoord, uint normal, uint newIndex)
+	{
+		// the load factor is kept below one half, so that probe sequences stay short
+		if ((m_size + 1) * 2 > m_entries.size())
+			grow();
+
+		const std::size_t mask = m_entries.size() - 1;
+		std::size_t slot = hash(position, texCoord, normal) & mask;
+
+		while (true)
+		{
+			Entry &entry = m_entries[slot];
+
+			if (entry.vertex == emptyEntry)
+			{
+				entry.position = position;
+				entry.texCoord = texCoord;
+				entry.normal = normal;
+				entry.vertex = newIndex;
+				m_size++;
+				return newIndex;
+			}
+
+			if (entry.position == position && entry.texCoord == texCoord && entry.normal == normal)
+				return entry.vertex;
+
+			slot = (slot + 1) & mask;
+		}
+	}
+
+	std::size_t size() const
+	{
+		return m_size;
+	}
+
+private:
+	static constexpr uint emptyEntry = std::numeric_limits<uint>::max();
+
+	struct Entry
+	{
+		uint position = 0;
+		uint texCoord = 0;
+		uint normal = 0;
+		uint vertex = emptyEntry;
+	};
+
+	static std::size_t hash(uint position, uint texCoord, uint normal)
+	{
+		std::uint64_t h = position;
+		h = h * 0x9E3779B97F4A7C15ull + texCoord;
+		h = h * 0x9E3779B97F4A7C15ull + normal;
+
+		// finalizer of MurmurHash3
+		h ^= h >> 33;
+		h *= 0xFF51AFD7ED558CCDull;
+		h ^= h >> 33;
+		h *= 0xC4CEB9FE1A85EC53ull;
+		h ^= h >> 33;
+
+		return std::size_t(h);
+	}
+
+	void grow()
+	{
+		std::vector<Entry> entries(m_entries.size() * 2);
+		const std::size_t mask = entries.size() - 1;
+
+		for (const auto &e : m_entries)
+		{
+			if (e.vertex != emptyEntry)
+			{
+				std::size_t slot = hash(e.position, e.texCoord, e.normal) & mask;
+
+				while (entries[slot].vertex != emptyEntry)
+					slot = (slot + 1) & mask;
+
+				entries[slot] = e;
+			}
+		}
+
+		m_entries.swap(entries);
+	}
+
+	std::vector<Entry> m_entries;
+	std::size_t m_size = 0;
+};
+
 class ObjLoader
 {
 public:
+	// receives the current stage and its progress, may be called from several threads at once, returning false cancels loading
+	using ProgressCallback = std::function<bool(const char *stage, float progress)>;
+	// called whenever more of the final geometry is available through groups(), vertices(), indices() and materials()
+	using GeometryCallback = std::function<void()>;
+
+	void setProgressCallback(const ProgressCallback &callback)
+	{
+		m_progressCallback = callback;
+	}
+
+	void setGeometryCallback(const GeometryCallback &callback)
+	{
+		m_geometryCallback = callback;
+	}
+
 	struct ObjGroup
 	{
+		ObjGroup(std::pmr::memory_resource *resource) : positionIndices(resource), normalIndices(resource), texCoordIndices(resource)
+		{
+		}
+
 		std::string name;
 		std::string material;
-		std::vector<uint> positionIndices;
-		std::vector<uint> normalIndices;
-		std::vector<uint> texCoordIndices;
+		std::pmr::vector<uint> positionIndices;
+		std::pmr::vector<uint> normalIndices;
+		std::pmr::vector<uint> texCoordIndices;
 	};
 
+	using ObjGroupList = std::pmr::list<ObjGroup>;
+
 	struct ObjMaterial
 	{
 		// Material Name
@@ -122,841 +638,2637 @@ public:
 		std::string map_bump;
 	};
 
-	bool loadObjFile(const std::string &filename)
+	struct ObjState
 	{
-		std::filesystem::path path(filename);
-		std::ifstream is(filename);
-
-		if (!is.is_open())
-			return false;
+		// all temporaries of a load come from the arena and are released at once together with the state
+		CountingMemoryResource memory;
+		std::pmr::monotonic_buffer_resource arena{&memory};
 
-		std::vector<vec3> positions;
-		std::vector<vec3> normals;
-		std::vector<vec2> texCoords;
+		std::filesystem::path path;
 
-		positions.push_back(vec3(0.0f));
-		normals.push_back(vec3(0.0f));
-		texCoords.push_back(vec2(1.0f));
+		std::pmr::vector<vec3> positions{&arena};
+		std::pmr::vector<vec3> normals{&arena};
+		std::pmr::vector<vec2> texCoords{&arena};
 
 		std::unordered_map<std::string, int> materialMap;
 		std::vector<ObjMaterial> materials;
+		std::string currentMaterial;
+
+		std::unordered_map<std::string, ObjGroupList::iterator> groupMap;
+		ObjGroupList groupList{&arena};
+		ObjGroupList::iterator groupIterator;
+	};
+
+	bool loadObjFile(const std::string &filename, ObjParser parser = ObjParser::Mapped, uint threadCount = 0, bool optimize = true, bool buildMeshlets = true)
+	{
+		std::filesystem::path path(filename);
+
+		ObjState state;
+		state.path = path;
+
+		state.positions.push_back(vec3(0.0f));
+		state.normals.push_back(vec3(0.0f));
+		state.texCoords.push_back(vec2(1.0f));
 
 		ObjMaterial defaultMaterial;
 		defaultMaterial.name = "default";
 
-		materialMap.insert(std::make_pair(defaultMaterial.name, int(materials.size())));
-		materials.push_back(defaultMaterial);
+		state.materialMap.insert(std::make_pair(defaultMaterial.name, int(state.materials.size())));
+		state.materials.push_back(defaultMaterial);
 
-		std::string currentMaterial;
-		currentMaterial = defaultMaterial.name;
-
-		std::unordered_map<std::string, typename std::list<ObjGroup>::iterator> groupMap;
-		std::list<ObjGroup> groupList;
-		std::list<ObjGroup>::iterator groupIterator;
+		state.currentMaterial = defaultMaterial.name;
 
-		ObjGroup defaultGroup;
+		ObjGroup &defaultGroup = state.groupList.emplace_back(&state.arena);
 		defaultGroup.name = "default";
-		defaultGroup.material = currentMaterial;
-		groupList.push_back(defaultGroup);
-		groupIterator = groupList.end();
-		groupIterator--;
-		groupMap[defaultGroup.name] = groupIterator;
+		defaultGroup.material = state.currentMaterial;
+		state.groupIterator = state.groupList.end();
+		state.groupIterator--;
+		state.groupMap[defaultGroup.name] = state.groupIterator;
 
-		std::string buffer;
+		const auto parseStart = std::chrono::steady_clock::now();
 
-		while (is.good())
+		if (parser == ObjParser::Stream)
 		{
-			if (getline(is, buffer))
-			{
-				std::istringstream iss(buffer);
-				std::string token;
+			if (!parseObjStream(path, state))
+				return false;
+		}
+		else
+		{
+			if (!parseObjMapped(path, state, threadCount))
+				return false;
+		}
 
-				if (iss >> token)
-				{
-					switch (token.at(0))
-					{
-						// v, vn, vt
-					case 'v':
-					{
-						if (token == "v")
-						{
-							vec3 p(0.0f);
+		if (m_cancelled)
+			return false;
 
-							if (iss >> p.x >> p.y >> p.z)
-								positions.push_back(p);
-						}
-						else if (token == "vn")
-						{
-							vec3 n(0.0f);
+		const std::chrono::duration<double> parseTime = std::chrono::steady_clock::now() - parseStart;
+		const double fileSize = double(std::filesystem::file_size(path)) / (1024.0 * 1024.0);
 
-							if (iss >> n.x >> n.y >> n.z)
-								normals.push_back(n);
-						}
-						else if (token == "vt")
-						{
-							vec2 t(0.0f);
+		globjects::debug() << "Parsed " << filename << " using the " << (parser == ObjParser::Stream ? "stream" : "mapped") << " parser in " << parseTime.count() << " s (" << fileSize / parseTime.count() << " MB/s)";
 
-							if (iss >> t.x >> t.y)
-								texCoords.push_back(t);
-						}
-					}
-					break;
+		std::pmr::vector<vec3> &positions = state.positions;
+		std::pmr::vector<vec3> &normals = state.normals;
+		std::pmr::vector<vec2> &texCoords = state.texCoords;
+		std::unordered_map<std::string, int> &materialMap = state.materialMap;
+		std::vector<ObjMaterial> &materials = state.materials;
+		ObjGroupList &groupList = state.groupList;
+		if (materials.size() <= 1)
+		{
+			std::filesystem::path libraryPath = path;
+			libraryPath.replace_extension("mtl");
+			loadMtlFile(libraryPath.string(), materials, materialMap);
+		}
 
-					// mtllib
-					case 'm':
-					{
-						// the Wavefront obj specification does not really allow for spaces in the mtl file name,
-						// since multiple libraries are supposed to be separated by spaces, but many programs
-						// do not take care of that -- therefore, we first try whether it is a single filename,
-						// and only if that fails we use the interpretation according to the specification
-						std::string libraryName;
+		// compute normals if not present in the file
+		if (normals.size() <= 1)
+		{
+			if (!reportProgress("Computing normals", 0.0f))
+				return false;
 
-						if (getline(iss, libraryName))
-						{
-							libraryName = trim(libraryName);
-							std::filesystem::path libraryPath = libraryName;
+			computeNormals(state, threadCount);
+		}
 
-							// first try
-							if (libraryPath.is_absolute())
-							{
-								if (loadMtlFile(libraryPath.string(), materials, materialMap))
-									break;
-							}
+		m_materials.reserve(materials.size());
 
-							std::stringstream mss(libraryName);
+		for (auto &m : materials)
+		{
+			Material newMaterial;
+			newMaterial.name = m.name;
+			newMaterial.ambient = m.Ka;
+			newMaterial.diffuse = m.Kd;
+			newMaterial.specular = m.Ks;
+			newMaterial.shininess = m.Ns;
 
-							while (mss >> libraryName)
-							{
-								libraryName = trim(libraryName);
-								std::filesystem::path libraryPath = path.parent_path();
-								libraryPath.append(libraryName);
-								loadMtlFile(libraryPath.string(), materials, materialMap);
-							}
-						}
+			if (!m.map_Ka.empty())
+			{
+				std::filesystem::path texturePath = m.map_Ka;
+
+				if (!texturePath.is_absolute())
+				{
+					texturePath = path.parent_path();
+					texturePath.append(m.map_Ka);
+				}
+
+				newMaterial.ambientTextureFilename = texturePath.string();
+			}
+
+			if (!m.map_Kd.empty())
+			{
+				std::filesystem::path texturePath = m.map_Kd;
+
+				if (!texturePath.is_absolute())
+				{
+					texturePath = path.parent_path();
+					texturePath.append(m.map_Kd);
+				}
+
+				newMaterial.diffuseTextureFilename = texturePath.string();
+			}
+
+			if (!m.map_Ks.empty())
+			{
+				std::filesystem::path texturePath = m.map_Ks;
+
+				if (!texturePath.is_absolute())
+				{
+					texturePath = path.parent_path();
+					texturePath.append(m.map_Ks);
+				}
+
+				newMaterial.specularTextureFilename = texturePath.string();
+			}
+
+			if (!m.map_Ns.empty())
+			{
+				std::filesystem::path texturePath = m.map_Ns;
+
+				if (!texturePath.is_absolute())
+				{
+					texturePath = path.parent_path();
+					texturePath.append(m.map_Ns);
+				}
+
+				newMaterial.shininessTextureFilename = texturePath.string();
+			}
+
+			if (!m.map_bump.empty())
+			{
+				std::filesystem::path texturePath = m.map_bump;
+
+				if (!texturePath.is_absolute())
+				{
+					texturePath = path.parent_path();
+					texturePath.append(m.map_bump);
+				}
+
+				newMaterial.bumpTextureFilename = texturePath.string();
+			}
+
+			m_materials.push_back(newMaterial);
+		}
+
+		// bounds of all positions, which are known before the first vertex is handed out, the first one is a placeholder
+		m_minimumBounds = positions.size() > 1 ? positions[1] : vec3(0.0f);
+		m_maximumBounds = m_minimumBounds;
+
+		for (std::size_t i = 2; i < positions.size(); i++)
+		{
+			m_minimumBounds = min(m_minimumBounds, positions[i]);
+			m_maximumBounds = max(m_maximumBounds, positions[i]);
+		}
+
+		// vertices are shared between all faces that use the same combination of position, texture coordinate and normal
+		VertexTable vertexTable(positions.size());
+		std::size_t faceVertexCount = 0;
+		std::size_t totalFaceVertexCount = 0;
+
+		for (const auto &g : groupList)
+			totalFaceVertexCount += g.positionIndices.size();
+
+		m_vertices.reserve(positions.size());
+		m_indices.reserve(totalFaceVertexCount);
+		m_groups.reserve(groupList.size());
+
+		// new index of each vertex after the vertices of its group have been reordered by first use
+		std::pmr::vector<uint> vertexRemap(&state.arena);
+		const auto optimizeStart = std::chrono::steady_clock::now();
+
+		for (ObjGroupList::iterator i = groupList.begin(); i != groupList.end(); i++)
+		{
+			if (i->positionIndices.size() > 0)
+			{
+				Group newGroup;
+				newGroup.name = i->name;
+				newGroup.startIndex = uint(m_indices.size());
+
+				std::unordered_map<std::string, int>::iterator j = materialMap.find(i->material);
+
+				if (j != materialMap.end())
+					newGroup.materialIndex = j->second;
+				else
+					newGroup.materialIndex = 0;
+
+				// the group is added before it is complete, so that partial geometry can be handed out while it grows
+				m_groups.push_back(newGroup);
+				Group &group = m_groups.back();
+				const std::size_t groupFirstVertex = m_vertices.size();
+
+				for (uint j = 0; j < i->positionIndices.size(); j++)
+				{
+					const uint positionIndex = i->positionIndices[j];
+					const uint texCoordIndex = i->texCoordIndices[j];
+					const uint normalIndex = i->normalIndices[j];
+					const uint index = vertexTable.insert(positionIndex, texCoordIndex, normalIndex, uint(m_vertices.size()));
+
+					if (index == m_vertices.size())
+					{
+						Vertex vertex;
+						vertex.position = positions[positionIndex];
+						vertex.normal = normals[normalIndex];
+						vertex.texcoord = texCoords[texCoordIndex];
+						m_vertices.push_back(vertex);
+
+						if (optimize)
+							vertexRemap.push_back(index);
 					}
-					break;
 
-					// use material
-					case 'u':
+					m_indices.push_back(optimize ? vertexRemap[index] : index);
+
+					// optimized groups are only handed out once they are complete, since their triangles and new vertices are reordered
+					if (!optimize && m_indices.size() % geometryBatchSize == 0)
 					{
-						std::string materialName;
+						group.endIndex = uint(m_indices.size());
 
-						if (getline(iss, materialName))
-						{
-							materialName = trim(materialName);
-							currentMaterial = materialName;
-							groupIterator->material = currentMaterial;
-						}
+						if (!publishGeometry(float(m_indices.size()) / float(totalFaceVertexCount)))
+							return false;
 					}
-					break;
+				}
 
-					// group
-					case 'g':
-					case 'o':
-					{
-						std::string groupName;
+				faceVertexCount += i->positionIndices.size();
+				group.endIndex = uint(m_indices.size());
 
-						if (getline(iss, groupName))
-						{
-							groupName = trim(groupName);
-							std::unordered_map<std::string, typename std::list<ObjGroup>::iterator>::iterator j = groupMap.find(groupName);
+				if (optimize)
+				{
+					uint *groupIndices = m_indices.data() + group.startIndex;
+					const std::size_t groupIndexCount = group.endIndex - group.startIndex;
 
-							if (j == groupMap.end())
-							{
-								ObjGroup newGroup;
-								newGroup.name = groupName;
+					m_originalStatistics += analyzeVertexCache(groupIndices, groupIndexCount);
 
-								groupList.push_back(newGroup);
-								groupIterator = groupList.end();
-								groupIterator--;
-							}
-							else
-								groupIterator = j->second;
+					optimizeVertexCache(groupIndices, groupIndexCount);
+					optimizeOverdraw(groupIndices, groupIndexCount, m_vertices.data());
+					optimizeVertexFetch(m_vertices.data(), groupIndices, groupIndexCount, groupFirstVertex, m_vertices.size(), vertexRemap.data());
 
-							groupIterator->material = currentMaterial;
-						}
-					}
+					m_optimizedStatistics += analyzeVertexCache(groupIndices, groupIndexCount);
+				}
+
+				computeGroupBounds(group, m_vertices.data(), m_indices.data());
+
+				if (buildMeshlets)
+					computeMeshlets(group, m_vertices.data(), m_indices.data(), m_meshlets);
+
+				if (!publishGeometry(float(m_indices.size()) / float(totalFaceVertexCount)))
+					return false;
+			}
+		}
+
+		if (optimize)
+		{
+			const std::chrono::duration<double> optimizeTime = std::chrono::steady_clock::now() - optimizeStart;
+			globjects::debug() << "Reordered triangles and vertices of " << m_groups.size() << " groups in " << optimizeTime.count() << " s (including building the vertices)";
+			reportVertexCache(m_originalStatistics, m_optimizedStatistics);
+		}
+
+		globjects::debug() << "Deduplicated " << faceVertexCount << " face vertices (" << positions.size() - 1 << " positions) to " << m_vertices.size() << " vertices";
+		globjects::debug() << "Loader temporaries used " << megabytes(state.memory.peakSize()) << " MB at peak, process memory is " << megabytes(currentMemoryUsage()) << " MB (" << megabytes(peakMemoryUsage()) << " MB at peak)";
+
+		return true;
+	}
+
+	// simplifies every complete group into a chain of levels, each with about a quarter of the triangles of the one before,
+	// and appends their indices behind the indices of all groups
+	bool buildLevelsOfDetail(uint threadCount = 0)
+	{
+		// levels with fewer triangles are not worth switching to
+		static constexpr std::size_t minimumTriangleCount = 32;
+		static constexpr std::size_t maximumLevelCount = 8;
+
+		const auto simplifyStart = std::chrono::steady_clock::now();
+
+		struct Level
+		{
+			std::vector<uint> indices;
+			float error = 0.0f;
+		};
+
+		std::vector<std::vector<Level>> groupLevels(m_groups.size());
+		std::atomic<std::size_t> finishedGroups = 0;
+
+		reportProgress("Building levels of detail", 0.0f);
+
+		ThreadPool pool(threadCount);
+		pool.parallelFor(m_groups.size(), [&](std::size_t g) {
+			const Group &group = m_groups[g];
+			std::vector<uint> previous(m_indices.begin() + group.startIndex, m_indices.begin() + group.endIndex);
+			float error = 0.0f;
+
+			// each level is simplified from the one before, so its error is bounded by the sum of the errors of all steps
+			while (groupLevels[g].size() < maximumLevelCount && !m_cancelled)
+			{
+				const std::size_t targetIndexCount = previous.size() / 12 * 3;
+
+				if (targetIndexCount < minimumTriangleCount * 3)
 					break;
 
-					// face
-					case 'f':
-					{
-						int v = 0, n = 0, t = 0;
+				Level level;
+				level.indices = simplifyMesh(previous.data(), previous.size(), m_vertices.data(), targetIndexCount, std::numeric_limits<float>::max(), level.error);
 
-						if (buffer.find("//") != std::string::npos)
-						{
-							// v//n
-							if (iss >> v >> ("//") >> n)
-							{
-								groupIterator->positionIndices.push_back(v < 0 ? (uint)(v + positions.size()) : (uint)(v));
-								groupIterator->texCoordIndices.push_back(0);
-								groupIterator->normalIndices.push_back(n < 0 ? (uint)(n + normals.size()) : (uint)(n));
-							}
+				// collapses are rejected at borders and where triangles would flip, so some parts can not be reduced much
+				if (level.indices.size() * 4 > previous.size() * 3)
+					break;
 
-							if (iss >> v >> ("//") >> n)
-							{
-								groupIterator->positionIndices.push_back(v < 0 ? (uint)(v + positions.size()) : (uint)(v));
-								groupIterator->texCoordIndices.push_back(0);
-								groupIterator->normalIndices.push_back(n < 0 ? (uint)(n + normals.size()) : (uint)(n));
-							}
+				optimizeVertexCache(level.indices.data(), level.indices.size());
 
-							if (iss >> v >> ("//") >> n)
-							{
-								groupIterator->positionIndices.push_back(v < 0 ? (uint)(v + positions.size()) : (uint)(v));
-								groupIterator->texCoordIndices.push_back(0);
-								groupIterator->normalIndices.push_back(n < 0 ? (uint)(n + normals.size()) : (uint)(n));
-							}
+				error += level.error;
+				level.error = error;
+				previous = level.indices;
+				groupLevels[g].push_back(std::move(level));
+			}
 
-							while (iss >> v >> ("//") >> n)
-							{
-								groupIterator->positionIndices.push_back(groupIterator->positionIndices[groupIterator->positionIndices.size() - 3]);
-								groupIterator->texCoordIndices.push_back(0);
-								groupIterator->normalIndices.push_back(groupIterator->normalIndices[groupIterator->normalIndices.size() - 3]);
+			reportProgress("Building levels of detail", float(++finishedGroups) / float(m_groups.size()));
+		});
 
-								groupIterator->positionIndices.push_back(groupIterator->positionIndices[groupIterator->positionIndices.size() - 2]);
-								groupIterator->texCoordIndices.push_back(0);
-								groupIterator->normalIndices.push_back(groupIterator->normalIndices[groupIterator->normalIndices.size() - 2]);
+		if (m_cancelled)
+			return false;
 
-								groupIterator->positionIndices.push_back(v < 0 ? (uint)(v + positions.size()) : (uint)(v));
-								groupIterator->texCoordIndices.push_back(0);
-								groupIterator->normalIndices.push_back(n < 0 ? (uint)(n + normals.size()) : (uint)(n));
-							}
+		const std::size_t groupIndexCount = m_indices.size();
+		std::size_t levelIndexCount = 0;
 
-							break;
-						}
+		for (const auto &levels : groupLevels)
+		{
+			for (const auto &level : levels)
+				levelIndexCount += level.indices.size();
+		}
 
-						iss = std::istringstream(buffer);
-						iss >> token;
+		m_indices.reserve(groupIndexCount + levelIndexCount);
 
-						if (iss >> v >> ("/") >> t >> ("/") >> n)
-						{
-							// v/t/n
-							groupIterator->positionIndices.push_back(v < 0 ? (uint)(v + positions.size()) : (uint)(v));
-							groupIterator->texCoordIndices.push_back(t < 0 ? (uint)(t + texCoords.size()) : (uint)(t));
-							groupIterator->normalIndices.push_back(n < 0 ? (uint)(n + normals.size()) : (uint)(n));
+		for (std::size_t g = 0; g < m_groups.size(); g++)
+		{
+			m_groups[g].firstLevelOfDetail = uint(m_levelsOfDetail.size());
+			m_groups[g].levelOfDetailCount = uint(groupLevels[g].size());
 
-							if (iss >> v >> ("/") >> t >> ("/") >> n)
-							{
-								groupIterator->positionIndices.push_back(v < 0 ? (uint)(v + positions.size()) : (uint)(v));
-								groupIterator->texCoordIndices.push_back(t < 0 ? (uint)(t + texCoords.size()) : (uint)(t));
-								groupIterator->normalIndices.push_back(n < 0 ? (uint)(n + normals.size()) : (uint)(n));
-							}
+			for (const auto &level : groupLevels[g])
+			{
+				LevelOfDetail levelOfDetail;
+				levelOfDetail.startIndex = uint(m_indices.size());
+				levelOfDetail.indexCount = uint(level.indices.size());
+				levelOfDetail.error = level.error;
+				m_levelsOfDetail.push_back(levelOfDetail);
 
-							if (iss >> v >> ("/") >> t >> ("/") >> n)
-							{
-								groupIterator->positionIndices.push_back(v < 0 ? (uint)(v + positions.size()) : (uint)(v));
-								groupIterator->texCoordIndices.push_back(t < 0 ? (uint)(t + texCoords.size()) : (uint)(t));
-								groupIterator->normalIndices.push_back(n < 0 ? (uint)(n + normals.size()) : (uint)(n));
-							}
+				m_indices.insert(m_indices.end(), level.indices.begin(), level.indices.end());
+			}
+		}
 
-							while (iss >> v >> ("/") >> t >> ("/") >> n)
-							{
-								groupIterator->positionIndices.push_back(groupIterator->positionIndices[groupIterator->positionIndices.size() - 3]);
-								groupIterator->texCoordIndices.push_back(groupIterator->texCoordIndices[groupIterator->texCoordIndices.size() - 3]);
-								groupIterator->normalIndices.push_back(groupIterator->normalIndices[groupIterator->normalIndices.size() - 3]);
+		const std::chrono::duration<double> simplifyTime = std::chrono::steady_clock::now() - simplifyStart;
+		globjects::debug() << "Built " << m_levelsOfDetail.size() << " levels of detail for " << m_groups.size() << " groups in " << simplifyTime.count() << " s, adding " << levelIndexCount / 3 << " triangles (" << (groupIndexCount > 0 ? 100.0 * double(levelIndexCount) / double(groupIndexCount) : 0.0) << "% of the original index memory)";
+
+		return true;
+	}
+
+	// computes vertex normals by accumulating area-weighted face normals, faces are only smoothed within their group
+	// and positions shared by several groups use the normal of the last of them
+	void computeNormals(ObjState &state, uint threadCount)
+	{
+		// number of triangles whose face normals are computed together, so that the cross products can be vectorized
+		static constexpr std::size_t lanes = 8;
+
+		const std::pmr::vector<vec3> &positions = state.positions;
+
+		std::vector<ObjGroup *> groups;
+		std::vector<std::size_t> firstTriangles;
+		std::size_t triangleCount = 0;
+
+		for (auto &g : state.groupList)
+		{
+			if (g.positionIndices.size() >= 3)
+			{
+				groups.push_back(&g);
+				firstTriangles.push_back(triangleCount);
+				triangleCount += g.positionIndices.size() / 3;
+			}
+		}
+
+		firstTriangles.push_back(triangleCount);
+
+		// calls function(group, first, last) for the parts of all groups that fall into the ranges of the threads
+		const auto forEachTriangle = [&](const std::function<void(std::size_t group, std::size_t first, std::size_t last)> &function) {
+			parallelFor(triangleCount, threadCount, [&](std::size_t begin, std::size_t end) {
+				std::size_t g = std::size_t(std::upper_bound(firstTriangles.begin(), firstTriangles.end(), begin) - firstTriangles.begin()) - 1;
+
+				while (begin < end)
+				{
+					const std::size_t groupEnd = std::min(end, firstTriangles[g + 1]);
+					function(g, begin - firstTriangles[g], groupEnd - firstTriangles[g]);
+					begin = groupEnd;
+					g++;
+				}
+			});
+		};
+
+		// one-based index of the last group using each position
+		std::vector<std::atomic<uint>> owners(positions.size());
+
+		forEachTriangle([&](std::size_t group, std::size_t first, std::size_t last) {
+			const std::pmr::vector<uint> &indices = groups[group]->positionIndices;
+
+			for (std::size_t i = first * 3; i < last * 3; i++)
+				atomicMax(owners[indices[i]], uint(group + 1));
+		});
+
+		std::vector<vec3> faceNormals(triangleCount);
+
+		forEachTriangle([&](std::size_t group, std::size_t first, std::size_t last) {
+			const std::pmr::vector<uint> &indices = groups[group]->positionIndices;
+			vec3 *normals = faceNormals.data() + firstTriangles[group];
+
+			for (std::size_t t = first; t < last; t += lanes)
+			{
+				const std::size_t count = std::min(lanes, last - t);
+
+				float ax[lanes], ay[lanes], az[lanes];
+				float bx[lanes], by[lanes], bz[lanes];
+
+				for (std::size_t l = 0; l < lanes; l++)
+				{
+					if (l < count)
+					{
+						const vec3 &p0 = positions[indices[(t + l) * 3 + 0]];
+						const vec3 &p1 = positions[indices[(t + l) * 3 + 1]];
+						const vec3 &p2 = positions[indices[(t + l) * 3 + 2]];
+
+						ax[l] = p2.x - p1.x;
+						ay[l] = p2.y - p1.y;
+						az[l] = p2.z - p1.z;
+						bx[l] = p0.x - p1.x;
+						by[l] = p0.y - p1.y;
+						bz[l] = p0.z - p1.z;
+					}
+					else
+					{
+						ax[l] = ay[l] = az[l] = 0.0f;
+						bx[l] = by[l] = bz[l] = 0.0f;
+					}
+				}
+
+				// the length of the cross product is twice the area of the triangle
+				float nx[lanes], ny[lanes], nz[lanes];
+
+				for (std::size_t l = 0; l < lanes; l++)
+				{
+					nx[l] = ay[l] * bz[l] - az[l] * by[l];
+					ny[l] = az[l] * bx[l] - ax[l] * bz[l];
+					nz[l] = ax[l] * by[l] - ay[l] * bx[l];
+				}
+
+				for (std::size_t l = 0; l < count; l++)
+					normals[t + l] = vec3(nx[l], ny[l], nz[l]);
+			}
+		});
+
+		std::pmr::vector<vec3> vertexNormals(positions.size(), vec3(0.0f), &state.arena);
+
+		// a position only receives the face normals of the group owning it, so the groups are summed up concurrently
+		// while the triangles of each group are added in their order, which keeps the normals the same from run to run
+		ThreadPool pool(threadCount);
+		pool.parallelFor(groups.size(), [&](std::size_t group) {
+			const std::pmr::vector<uint> &indices = groups[group]->positionIndices;
+			const vec3 *normals = faceNormals.data() + firstTriangles[group];
+			const uint owner = uint(group + 1);
+
+			for (std::size_t t = 0; t < firstTriangles[group + 1] - firstTriangles[group]; t++)
+			{
+				for (std::size_t k = 0; k < 3; k++)
+				{
+					const uint index = indices[t * 3 + k];
+
+					if (owners[index].load(std::memory_order_relaxed) == owner)
+						vertexNormals[index] += normals[t];
+				}
+			}
+		});
+
+		owners = std::vector<std::atomic<uint>>();
+		faceNormals = std::vector<vec3>();
+
+		parallelFor(positions.size(), threadCount, [&](std::size_t begin, std::size_t end) {
+			for (std::size_t i = begin; i < end; i++)
+			{
+				const float length = glm::length(vertexNormals[i]);
+
+				if (length > 0.0f)
+					vertexNormals[i] /= length;
+			}
+		});
+
+		for (auto g : groups)
+			g->normalIndices = g->positionIndices;
+
+		state.normals.swap(vertexNormals);
+	}
+
+	bool parseObjStream(const std::filesystem::path &path, ObjState &state)
+	{
+		std::ifstream is(path);
+
+		if (!is.is_open())
+			return false;
+
+		std::pmr::vector<vec3> &positions = state.positions;
+		std::pmr::vector<vec3> &normals = state.normals;
+		std::pmr::vector<vec2> &texCoords = state.texCoords;
+		ObjGroupList::iterator &groupIterator = state.groupIterator;
+
+		const std::size_t fileSize = std::filesystem::file_size(path);
+		std::size_t parsedBytes = 0;
+		std::size_t reportedBytes = 0;
+
+		std::string buffer;
+
+		while (is.good())
+		{
+			if (getline(is, buffer))
+			{
+				parsedBytes += buffer.size() + 1;
+
+				if (parsedBytes - reportedBytes >= progressInterval)
+				{
+					reportedBytes = parsedBytes;
+
+					if (!reportProgress("Parsing", float(parsedBytes) / float(fileSize)))
+						return false;
+				}
+
+				std::istringstream iss(buffer);
+				std::string token;
+
+				if (iss >> token)
+				{
+					switch (token.at(0))
+					{
+						// v, vn, vt
+					case 'v':
+					{
+						if (token == "v")
+						{
+							vec3 p(0.0f);
+
+							if (iss >> p.x >> p.y >> p.z)
+								positions.push_back(p);
+						}
+						else if (token == "vn")
+						{
+							vec3 n(0.0f);
+
+							if (iss >> n.x >> n.y >> n.z)
+								normals.push_back(n);
+						}
+						else if (token == "vt")
+						{
+							vec2 t(0.0f);
+
+							if (iss >> t.x >> t.y)
+								texCoords.push_back(t);
+						}
+					}
+					break;
+
+					// mtllib
+					case 'm':
+					{
+						std::string libraryName;
+
+						if (getline(iss, libraryName))
+							loadMaterialLibraries(state, libraryName);
+					}
+					break;
+
+					// use material
+					case 'u':
+					{
+						std::string materialName;
+
+						if (getline(iss, materialName))
+							useMaterial(state, materialName);
+					}
+					break;
+
+					// group
+					case 'g':
+					case 'o':
+					{
+						std::string groupName;
+
+						if (getline(iss, groupName))
+							beginGroup(state, groupName);
+					}
+					break;
+
+					// face
+					case 'f':
+					{
+						int v = 0, n = 0, t = 0;
+
+						if (buffer.find("//") != std::string::npos)
+						{
+							// v//n
+							if (iss >> v >> ("//") >> n)
+							{
+								groupIterator->positionIndices.push_back(v < 0 ? (uint)(v + positions.size()) : (uint)(v));
+								groupIterator->texCoordIndices.push_back(0);
+								groupIterator->normalIndices.push_back(n < 0 ? (uint)(n + normals.size()) : (uint)(n));
+							}
+
+							if (iss >> v >> ("//") >> n)
+							{
+								groupIterator->positionIndices.push_back(v < 0 ? (uint)(v + positions.size()) : (uint)(v));
+								groupIterator->texCoordIndices.push_back(0);
+								groupIterator->normalIndices.push_back(n < 0 ? (uint)(n + normals.size()) : (uint)(n));
+							}
+
+							if (iss >> v >> ("//") >> n)
+							{
+								groupIterator->positionIndices.push_back(v < 0 ? (uint)(v + positions.size()) : (uint)(v));
+								groupIterator->texCoordIndices.push_back(0);
+								groupIterator->normalIndices.push_back(n < 0 ? (uint)(n + normals.size()) : (uint)(n));
+							}
+
+							while (iss >> v >> ("//") >> n)
+							{
+								groupIterator->positionIndices.push_back(groupIterator->positionIndices[groupIterator->positionIndices.size() - 3]);
+								groupIterator->texCoordIndices.push_back(0);
+								groupIterator->normalIndices.push_back(groupIterator->normalIndices[groupIterator->normalIndices.size() - 3]);
+
+								groupIterator->positionIndices.push_back(groupIterator->positionIndices[groupIterator->positionIndices.size() - 2]);
+								groupIterator->texCoordIndices.push_back(0);
+								groupIterator->normalIndices.push_back(groupIterator->normalIndices[groupIterator->normalIndices.size() - 2]);
+
+								groupIterator->positionIndices.push_back(v < 0 ? (uint)(v + positions.size()) : (uint)(v));
+								groupIterator->texCoordIndices.push_back(0);
+								groupIterator->normalIndices.push_back(n < 0 ? (uint)(n + normals.size()) : (uint)(n));
+							}
+
+							break;
+						}
+
+						iss = std::istringstream(buffer);
+						iss >> token;
+
+						if (iss >> v >> ("/") >> t >> ("/") >> n)
+						{
+							// v/t/n
+							groupIterator->positionIndices.push_back(v < 0 ? (uint)(v + positions.size()) : (uint)(v));
+							groupIterator->texCoordIndices.push_back(t < 0 ? (uint)(t + texCoords.size()) : (uint)(t));
+							groupIterator->normalIndices.push_back(n < 0 ? (uint)(n + normals.size()) : (uint)(n));
+
+							if (iss >> v >> ("/") >> t >> ("/") >> n)
+							{
+								groupIterator->positionIndices.push_back(v < 0 ? (uint)(v + positions.size()) : (uint)(v));
+								groupIterator->texCoordIndices.push_back(t < 0 ? (uint)(t + texCoords.size()) : (uint)(t));
+								groupIterator->normalIndices.push_back(n < 0 ? (uint)(n + normals.size()) : (uint)(n));
+							}
+
+							if (iss >> v >> ("/") >> t >> ("/") >> n)
+							{
+								groupIterator->positionIndices.push_back(v < 0 ? (uint)(v + positions.size()) : (uint)(v));
+								groupIterator->texCoordIndices.push_back(t < 0 ? (uint)(t + texCoords.size()) : (uint)(t));
+								groupIterator->normalIndices.push_back(n < 0 ? (uint)(n + normals.size()) : (uint)(n));
+							}
+
+							while (iss >> v >> ("/") >> t >> ("/") >> n)
+							{
+								groupIterator->positionIndices.push_back(groupIterator->positionIndices[groupIterator->positionIndices.size() - 3]);
+								groupIterator->texCoordIndices.push_back(groupIterator->texCoordIndices[groupIterator->texCoordIndices.size() - 3]);
+								groupIterator->normalIndices.push_back(groupIterator->normalIndices[groupIterator->normalIndices.size() - 3]);
+
+								groupIterator->positionIndices.push_back(groupIterator->positionIndices[groupIterator->positionIndices.size() - 2]);
+								groupIterator->texCoordIndices.push_back(groupIterator->texCoordIndices[groupIterator->texCoordIndices.size() - 2]);
+								groupIterator->normalIndices.push_back(groupIterator->normalIndices[groupIterator->normalIndices.size() - 2]);
+
+								groupIterator->positionIndices.push_back(v < 0 ? (uint)(v + positions.size()) : (uint)(v));
+								groupIterator->texCoordIndices.push_back(t < 0 ? (uint)(t + texCoords.size()) : (uint)(t));
+								groupIterator->normalIndices.push_back(n < 0 ? (uint)(n + normals.size()) : (uint)(n));
+							}
+
+							break;
+						}
+
+						iss = std::istringstream(buffer);
+						iss >> token;
+
+						if (iss >> v >> ("/") >> t)
+						{
+							// v/t
+							groupIterator->positionIndices.push_back(v < 0 ? (uint)(v + positions.size()) : (uint)(v));
+							groupIterator->texCoordIndices.push_back(t < 0 ? (uint)(t + texCoords.size()) : (uint)(t));
+							groupIterator->normalIndices.push_back(0);
+
+							if (iss >> v >> ("/") >> t)
+							{
+								groupIterator->positionIndices.push_back(v < 0 ? (uint)(v + positions.size()) : (uint)(v));
+								groupIterator->texCoordIndices.push_back(t < 0 ? (uint)(t + texCoords.size()) : (uint)(t));
+								groupIterator->normalIndices.push_back(0);
+							}
+
+							if (iss >> v >> ("/") >> t)
+							{
+								groupIterator->positionIndices.push_back(v < 0 ? (uint)(v + positions.size()) : (uint)(v));
+								groupIterator->texCoordIndices.push_back(t < 0 ? (uint)(t + texCoords.size()) : (uint)(t));
+								groupIterator->normalIndices.push_back(0);
+							}
+
+							while (iss >> v >> ("/") >> t)
+							{
+								groupIterator->positionIndices.push_back(groupIterator->positionIndices[groupIterator->positionIndices.size() - 3]);
+								groupIterator->texCoordIndices.push_back(groupIterator->texCoordIndices[groupIterator->texCoordIndices.size() - 3]);
+								groupIterator->normalIndices.push_back(0);
+
+								groupIterator->positionIndices.push_back(groupIterator->positionIndices[groupIterator->positionIndices.size() - 2]);
+								groupIterator->texCoordIndices.push_back(groupIterator->texCoordIndices[groupIterator->texCoordIndices.size() - 2]);
+								groupIterator->normalIndices.push_back(0);
+
+								groupIterator->positionIndices.push_back(v < 0 ? (uint)(v + positions.size()) : (uint)(v));
+								groupIterator->texCoordIndices.push_back(t < 0 ? (uint)(t + texCoords.size()) : (uint)(t));
+								groupIterator->normalIndices.push_back(0);
+							}
+
+							break;
+						}
+						else
+						{
+							iss = std::istringstream(buffer);
+							iss >> token;
+
+							// v
+							if (iss >> v)
+							{
+								groupIterator->positionIndices.push_back(v < 0 ? (uint)(v + positions.size()) : (uint)(v));
+								groupIterator->texCoordIndices.push_back(0);
+								groupIterator->normalIndices.push_back(0);
+							}
+
+							if (iss >> v)
+							{
+								groupIterator->positionIndices.push_back(v < 0 ? (uint)(v + positions.size()) : (uint)(v));
+								groupIterator->texCoordIndices.push_back(0);
+								groupIterator->normalIndices.push_back(0);
+							}
+
+							if (iss >> v)
+							{
+								groupIterator->positionIndices.push_back(v < 0 ? (uint)(v + positions.size()) : (uint)(v));
+								groupIterator->texCoordIndices.push_back(0);
+								groupIterator->normalIndices.push_back(0);
+							}
+
+							while (iss >> v)
+							{
+								groupIterator->positionIndices.push_back(groupIterator->positionIndices[groupIterator->positionIndices.size() - 3]);
+								groupIterator->texCoordIndices.push_back(0);
+								groupIterator->normalIndices.push_back(0);
+
+								groupIterator->positionIndices.push_back(groupIterator->positionIndices[groupIterator->positionIndices.size() - 2]);
+								groupIterator->texCoordIndices.push_back(0);
+								groupIterator->normalIndices.push_back(0);
+
+								groupIterator->positionIndices.push_back(v < 0 ? (uint)(v + positions.size()) : (uint)(v));
+								groupIterator->texCoordIndices.push_back(0);
+								groupIterator->normalIndices.push_back(0);
+							}
+						}
+					}
+					break;
+					}
+				}
+			}
+		}
+
+		return true;
+	}
+
+	// records of a chunk that have to be applied in file order when merging
+	struct ObjRecord
+	{
+		enum class Type
+		{
+			MaterialLibrary,
+			UseMaterial,
+			Group
+		};
+
+		Type type;
+		std::string name;
+		// number of face vertices in the chunk preceding this record
+		std::size_t faceVertexCount = 0;
+	};
+
+	// results of parsing a line-aligned part of the file, with relative indices resolved against the chunk only
+	struct ObjChunk
+	{
+		enum RelativeIndex : unsigned char
+		{
+			RelativePosition = 1,
+			RelativeTexCoord = 2,
+			RelativeNormal = 4
+		};
+
+		ObjChunk(std::pmr::memory_resource *resource) : positions(resource), normals(resource), texCoords(resource), positionIndices(resource), normalIndices(resource), texCoordIndices(resource), relativeIndices(resource)
+		{
+		}
+
+		std::pmr::vector<vec3> positions;
+		std::pmr::vector<vec3> normals;
+		std::pmr::vector<vec2> texCoords;
+
+		std::pmr::vector<uint> positionIndices;
+		std::pmr::vector<uint> normalIndices;
+		std::pmr::vector<uint> texCoordIndices;
+		std::pmr::vector<unsigned char> relativeIndices;
+
+		std::vector<ObjRecord> records;
+	};
+
+	// faces of a chunk between two records, which all belong to the same group
+	struct ObjSegment
+	{
+		ObjGroupList::iterator group;
+		std::size_t begin = 0;
+		std::size_t end = 0;
+	};
+
+	// files smaller than this are not split any further
+	static constexpr std::size_t minimumChunkSize = 4 * 1024 * 1024;
+
+	bool parseObjMapped(const std::filesystem::path &path, ObjState &state, uint threadCount)
+	{
+		MappedFile file;
+
+		if (!file.open(path.string()))
+			return false;
+
+		const char *begin = file.data();
+		const char *end = begin + file.size();
+
+		m_fileSize = file.size();
+		m_parsedBytes = 0;
+
+		if (threadCount == 0)
+			threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+		const std::size_t chunkCount = std::max(std::size_t(1), std::min(std::size_t(threadCount), file.size() / minimumChunkSize));
+		std::vector<const char *> chunkBoundaries(chunkCount + 1, end);
+		chunkBoundaries[0] = begin;
+
+		// chunks always end after a line break, so that every line is parsed by exactly one thread
+		for (std::size_t i = 1; i < chunkCount; i++)
+		{
+			const char *boundary = std::max(chunkBoundaries[i - 1], begin + i * (file.size() / chunkCount));
+			const char *lineEnd = static_cast<const char *>(std::memchr(boundary, '\n', end - boundary));
+			chunkBoundaries[i] = lineEnd ? lineEnd + 1 : end;
+		}
+
+		// chunks are released as soon as they have been merged, so they do not use the arena of the state
+		std::vector<std::unique_ptr<ObjChunk>> chunks(chunkCount);
+
+		for (auto &c : chunks)
+			c = std::make_unique<ObjChunk>(&state.memory);
+
+		std::vector<std::thread> threads;
+		threads.reserve(chunkCount - 1);
+
+		for (std::size_t i = 1; i < chunkCount; i++)
+			threads.emplace_back(&ObjLoader::parseObjChunk, this, std::ref(*chunks[i]), chunkBoundaries[i], chunkBoundaries[i + 1]);
+
+		parseObjChunk(*chunks[0], chunkBoundaries[0], chunkBoundaries[1]);
+
+		for (auto &t : threads)
+			t.join();
+
+		if (m_cancelled)
+			return false;
+
+		mergeObjChunks(state, chunks);
+		return true;
+	}
+
+	// counts the elements of a chunk in a quick pass over its lines, so that its arrays can be allocated with their final size
+	void countObjChunk(ObjChunk &chunk, const char *current, const char *end)
+	{
+		std::size_t positionCount = 0;
+		std::size_t normalCount = 0;
+		std::size_t texCoordCount = 0;
+		std::size_t faceVertexCount = 0;
+
+		while (current < end)
+		{
+			const char *lineEnd = static_cast<const char *>(std::memchr(current, '\n', end - current));
+
+			if (!lineEnd)
+				lineEnd = end;
+
+			const char *first = skipWhitespace(current, lineEnd);
+			const char *tokenEnd = skipToken(first, lineEnd);
+			const std::string_view token(first, tokenEnd - first);
+
+			if (token == "v")
+			{
+				positionCount++;
+			}
+			else if (token == "vn")
+			{
+				normalCount++;
+			}
+			else if (token == "vt")
+			{
+				texCoordCount++;
+			}
+			else if (!token.empty() && token.front() == 'f')
+			{
+				std::size_t vertexCount = 0;
+				first = skipWhitespace(tokenEnd, lineEnd);
+
+				while (first != lineEnd && *first != '#' && *first != '\r')
+				{
+					vertexCount++;
+					first = skipWhitespace(skipToken(first, lineEnd), lineEnd);
+				}
+
+				// polygons are triangulated as a fan
+				faceVertexCount += vertexCount > 3 ? (vertexCount - 2) * 3 : vertexCount;
+			}
+
+			current = (lineEnd < end) ? lineEnd + 1 : end;
+		}
+
+		chunk.positions.reserve(positionCount);
+		chunk.normals.reserve(normalCount);
+		chunk.texCoords.reserve(texCoordCount);
+		chunk.positionIndices.reserve(faceVertexCount);
+		chunk.normalIndices.reserve(faceVertexCount);
+		chunk.texCoordIndices.reserve(faceVertexCount);
+		chunk.relativeIndices.reserve(faceVertexCount);
+	}
+
+	void parseObjChunk(ObjChunk &chunk, const char *current, const char *end)
+	{
+		countObjChunk(chunk, current, end);
+
+		const char *reported = current;
+
+		while (current < end)
+		{
+			const char *lineEnd = static_cast<const char *>(std::memchr(current, '\n', end - current));
+
+			if (!lineEnd)
+				lineEnd = end;
+
+			parseObjLine(chunk, current, lineEnd);
+			current = (lineEnd < end) ? lineEnd + 1 : end;
+
+			if (std::size_t(current - reported) >= progressInterval)
+			{
+				const std::size_t parsedBytes = m_parsedBytes += std::size_t(current - reported);
+				reported = current;
+
+				if (!reportProgress("Parsing", float(parsedBytes) / float(m_fileSize)))
+					return;
+			}
+		}
+	}
+
+	void parseObjLine(ObjChunk &chunk, const char *first, const char *last)
+	{
+		// the file is mapped as binary, so Windows line endings have to be removed here
+		if (first != last && *(last - 1) == '\r')
+			last--;
+
+		const char *lineStart = first;
+		first = skipWhitespace(first, last);
+
+		const char *tokenEnd = skipToken(first, last);
+		const std::string_view token(first, tokenEnd - first);
+
+		if (token.empty())
+			return;
+
+		first = tokenEnd;
+
+		switch (token.front())
+		{
+			// v, vn, vt
+		case 'v':
+		{
+			if (token == "v")
+			{
+				vec3 p(0.0f);
+
+				if (parseNumber(first, last, p.x) && parseNumber(first, last, p.y) && parseNumber(first, last, p.z))
+					chunk.positions.push_back(p);
+			}
+			else if (token == "vn")
+			{
+				vec3 n(0.0f);
+
+				if (parseNumber(first, last, n.x) && parseNumber(first, last, n.y) && parseNumber(first, last, n.z))
+					chunk.normals.push_back(n);
+			}
+			else if (token == "vt")
+			{
+				vec2 t(0.0f);
+
+				if (parseNumber(first, last, t.x) && parseNumber(first, last, t.y))
+					chunk.texCoords.push_back(t);
+			}
+		}
+		break;
+
+		// mtllib
+		case 'm':
+		{
+			if (first != last)
+				chunk.records.push_back({ObjRecord::Type::MaterialLibrary, std::string(first, last), chunk.positionIndices.size()});
+		}
+		break;
+
+		// use material
+		case 'u':
+		{
+			if (first != last)
+				chunk.records.push_back({ObjRecord::Type::UseMaterial, std::string(first, last), chunk.positionIndices.size()});
+		}
+		break;
+
+		// group
+		case 'g':
+		case 'o':
+		{
+			if (first != last)
+				chunk.records.push_back({ObjRecord::Type::Group, std::string(first, last), chunk.positionIndices.size()});
+		}
+		break;
+
+		// face
+		case 'f':
+		{
+			const bool positionNormalFormat = std::string_view(lineStart, last - lineStart).find("//") != std::string_view::npos;
+			parseObjFace(chunk, first, last, positionNormalFormat);
+		}
+		break;
+		}
+	}
+
+	void parseObjFace(ObjChunk &chunk, const char *first, const char *last, bool positionNormalFormat)
+	{
+		enum class FaceFormat
+		{
+			PositionNormal,
+			PositionTexCoordNormal,
+			PositionTexCoord,
+			Position
+		};
+
+		FaceFormat format = FaceFormat::PositionNormal;
+		int v = 0, n = 0, t = 0;
+
+		// the format is determined from the first vertex only, in the same order the stream parser tries them
+		if (!positionNormalFormat)
+		{
+			const char *probe = first;
+
+			if (parseNumber(probe, last, v) && parseLiteral(probe, last, "/") && parseNumber(probe, last, t) && parseLiteral(probe, last, "/") && parseNumber(probe, last, n))
+			{
+				format = FaceFormat::PositionTexCoordNormal;
+			}
+			else
+			{
+				probe = first;
+
+				if (parseNumber(probe, last, v) && parseLiteral(probe, last, "/") && parseNumber(probe, last, t))
+					format = FaceFormat::PositionTexCoord;
+				else
+					format = FaceFormat::Position;
+			}
+		}
+
+		uint vertexCount = 0;
+
+		while (true)
+		{
+			v = 0;
+			n = 0;
+			t = 0;
+
+			bool valid = false;
+
+			switch (format)
+			{
+			case FaceFormat::PositionNormal:
+				valid = parseNumber(first, last, v) && parseLiteral(first, last, "//") && parseNumber(first, last, n);
+				break;
+
+			case FaceFormat::PositionTexCoordNormal:
+				valid = parseNumber(first, last, v) && parseLiteral(first, last, "/") && parseNumber(first, last, t) && parseLiteral(first, last, "/") && parseNumber(first, last, n);
+				break;
+
+			case FaceFormat::PositionTexCoord:
+				valid = parseNumber(first, last, v) && parseLiteral(first, last, "/") && parseNumber(first, last, t);
+				break;
+
+			case FaceFormat::Position:
+				valid = parseNumber(first, last, v);
+				break;
+			}
+
+			if (!valid)
+				break;
+
+			// polygons are triangulated as a fan around their first vertex
+			if (vertexCount >= 3)
+			{
+				chunk.positionIndices.push_back(chunk.positionIndices[chunk.positionIndices.size() - 3]);
+				chunk.texCoordIndices.push_back(chunk.texCoordIndices[chunk.texCoordIndices.size() - 3]);
+				chunk.normalIndices.push_back(chunk.normalIndices[chunk.normalIndices.size() - 3]);
+				chunk.relativeIndices.push_back(chunk.relativeIndices[chunk.relativeIndices.size() - 3]);
+
+				chunk.positionIndices.push_back(chunk.positionIndices[chunk.positionIndices.size() - 2]);
+				chunk.texCoordIndices.push_back(chunk.texCoordIndices[chunk.texCoordIndices.size() - 2]);
+				chunk.normalIndices.push_back(chunk.normalIndices[chunk.normalIndices.size() - 2]);
+				chunk.relativeIndices.push_back(chunk.relativeIndices[chunk.relativeIndices.size() - 2]);
+			}
+
+			// relative indices are resolved as if the chunk started at the beginning of the file (including the
+			// dummy elements at index zero), the offset of the preceding chunks is added when merging
+			chunk.positionIndices.push_back(resolveIndex(v, chunk.positions.size() + 1));
+			chunk.texCoordIndices.push_back(resolveIndex(t, chunk.texCoords.size() + 1));
+			chunk.normalIndices.push_back(resolveIndex(n, chunk.normals.size() + 1));
+
+			unsigned char relative = 0;
+
+			if (v < 0)
+				relative |= ObjChunk::RelativePosition;
+
+			if (t < 0)
+				relative |= ObjChunk::RelativeTexCoord;
+
+			if (n < 0)
+				relative |= ObjChunk::RelativeNormal;
+
+			chunk.relativeIndices.push_back(relative);
+
+			vertexCount++;
+		}
+	}
+
+	void mergeObjChunks(ObjState &state, std::vector<std::unique_ptr<ObjChunk>> &chunks)
+	{
+		std::vector<std::vector<ObjSegment>> segments(chunks.size());
+		std::size_t positionCount = 0;
+		std::size_t texCoordCount = 0;
+		std::size_t normalCount = 0;
+
+		// the records are applied first, so that the final size of all arrays is known before anything is copied
+		for (std::size_t c = 0; c < chunks.size(); c++)
+		{
+			const ObjChunk &chunk = *chunks[c];
+			std::size_t faceVertexCount = 0;
+
+			for (const auto &r : chunk.records)
+			{
+				if (r.faceVertexCount > faceVertexCount)
+					segments[c].push_back({state.groupIterator, faceVertexCount, r.faceVertexCount});
+
+				faceVertexCount = r.faceVertexCount;
+
+				switch (r.type)
+				{
+				case ObjRecord::Type::MaterialLibrary:
+					loadMaterialLibraries(state, r.name);
+					break;
+
+				case ObjRecord::Type::UseMaterial:
+					useMaterial(state, r.name);
+					break;
+
+				case ObjRecord::Type::Group:
+					beginGroup(state, r.name);
+					break;
+				}
+			}
+
+			if (chunk.positionIndices.size() > faceVertexCount)
+				segments[c].push_back({state.groupIterator, faceVertexCount, chunk.positionIndices.size()});
+
+			positionCount += chunk.positions.size();
+			texCoordCount += chunk.texCoords.size();
+			normalCount += chunk.normals.size();
+		}
+
+		std::unordered_map<ObjGroup *, std::size_t> groupSizes;
+
+		for (const auto &s : segments)
+			for (const auto &segment : s)
+				groupSizes[&*segment.group] += segment.end - segment.begin;
+
+		for (const auto &g : groupSizes)
+		{
+			g.first->positionIndices.reserve(g.first->positionIndices.size() + g.second);
+			g.first->texCoordIndices.reserve(g.first->texCoordIndices.size() + g.second);
+			g.first->normalIndices.reserve(g.first->normalIndices.size() + g.second);
+		}
+
+		state.positions.reserve(state.positions.size() + positionCount);
+		state.texCoords.reserve(state.texCoords.size() + texCoordCount);
+		state.normals.reserve(state.normals.size() + normalCount);
+
+		for (std::size_t c = 0; c < chunks.size(); c++)
+		{
+			const ObjChunk &chunk = *chunks[c];
+
+			// number of elements in all preceding chunks, excluding the dummy elements at index zero
+			const uint positionOffset = uint(state.positions.size() - 1);
+			const uint texCoordOffset = uint(state.texCoords.size() - 1);
+			const uint normalOffset = uint(state.normals.size() - 1);
+
+			state.positions.insert(state.positions.end(), chunk.positions.begin(), chunk.positions.end());
+			state.texCoords.insert(state.texCoords.end(), chunk.texCoords.begin(), chunk.texCoords.end());
+			state.normals.insert(state.normals.end(), chunk.normals.begin(), chunk.normals.end());
+
+			for (const auto &segment : segments[c])
+			{
+				ObjGroup &group = *segment.group;
+
+				for (std::size_t i = segment.begin; i < segment.end; i++)
+				{
+					const unsigned char relative = chunk.relativeIndices[i];
+
+					group.positionIndices.push_back(chunk.positionIndices[i] + ((relative & ObjChunk::RelativePosition) ? positionOffset : 0));
+					group.texCoordIndices.push_back(chunk.texCoordIndices[i] + ((relative & ObjChunk::RelativeTexCoord) ? texCoordOffset : 0));
+					group.normalIndices.push_back(chunk.normalIndices[i] + ((relative & ObjChunk::RelativeNormal) ? normalOffset : 0));
+				}
+			}
+
+			chunks[c].reset();
+		}
+	}
+
+	void loadMaterialLibraries(ObjState &state, std::string libraryName)
+	{
+		// the Wavefront obj specification does not really allow for spaces in the mtl file name,
+		// since multiple libraries are supposed to be separated by spaces, but many programs
+		// do not take care of that -- therefore, we first try whether it is a single filename,
+		// and only if that fails we use the interpretation according to the specification
+		libraryName = trim(libraryName);
+		std::filesystem::path libraryPath = libraryName;
+
+		// first try
+		if (libraryPath.is_absolute())
+		{
+			if (loadMtlFile(libraryPath.string(), state.materials, state.materialMap))
+				return;
+		}
+
+		std::stringstream mss(libraryName);
+
+		while (mss >> libraryName)
+		{
+			libraryName = trim(libraryName);
+			std::filesystem::path libraryPath = state.path.parent_path();
+			libraryPath.append(libraryName);
+			loadMtlFile(libraryPath.string(), state.materials, state.materialMap);
+		}
+	}
+
+	void useMaterial(ObjState &state, const std::string &materialName)
+	{
+		state.currentMaterial = trim(materialName);
+		state.groupIterator->material = state.currentMaterial;
+	}
+
+	void beginGroup(ObjState &state, const std::string &name)
+	{
+		const std::string groupName = trim(name);
+		std::unordered_map<std::string, ObjGroupList::iterator>::iterator j = state.groupMap.find(groupName);
+
+		if (j == state.groupMap.end())
+		{
+			ObjGroup &newGroup = state.groupList.emplace_back(&state.arena);
+			newGroup.name = groupName;
+
+			state.groupIterator = state.groupList.end();
+			state.groupIterator--;
+		}
+		else
+			state.groupIterator = j->second;
+
+		state.groupIterator->material = state.currentMaterial;
+	}
+
+	bool loadMtlFile(const std::string &filename, std::vector<ObjMaterial> &materials, std::unordered_map<std::string, int> &materialMap)
+	{
+		std::ifstream is(filename);
+
+		if (!is.is_open())
+			return false;
+
+		std::string buffer;
+		int currentMaterialIndex = 0;
+
+		while (is.good())
+		{
+			if (getline(is, buffer))
+			{
+				std::istringstream iss(buffer);
+				std::string token;
+
+				if (iss >> token)
+				{
+					if (token == "newmtl")
+					{
+						std::string materialName;
+
+						if (getline(iss, materialName))
+						{
+							materialName = trim(materialName);
+
+							auto i = materialMap.find(materialName);
+
+							if (i == materialMap.end())
+							{
+								ObjMaterial newMaterial;
+								newMaterial.name = materialName;
+								currentMaterialIndex = uint(materials.size());
+								materialMap.insert(std::make_pair(newMaterial.name, currentMaterialIndex));
+								materials.push_back(newMaterial);
+							}
+							else
+							{
+								currentMaterialIndex = i->second;
+							}
+						}
+					}
+					// Ambient Color
+					else if (token == "Ka")
+					{
+						vec3 Ka(0.0f);
+						if (iss >> Ka.x >> Ka.y >> Ka.z)
+							materials[currentMaterialIndex].Ka = Ka;
+					}
+					// Diffuse Color
+					else if (token == "Kd")
+					{
+						vec3 Kd(0.0f);
+						if (iss >> Kd.x >> Kd.y >> Kd.z)
+							materials[currentMaterialIndex].Kd = Kd;
+					}
+					// Specular Color
+					else if (token == "Ks")
+					{
+						vec3 Ks(0.0f);
+						if (iss >> Ks.x >> Ks.y >> Ks.z)
+							materials[currentMaterialIndex].Ks = Ks;
+					}
+					// Specular Exponent
+					else if (token == "Ns")
+					{
+						float Ns = 0.0f;
+						if (iss >> Ns)
+							materials[currentMaterialIndex].Ns = Ns;
+					}
+					// Dissolve
+					else if (token == "d")
+					{
+						float d = 0.0f;
+						if (iss >> d)
+							materials[currentMaterialIndex].d = d;
+					}
+					// Illumination
+					else if (token == "illum")
+					{
+						int illum = 0;
+						if (iss >> illum)
+							materials[currentMaterialIndex].illum = illum;
+					}
+					// Ambient Texture Map
+					else if (token == "map_Ka")
+					{
+						std::string map_Ka;
+						if (getline(iss, map_Ka))
+						{
+							map_Ka = trim(map_Ka);
+							materials[currentMaterialIndex].map_Ka = map_Ka;
+						}
+					}
+					// Diffuse Texture Map
+					else if (token == "map_Kd")
+					{
+						std::string map_Kd;
+						if (getline(iss, map_Kd))
+						{
+							map_Kd = trim(map_Kd);
+							materials[currentMaterialIndex].map_Kd = map_Kd;
+						}
+					}
+					// Specular Texture Map
+					else if (token == "map_Ks")
+					{
+						std::string map_Ks;
+						if (getline(iss, map_Ks))
+						{
+							map_Ks = trim(map_Ks);
+							materials[currentMaterialIndex].map_Ks = map_Ks;
+						}
+					}
+					// Specular Hightlight Map
+					else if (token == "map_Ns")
+					{
+						std::string map_Ns;
+						if (getline(iss, map_Ns))
+						{
+							map_Ns = trim(map_Ns);
+							materials[currentMaterialIndex].map_Ns = map_Ns;
+						}
+					}
+					// Alpha Texture Map
+					else if (token == "map_d")
+					{
+						std::string map_d;
+						if (getline(iss, map_d))
+						{
+							map_d = trim(map_d);
+							materials[currentMaterialIndex].map_d = map_d;
+						}
+					}
+					// Bump Map
+					else if (token == "map_bump" || token == "map_Bump" || token == "bump")
+					{
+						std::string map_bump;
+						if (getline(iss, map_bump))
+						{
+							map_bump = trim(map_bump);
+							materials[currentMaterialIndex].map_bump = map_bump;
+						}
+					}
+				}
+			}
+		}
+
+		return true;
+	}
+
+	const std::vector<Group> &groups() const
+	{
+		return m_groups;
+	}
+
+	const std::vector<Vertex> &vertices() const
+	{
+		return m_vertices;
+	}
+
+	const std::vector<Meshlet> &meshlets() const
+	{
+		return m_meshlets;
+	}
+
+	const std::vector<LevelOfDetail> &levelsOfDetail() const
+	{
+		return m_levelsOfDetail;
+	}
+
+	// bounds of all positions in the file, available before the first geometry callback
+	vec3 minimumBounds() const
+	{
+		return m_minimumBounds;
+	}
+
+	vec3 maximumBounds() const
+	{
+		return m_maximumBounds;
+	}
+
+	const std::vector<uint> &indices() const
+	{
+		return m_indices;
+	}
+
+	const std::vector<Material> &materials() const
+	{
+		return m_materials;
+	}
+
+	// vertex cache efficiency before and after optimizing, empty if the geometry was not optimized
+	const VertexCacheStatistics &originalStatistics() const
+	{
+		return m_originalStatistics;
+	}
+
+	const VertexCacheStatistics &optimizedStatistics() const
+	{
+		return m_optimizedStatistics;
+	}
+
+	// hands the final arrays over without copying them, the loader is left without geometry
+	std::vector<Vertex> releaseVertices()
+	{
+		return std::move(m_vertices);
+	}
+
+	std::vector<uint> releaseIndices()
+	{
+		return std::move(m_indices);
+	}
+
+private:
+	// number of parsed bytes between progress reports
+	static constexpr std::size_t progressInterval = 4 * 1024 * 1024;
+	// number of face vertices between geometry callbacks within a group, a multiple of three so that only whole triangles are handed out
+	static constexpr std::size_t geometryBatchSize = 3 * 256 * 1024;
+
+	bool reportProgress(const char *stage, float progress)
+	{
+		if (m_progressCallback && !m_progressCallback(stage, progress))
+			m_cancelled = true;
+
+		return !m_cancelled;
+	}
+
+	bool publishGeometry(float progress)
+	{
+		if (m_geometryCallback)
+			m_geometryCallback();
+
+		return reportProgress("Building vertices", progress);
+	}
+
+	std::vector<Group> m_groups;
+	std::vector<Vertex> m_vertices;
+	std::vector<glm::uint> m_indices;
+	std::vector<Meshlet> m_meshlets;
+	std::vector<LevelOfDetail> m_levelsOfDetail;
+	std::vector<Material> m_materials;
+	VertexCacheStatistics m_originalStatistics;
+	VertexCacheStatistics m_optimizedStatistics;
+	vec3 m_minimumBounds = vec3(0.0f);
+	vec3 m_maximumBounds = vec3(0.0f);
+
+	ProgressCallback m_progressCallback;
+	GeometryCallback m_geometryCallback;
+	std::atomic<bool> m_cancelled = false;
+	std::atomic<std::size_t> m_parsedBytes = 0;
+	std::size_t m_fileSize = 0;
+};
+
+// state shared between the loading thread and the thread owning the OpenGL context
+struct Model::LoadState
+{
+	// part of the geometry, groups starting at firstGroup replace the ones already received
+	struct Batch
+	{
+		std::size_t firstGroup = 0;
+		std::vector<Group> groups;
+		// meshlets of the groups in this batch that have not been handed out before
+		std::vector<Meshlet> meshlets;
+		// levels of detail of all groups, handed out once together with all groups
+		std::vector<LevelOfDetail> levelsOfDetail;
+		// only one of the vertex arrays is filled, depending on the vertex format
+		std::vector<Vertex> vertices;
+		std::vector<PackedVertex> packedVertices;
+		// indices in the layout of the index buffer, with 16-bit and 32-bit parts aligned to their size
+		std::vector<std::uint8_t> indexData;
+		std::size_t indexCount = 0;
+		vec3 minimumBounds = vec3(std::numeric_limits<float>::max());
+		vec3 maximumBounds = vec3(-std::numeric_limits<float>::max());
+	};
+
+	// maximum amount of data handed out at once, larger parts are split so that single frames do not stall
+	static constexpr std::size_t maximumBatchSize = 16 * 1024 * 1024;
+
+	std::string filename;
+	LoadOptions options;
+	std::shared_ptr<TextureLoader> textureLoader;
+	std::chrono::steady_clock::time_point start;
+
+	~LoadState();
+
+	std::thread thread;
+	std::atomic<bool> cancelled = false;
+	std::atomic<bool> finished = false;
+	std::atomic<float> progress = 0.0f;
+
+	// protects everything below
+	mutable std::mutex mutex;
+	std::string stage = "Loading";
+	bool materialsReady = false;
+	std::vector<Material> materials;
+	// transformation of packed positions, handed out before the first batch
+	bool boundsReady = false;
+	vec3 positionOffset = vec3(0.0f);
+	vec3 positionScale = vec3(1.0f);
+	std::deque<Batch> batches;
+	// complete arrays, which are handed over after the last batch if the model keeps them in main memory
+	bool geometryReady = false;
+	std::vector<Vertex> vertices;
+	std::vector<uint> indices;
+	bool bvhReady = false;
+	Bvh bvh;
+	std::vector<vec4> bvhNodeTexels;
+	std::vector<vec4> bvhTriangleTexels;
+
+	// amount of data already handed out, only used by the loading thread
+	bool materialsPublished = false;
+	bool boundsPublished = false;
+	std::size_t publishedGroups = 0;
+	std::size_t publishedMeshlets = 0;
+	std::size_t publishedVertices = 0;
+	std::size_t publishedIndices = 0;
+	std::size_t publishedIndexBytes = 0;
+	// layout of the indices of the groups handed out so far, groups are added once their first index is handed out
+	std::vector<Group> groupLayouts;
+
+	void run();
+	bool setProgress(const char *stage, float progress);
+	void publishMaterials(const std::vector<Material> &materials);
+	void publishBounds(const vec3 &minimumBounds, const vec3 &maximumBounds);
+	void publishGeometry(const Group *groups, std::size_t groupCount, const Meshlet *meshlets, std::size_t meshletCount, const Vertex *vertices, std::size_t vertexCount, const uint *indices, std::size_t indexCount);
+	void publishLevelsOfDetail(const Group *groups, std::size_t groupCount, const LevelOfDetail *levelsOfDetail, std::size_t levelOfDetailCount, const uint *indices, std::size_t indexCount);
+	void publishArrays(std::vector<Vertex> &&vertices, std::vector<uint> &&indices);
+	void publishBvh(Bvh &&bvh, const Vertex *vertices, const std::vector<Group> &groups);
+	void buildBvh(Bvh &bvh, const Vertex *vertices, const uint *indices, const std::vector<Group> &groups);
+	void encodeIndices(Batch &batch, const Group *groups, std::size_t groupCount, const uint *indices, std::size_t indexEnd);
+	void appendIndices(Batch &batch, const Group &layout, const uint *indices, std::size_t indexCount);
+	void applyIndexLayouts(Batch &batch) const;
+};
+
+// decodes textures on a thread pool and hands them to the thread owning the OpenGL context, either all of them while
+// loading or those of single materials when they are first drawn
+struct Model::TextureLoader
+{
+	// material and texture member that refer to a texture
+	using TextureTarget = std::pair<std::size_t, std::shared_ptr<Texture> Material::*>;
+
+	// texture for all references to the same image contents, the image is only decoded if the cache does not contain it yet
+	struct TextureUpload
+	{
+		TextureCache::Key key;
+		std::string filename;
+		std::vector<TextureTarget> targets;
+		TextureUsage usage = TextureUsage::Color;
+		TextureImage image;
+	};
+
+	// maximum amount of decoded pixel data waiting for upload
+	static constexpr std::size_t maximumQueuedTextureSize = 1024 * 1024 * 1024;
+
+	TextureLoader(const LoadOptions &options, const std::shared_ptr<TextureCache> &textureCache);
+	~TextureLoader();
+
+	LoadOptions options;
+	std::shared_ptr<TextureCache> textureCache;
+	std::atomic<bool> cancelled = false;
+
+	// called whenever a requested texture has been decoded, only set while loading all textures at once
+	std::function<void(float)> progressCallback;
+	std::atomic<std::size_t> requestedCount = 0;
+	std::atomic<std::size_t> finishedCount = 0;
+
+	// protects the queues and the queued size
+	std::mutex mutex;
+	// textures that are being decoded, further references to the same image are added to them
+	std::map<TextureCache::Key, TextureUpload> decoding;
+	std::deque<TextureUpload> textures;
+	std::size_t queuedTextureSize = 0;
+	std::condition_variable textureSpace;
+
+	// materials whose textures have been requested, only used by the thread owning the OpenGL context
+	std::vector<bool> requestedMaterials;
+
+	// destroyed first, so that no task is running while the members above are destroyed
+	ThreadPool pool;
+
+	void request(const Material &material, std::size_t materialIndex);
+	void cancel();
+	void loadReference(const std::string &filename, const TextureTarget &target, TextureUsage usage);
+};
+
+Model::LoadState::~LoadState()
+{
+	cancelled = true;
+
+	// the loading thread may be waiting for textures, which are still decoded on request after loading has finished
+	if (textureLoader && !finished)
+		textureLoader->cancel();
+
+	if (thread.joinable())
+		thread.join();
+}
+
+void Model::LoadState::run()
+{
+	ModelCacheOptions cacheOptions;
+	cacheOptions.optimizeGeometry = options.optimizeGeometry;
+	cacheOptions.buildMeshlets = options.buildMeshlets;
+	cacheOptions.buildLevelsOfDetail = options.buildLevelsOfDetail;
+
+	ModelCache cache(filename, options.cacheDirectory, cacheOptions);
+	std::vector<Material> loadedMaterials;
+
+	if (options.cache && cache.read())
+	{
+		globjects::debug() << "Using cached geometry from " << cache.cacheFilename();
+
+		if (options.optimizeGeometry)
+			reportVertexCache(cache.originalStatistics(), cache.optimizedStatistics());
+
+		loadedMaterials = cache.materials();
+		publishMaterials(loadedMaterials);
+
+		publishBounds(cache.minimumBounds(), cache.maximumBounds());
+
+		const std::vector<Group> &groups = cache.groups();
+
+		// all vertices are handed out first, since groups may refer to any of them
+		for (std::size_t i = 0; i < groups.size() && !cancelled; i++)
+		{
+			setProgress("Loading cached geometry", float(i) / float(groups.size()));
+			// groups keep their meshlet ranges, which the renderer ignores while no meshlets were handed out
+			const std::size_t meshletCount = options.buildMeshlets ? groups[i].firstMeshlet + groups[i].meshletCount : 0;
+			publishGeometry(groups.data(), i + 1, cache.meshlets().data(), meshletCount, cache.vertices(), cache.vertexCount(), cache.indices(), groups[i].endIndex);
+		}
+
+		// the cache only matches if it was written with the same choice, this keeps the option authoritative regardless
+		if (options.buildLevelsOfDetail && !cancelled)
+			publishLevelsOfDetail(groups.data(), groups.size(), cache.levelsOfDetail().data(), cache.levelsOfDetail().size(), cache.indices(), cache.indexCount());
+
+		if (options.buildBvh && !cancelled)
+		{
+			Bvh bvh;
+
+			if (cache.bvhNodeCount() > 0)
+				bvh.assign(std::vector<BvhNode>(cache.bvhNodes(), cache.bvhNodes() + cache.bvhNodeCount()), std::vector<BvhTriangle>(cache.bvhTriangles(), cache.bvhTriangles() + cache.bvhTriangleCount()));
+			else
+				buildBvh(bvh, cache.vertices(), cache.indices(), groups);
+
+			publishBvh(std::move(bvh), cache.vertices(), groups);
+		}
+
+		if (options.keepGeometry && !cancelled)
+			publishArrays(std::vector<Vertex>(cache.vertices(), cache.vertices() + cache.vertexCount()), std::vector<uint>(cache.indices(), cache.indices() + cache.indexCount()));
+
+		cache.close();
+	}
+	else
+	{
+		ObjLoader loader;
+		loader.setProgressCallback([this](const char *stage, float progress) { return setProgress(stage, progress); });
+		loader.setGeometryCallback([this, &loader]() {
+			publishMaterials(loader.materials());
+			publishBounds(loader.minimumBounds(), loader.maximumBounds());
+			publishGeometry(loader.groups().data(), loader.groups().size(), loader.meshlets().data(), loader.meshlets().size(), loader.vertices().data(), loader.vertices().size(), loader.indices().data(), loader.indices().size());
+		});
+
+		if (!loader.loadObjFile(filename, options.parser, options.threadCount, options.optimizeGeometry, options.buildMeshlets))
+		{
+			if (!cancelled)
+				globjects::debug() << "Error loading << " << filename << "!";
+
+			finished = true;
+			return;
+		}
+
+		if (options.buildLevelsOfDetail)
+		{
+			if (!loader.buildLevelsOfDetail(options.threadCount))
+			{
+				finished = true;
+				return;
+			}
+
+			publishLevelsOfDetail(loader.groups().data(), loader.groups().size(), loader.levelsOfDetail().data(), loader.levelsOfDetail().size(), loader.indices().data(), loader.indices().size());
+		}
+
+		publishMaterials(loader.materials());
+		loadedMaterials = loader.materials();
+
+		Bvh bvh;
+
+		if (options.buildBvh)
+			buildBvh(bvh, loader.vertices().data(), loader.indices().data(), loader.groups());
+
+		if (options.cache)
+		{
+			setProgress("Writing cache", 0.0f);
+
+			vec3 minimumBounds(std::numeric_limits<float>::max());
+			vec3 maximumBounds(-std::numeric_limits<float>::max());
+
+			for (const auto &v : loader.vertices())
+			{
+				minimumBounds = min(minimumBounds, v.position);
+				maximumBounds = max(maximumBounds, v.position);
+			}
+
+			if (cache.write(loader.vertices(), loader.indices(), loader.groups(), loader.meshlets(), loader.levelsOfDetail(), loader.materials(), bvh, loader.originalStatistics(), loader.optimizedStatistics(), minimumBounds, maximumBounds))
+				globjects::debug() << "Saved cached geometry to " << cache.cacheFilename();
+			else
+				globjects::debug() << "Could not write cache file " << cache.cacheFilename();
+		}
+
+		if (options.buildBvh)
+			publishBvh(std::move(bvh), loader.vertices().data(), loader.groups());
+
+		if (options.keepGeometry)
+			publishArrays(loader.releaseVertices(), loader.releaseIndices());
+	}
+
+	if (!options.lazyTextures && !cancelled)
+	{
+		setProgress("Loading textures", 0.0f);
+		textureLoader->progressCallback = [this](float progress) { setProgress("Loading textures", progress); };
+
+		for (std::size_t i = 0; i < loadedMaterials.size(); i++)
+			textureLoader->request(loadedMaterials[i], i);
+
+		textureLoader->pool.wait();
+		textureLoader->progressCallback = nullptr;
+	}
+
+	finished = true;
+}
+
+bool Model::LoadState::setProgress(const char *stage, float progress)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		this->stage = stage;
+	}
+
+	this->progress = progress;
+	return !cancelled;
+}
+
+void Model::LoadState::publishMaterials(const std::vector<Material> &materials)
+{
+	if (materialsPublished)
+		return;
+
+	std::lock_guard<std::mutex> lock(mutex);
+	this->materials = materials;
+	materialsReady = true;
+	materialsPublished = true;
+}
+
+void Model::LoadState::publishBounds(const vec3 &minimumBounds, const vec3 &maximumBounds)
+{
+	if (boundsPublished)
+		return;
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	if (options.vertexFormat == VertexFormat::Packed)
+	{
+		positionOffset = minimumBounds;
+		positionScale = maximumBounds - minimumBounds;
+	}
+
+	boundsReady = true;
+	boundsPublished = true;
+}
+
+void Model::LoadState::publishGeometry(const Group *groups, std::size_t groupCount, const Meshlet *meshlets, std::size_t meshletCount, const Vertex *vertices, std::size_t vertexCount, const uint *indices, std::size_t indexCount)
+{
+	while (publishedVertices < vertexCount || publishedIndices < indexCount || publishedGroups < groupCount || publishedMeshlets < meshletCount)
+	{
+		Batch batch;
+
+		const std::size_t vertexEnd = std::min(vertexCount, publishedVertices + maximumBatchSize / sizeof(Vertex));
+
+		// vertices are packed and their bounds computed here, so that the thread owning the OpenGL context only uploads them
+		if (options.vertexFormat == VertexFormat::Packed)
+		{
+			const vec3 inverseScale = vec3(
+				positionScale.x > 0.0f ? 1.0f / positionScale.x : 0.0f,
+				positionScale.y > 0.0f ? 1.0f / positionScale.y : 0.0f,
+				positionScale.z > 0.0f ? 1.0f / positionScale.z : 0.0f);
+
+			batch.packedVertices.reserve(vertexEnd - publishedVertices);
+
+			for (std::size_t i = publishedVertices; i < vertexEnd; i++)
+				batch.packedVertices.push_back(packVertex(vertices[i], positionOffset, inverseScale));
+		}
+		else
+		{
+			batch.vertices.assign(vertices + publishedVertices, vertices + vertexEnd);
+		}
+
+		for (std::size_t i = publishedVertices; i < vertexEnd; i++)
+		{
+			batch.minimumBounds = min(batch.minimumBounds, vertices[i].position);
+			batch.maximumBounds = max(batch.maximumBounds, vertices[i].position);
+		}
+
+		publishedVertices = vertexEnd;
+
+		// indices are only handed out once all the vertices they might refer to are available
+		if (publishedVertices == vertexCount)
+		{
+			const std::size_t indexEnd = std::min(indexCount, publishedIndices + (maximumBatchSize / sizeof(uint)) / 3 * 3);
+			encodeIndices(batch, groups, groupCount, indices, indexEnd);
+
+			// the last group handed out before may have grown since then
+			if (publishedIndices == indexCount)
+			{
+				batch.firstGroup = publishedGroups > 0 ? publishedGroups - 1 : 0;
+				batch.groups.assign(groups + batch.firstGroup, groups + groupCount);
+				applyIndexLayouts(batch);
+				publishedGroups = groupCount;
+
+				// meshlets are handed out together with the groups referring to them
+				batch.meshlets.assign(meshlets + publishedMeshlets, meshlets + meshletCount);
+				publishedMeshlets = meshletCount;
+			}
+			else
+			{
+				batch.firstGroup = publishedGroups;
+			}
+		}
+		else
+		{
+			batch.firstGroup = publishedGroups;
+		}
+
+		std::lock_guard<std::mutex> lock(mutex);
+		batches.push_back(std::move(batch));
+	}
+}
+
+// hands out the indices of the levels of detail, which follow the indices of all groups, and then all groups again with the levels
+void Model::LoadState::publishLevelsOfDetail(const Group *groups, std::size_t groupCount, const LevelOfDetail *levelsOfDetail, std::size_t levelOfDetailCount, const uint *indices, std::size_t indexCount)
+{
+	if (levelOfDetailCount == 0)
+		return;
+
+	std::vector<LevelOfDetail> levels(levelsOfDetail, levelsOfDetail + levelOfDetailCount);
+	Batch batch;
+	batch.firstGroup = publishedGroups;
+
+	// levels use the index format of their group, which is known since all groups have been handed out
+	for (std::size_t g = 0; g < groupCount && g < groupLayouts.size(); g++)
+	{
+		for (uint j = groups[g].firstLevelOfDetail; j < groups[g].firstLevelOfDetail + groups[g].levelOfDetailCount && j < levels.size(); j++)
+		{
+			LevelOfDetail &level = levels[j];
+			appendIndices(batch, groupLayouts[g], indices + level.startIndex, level.indexCount);
+			level.indexOffset = uint(publishedIndexBytes - level.indexCount * (groupLayouts[g].shortIndices ? sizeof(std::uint16_t) : sizeof(uint)));
+
+			if (batch.indexData.size() >= maximumBatchSize)
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				batches.push_back(std::move(batch));
+				batch = Batch();
+				batch.firstGroup = publishedGroups;
+			}
+		}
+	}
+
+	publishedIndices = indexCount;
+
+	batch.firstGroup = 0;
+	batch.groups.assign(groups, groups + groupCount);
+	batch.levelsOfDetail = std::move(levels);
+	applyIndexLayouts(batch);
+	publishedGroups = groupCount;
+
+	std::lock_guard<std::mutex> lock(mutex);
+	batches.push_back(std::move(batch));
+}
+
+// adds the indices up to the given end to a batch, split at the groups, groups are laid out when their first index is added
+void Model::LoadState::encodeIndices(Batch &batch, const Group *groups, std::size_t groupCount, const uint *indices, std::size_t indexEnd)
+{
+	while (publishedIndices < indexEnd)
+	{
+		while (groupLayouts.size() < groupCount && groups[groupLayouts.size()].startIndex <= publishedIndices)
+		{
+			const Group &group = groups[groupLayouts.size()];
+			Group layout;
+
+			// the range of vertices is only known once the group is complete, incomplete groups keep 32-bit indices
+			if (options.shortIndices && group.boundingSphereRadius >= 0.0f && group.endIndex > group.startIndex)
+			{
+				const auto range = std::minmax_element(indices + group.startIndex, indices + group.endIndex);
+
+				if (*range.second - *range.first <= std::numeric_limits<std::uint16_t>::max())
+				{
+					layout.shortIndices = true;
+					layout.baseVertex = *range.first;
+				}
+			}
+
+			groupLayouts.push_back(layout);
+		}
+
+		if (groupLayouts.empty())
+			break;
+
+		const Group &group = groups[groupLayouts.size() - 1];
+		const std::size_t end = std::min(indexEnd, std::size_t(group.endIndex));
+
+		if (end <= publishedIndices)
+			break;
+
+		// the offset of a group is that of its first index
+		Group &layout = groupLayouts.back();
+		const bool first = publishedIndices == group.startIndex;
+
+		appendIndices(batch, layout, indices + publishedIndices, end - publishedIndices);
+
+		if (first)
+			layout.indexOffset = uint(publishedIndexBytes - (end - publishedIndices) * (layout.shortIndices ? sizeof(std::uint16_t) : sizeof(uint)));
+
+		publishedIndices = end;
+	}
+}
+
+void Model::LoadState::appendIndices(Batch &batch, const Group &layout, const uint *indices, std::size_t indexCount)
+{
+	const std::size_t indexSize = layout.shortIndices ? sizeof(std::uint16_t) : sizeof(uint);
+
+	// offsets of indices in the index buffer have to be multiples of their size
+	const std::size_t padding = (indexSize - publishedIndexBytes % indexSize) % indexSize;
+	batch.indexData.resize(batch.indexData.size() + padding, 0);
+	publishedIndexBytes += padding;
+
+	const std::size_t offset = batch.indexData.size();
+	batch.indexData.resize(offset + indexCount * indexSize);
+
+	if (layout.shortIndices)
+	{
+		for (std::size_t i = 0; i < indexCount; i++)
+		{
+			const std::uint16_t index = std::uint16_t(indices[i] - layout.baseVertex);
+			std::memcpy(batch.indexData.data() + offset + i * indexSize, &index, indexSize);
+		}
+	}
+	else
+	{
+		std::memcpy(batch.indexData.data() + offset, indices, indexCount * indexSize);
+	}
+
+	batch.indexCount += indexCount;
+	publishedIndexBytes += indexCount * indexSize;
+}
 
-								groupIterator->positionIndices.push_back(groupIterator->positionIndices[groupIterator->positionIndices.size() - 2]);
-								groupIterator->texCoordIndices.push_back(groupIterator->texCoordIndices[groupIterator->texCoordIndices.size() - 2]);
-								groupIterator->normalIndices.push_back(groupIterator->normalIndices[groupIterator->normalIndices.size() - 2]);
+void Model::LoadState::applyIndexLayouts(Batch &batch) const
+{
+	for (std::size_t i = 0; i < batch.groups.size() && batch.firstGroup + i < groupLayouts.size(); i++)
+	{
+		const Group &layout = groupLayouts[batch.firstGroup + i];
+		batch.groups[i].indexOffset = layout.indexOffset;
+		batch.groups[i].baseVertex = layout.baseVertex;
+		batch.groups[i].shortIndices = layout.shortIndices;
+	}
+}
 
-								groupIterator->positionIndices.push_back(v < 0 ? (uint)(v + positions.size()) : (uint)(v));
-								groupIterator->texCoordIndices.push_back(t < 0 ? (uint)(t + texCoords.size()) : (uint)(t));
-								groupIterator->normalIndices.push_back(n < 0 ? (uint)(n + normals.size()) : (uint)(n));
-							}
+Model::TextureLoader::TextureLoader(const LoadOptions &options, const std::shared_ptr<TextureCache> &textureCache) : options(options), textureCache(textureCache), pool(options.threadCount)
+{
+}
 
-							break;
-						}
+Model::TextureLoader::~TextureLoader()
+{
+	cancel();
+	pool.wait();
+}
 
-						iss = std::istringstream(buffer);
-						iss >> token;
+void Model::TextureLoader::request(const Material &material, std::size_t materialIndex)
+{
+	struct TextureMember
+	{
+		std::string Material::*filename;
+		std::shared_ptr<Texture> Material::*texture;
+		TextureUsage usage;
+	};
 
-						if (iss >> v >> ("/") >> t)
-						{
-							// v/t
-							groupIterator->positionIndices.push_back(v < 0 ? (uint)(v + positions.size()) : (uint)(v));
-							groupIterator->texCoordIndices.push_back(t < 0 ? (uint)(t + texCoords.size()) : (uint)(t));
-							groupIterator->normalIndices.push_back(0);
+	static const std::array<TextureMember, 5> textureMembers = {{
+		{&Material::ambientTextureFilename, &Material::ambientTexture, TextureUsage::Color},
+		{&Material::diffuseTextureFilename, &Material::diffuseTexture, TextureUsage::Color},
+		{&Material::specularTextureFilename, &Material::specularTexture, TextureUsage::Color},
+		{&Material::shininessTextureFilename, &Material::shininessTexture, TextureUsage::Scalar},
+		{&Material::bumpTextureFilename, &Material::bumpTexture, TextureUsage::Bump},
+	}};
 
-							if (iss >> v >> ("/") >> t)
-							{
-								groupIterator->positionIndices.push_back(v < 0 ? (uint)(v + positions.size()) : (uint)(v));
-								groupIterator->texCoordIndices.push_back(t < 0 ? (uint)(t + texCoords.size()) : (uint)(t));
-								groupIterator->normalIndices.push_back(0);
-							}
+	// images are identified and decoded in parallel, only the finished pixel data is handed to the thread owning the OpenGL context
+	for (const auto &t : textureMembers)
+	{
+		const std::string &filename = material.*t.filename;
 
-							if (iss >> v >> ("/") >> t)
-							{
-								groupIterator->positionIndices.push_back(v < 0 ? (uint)(v + positions.size()) : (uint)(v));
-								groupIterator->texCoordIndices.push_back(t < 0 ? (uint)(t + texCoords.size()) : (uint)(t));
-								groupIterator->normalIndices.push_back(0);
-							}
+		if (filename.empty())
+			continue;
 
-							while (iss >> v >> ("/") >> t)
-							{
-								groupIterator->positionIndices.push_back(groupIterator->positionIndices[groupIterator->positionIndices.size() - 3]);
-								groupIterator->texCoordIndices.push_back(groupIterator->texCoordIndices[groupIterator->texCoordIndices.size() - 3]);
-								groupIterator->normalIndices.push_back(0);
+		requestedCount++;
 
-								groupIterator->positionIndices.push_back(groupIterator->positionIndices[groupIterator->positionIndices.size() - 2]);
-								groupIterator->texCoordIndices.push_back(groupIterator->texCoordIndices[groupIterator->texCoordIndices.size() - 2]);
-								groupIterator->normalIndices.push_back(0);
+		pool.add([this, filename, target = TextureTarget(materialIndex, t.texture), usage = t.usage]() {
+			loadReference(filename, target, usage);
 
-								groupIterator->positionIndices.push_back(v < 0 ? (uint)(v + positions.size()) : (uint)(v));
-								groupIterator->texCoordIndices.push_back(t < 0 ? (uint)(t + texCoords.size()) : (uint)(t));
-								groupIterator->normalIndices.push_back(0);
-							}
+			const std::size_t finished = ++finishedCount;
 
-							break;
-						}
-						else
-						{
-							iss = std::istringstream(buffer);
-							iss >> token;
+			if (progressCallback)
+				progressCallback(float(finished) / float(requestedCount));
+		});
+	}
+}
 
-							// v
-							if (iss >> v)
-							{
-								groupIterator->positionIndices.push_back(v < 0 ? (uint)(v + positions.size()) : (uint)(v));
-								groupIterator->texCoordIndices.push_back(0);
-								groupIterator->normalIndices.push_back(0);
-							}
+void Model::TextureLoader::cancel()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		cancelled = true;
+	}
 
-							if (iss >> v)
-							{
-								groupIterator->positionIndices.push_back(v < 0 ? (uint)(v + positions.size()) : (uint)(v));
-								groupIterator->texCoordIndices.push_back(0);
-								groupIterator->normalIndices.push_back(0);
-							}
+	textureSpace.notify_all();
+}
 
-							if (iss >> v)
-							{
-								groupIterator->positionIndices.push_back(v < 0 ? (uint)(v + positions.size()) : (uint)(v));
-								groupIterator->texCoordIndices.push_back(0);
-								groupIterator->normalIndices.push_back(0);
-							}
+void Model::TextureLoader::loadReference(const std::string &filename, const TextureTarget &target, TextureUsage usage)
+{
+	if (cancelled)
+		return;
 
-							while (iss >> v)
-							{
-								groupIterator->positionIndices.push_back(groupIterator->positionIndices[groupIterator->positionIndices.size() - 3]);
-								groupIterator->texCoordIndices.push_back(0);
-								groupIterator->normalIndices.push_back(0);
+	TextureCache::Key key;
 
-								groupIterator->positionIndices.push_back(groupIterator->positionIndices[groupIterator->positionIndices.size() - 2]);
-								groupIterator->texCoordIndices.push_back(0);
-								groupIterator->normalIndices.push_back(0);
+	if (!textureCache->identify(filename, key))
+		return;
 
-								groupIterator->positionIndices.push_back(v < 0 ? (uint)(v + positions.size()) : (uint)(v));
-								groupIterator->texCoordIndices.push_back(0);
-								groupIterator->normalIndices.push_back(0);
-							}
-						}
-					}
-					break;
-					}
-				}
-			}
-		}
+	// compressed textures are encoded differently depending on their usage
+	if (options.compressTextures)
+		key.variant = std::uint32_t(usage) + 1;
 
-		if (materials.size() <= 1)
+	// every image is only decoded once, no matter how many materials refer to it
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		auto i = decoding.find(key);
+
+		if (i != decoding.end())
 		{
-			std::filesystem::path libraryPath = path;
-			libraryPath.replace_extension("mtl");
-			loadMtlFile(libraryPath.string(), materials, materialMap);
+			i->second.targets.push_back(target);
+			return;
 		}
 
-		// compute normals if not present in the file
-		if (normals.size() <= 1)
+		for (auto &t : textures)
 		{
-			// compute face normals
-			for (std::list<ObjGroup>::iterator i = groupList.begin(); i != groupList.end(); i++)
+			if (t.key == key)
 			{
-				if (i->positionIndices.size() > 0)
-				{
-					for (uint j = 0; j < i->positionIndices.size() - 2; j += 3)
-					{
-						const vec3 &p0 = positions[i->positionIndices[j + 0]];
-						const vec3 &p1 = positions[i->positionIndices[j + 1]];
-						const vec3 &p2 = positions[i->positionIndices[j + 2]];
-
-						if (i->normalIndices[j + 0] == 0 || i->normalIndices[j + 1] == 0 || i->normalIndices[j + 2] == 0)
-						{
-							if (i->normalIndices[j + 0] == 0)
-								i->normalIndices[j + 0] = uint(normals.size());
-
-							if (i->normalIndices[j + 1] == 0)
-								i->normalIndices[j + 1] = uint(normals.size());
-
-							if (i->normalIndices[j + 2] == 0)
-								i->normalIndices[j + 2] = uint(normals.size());
-
-							const vec3 a(p2 - p1);
-							const vec3 b(p0 - p1);
-							const vec3 n = normalize(cross(a, b));
-							normals.push_back(n);
-						}
-					}
-				}
+				t.targets.push_back(target);
+				return;
 			}
+		}
 
-			// compute vertex normals
-			std::vector<vec3> vertexNormals(positions.size());
-			std::vector<vec3> groupNormals(positions.size());
+		TextureUpload &upload = decoding[key];
+		upload.key = key;
+		upload.filename = filename;
+		upload.usage = usage;
+		upload.targets.push_back(target);
+	}
 
-			for (std::list<ObjGroup>::iterator i = groupList.begin(); i != groupList.end(); i++)
-			{
-				if (i->positionIndices.size() > 0)
-				{
-					for (uint j = 0; j < i->positionIndices.size() - 2; j += 3)
-					{
-						groupNormals[i->positionIndices[j + 0]] = groupNormals[i->positionIndices[j + 0]] + normals[i->normalIndices[j + 0]];
-						groupNormals[i->positionIndices[j + 1]] = groupNormals[i->positionIndices[j + 1]] + normals[i->normalIndices[j + 1]];
-						groupNormals[i->positionIndices[j + 2]] = groupNormals[i->positionIndices[j + 2]] + normals[i->normalIndices[j + 2]];
-					}
+	TextureImage image;
 
-					for (uint j = 0; j < i->positionIndices.size() - 2; j += 3)
-					{
-						vertexNormals[i->positionIndices[j + 0]] = normalize(groupNormals[i->positionIndices[j + 0]]);
-						vertexNormals[i->positionIndices[j + 1]] = normalize(groupNormals[i->positionIndices[j + 1]]);
-						vertexNormals[i->positionIndices[j + 2]] = normalize(groupNormals[i->positionIndices[j + 2]]);
-					}
+	if (!textureCache->contains(key))
+		image = loadTexture(filename, options, usage, &pool);
 
-					for (uint j = 0; j < i->positionIndices.size() - 2; j += 3)
-					{
-						groupNormals[i->positionIndices[j + 0]] = vec3(0.0f);
-						groupNormals[i->positionIndices[j + 1]] = vec3(0.0f);
-						groupNormals[i->positionIndices[j + 2]] = vec3(0.0f);
-					}
+	const std::size_t imageSize = image.size();
+	std::unique_lock<std::mutex> lock(mutex);
 
-					i->normalIndices = i->positionIndices;
-				}
-			}
+	// decoding is paused while too much pixel data is waiting for upload, unless nobody is uploading until loading is finished
+	if (options.background || options.lazyTextures)
+		textureSpace.wait(lock, [&]() { return cancelled || queuedTextureSize == 0 || queuedTextureSize + imageSize <= maximumQueuedTextureSize; });
 
-			normals.swap(vertexNormals);
-		}
+	auto i = decoding.find(key);
+	i->second.image = std::move(image);
+	queuedTextureSize += imageSize;
+	textures.push_back(std::move(i->second));
+	decoding.erase(i);
+}
 
-		m_vertices.resize(positions.size());
+void Model::LoadState::publishArrays(std::vector<Vertex> &&vertices, std::vector<uint> &&indices)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	this->vertices = std::move(vertices);
+	this->indices = std::move(indices);
+	geometryReady = true;
+}
 
-		for (std::list<ObjGroup>::iterator i = groupList.begin(); i != groupList.end(); i++)
-		{
-			if (i->positionIndices.size() > 0)
-			{
-				Group newGroup;
-				newGroup.name = i->name;
-				newGroup.startIndex = uint(m_indices.size());
+// flattens the hierarchy for bvhNodeTexture() and bvhTriangleTexture(), so that a shader fetches one node per step of the traversal
+void Model::LoadState::publishBvh(Bvh &&bvh, const Vertex *vertices, const std::vector<Group> &groups)
+{
+	const std::vector<BvhNode> &nodes = bvh.nodes();
+	std::vector<vec4> nodeTexels;
+	std::vector<vec4> triangleTexels;
 
-				std::unordered_map<std::string, int>::iterator j = materialMap.find(i->material);
+	if (!nodes.empty())
+	{
+		std::vector<uint> innerNodes(nodes.size(), 0);
+		uint innerNodeCount = 0;
 
-				if (j != materialMap.end())
-					newGroup.materialIndex = j->second;
-				else
-					newGroup.materialIndex = 0;
+		for (std::size_t i = 0; i < nodes.size(); i++)
+		{
+			if (nodes[i].triangleCount == 0)
+				innerNodes[i] = innerNodeCount++;
+		}
 
-				for (uint j = 0; j < i->positionIndices.size(); j++)
-				{
-					const uint index = i->positionIndices[j];
+		auto appendChild = [&](std::size_t child) {
+			const BvhNode &node = nodes[child];
+			nodeTexels.emplace_back(node.minimumBounds, uintBitsToFloat(node.triangleCount == 0 ? innerNodes[child] : node.offset));
+			nodeTexels.emplace_back(node.maximumBounds, uintBitsToFloat(node.triangleCount));
+		};
 
-					Vertex vertex;
-					vertex.position = positions[index];
-					vertex.normal = normals[i->normalIndices[j]];
-					vertex.texcoord = texCoords[i->texCoordIndices[j]];
+		nodeTexels.reserve(4 * std::max(innerNodeCount, 1u));
 
-					if (m_vertices[index].position == vertex.position)
-					{
-						if (m_vertices[index].texcoord != vertex.texcoord || m_vertices[index].normal != vertex.normal)
-						{
-							m_indices.push_back(uint(m_vertices.size()));
-							m_vertices.push_back(vertex);
-						}
-						else
-						{
-							m_vertices[index] = vertex;
-							m_indices.push_back(index);
-						}
-					}
-					else
-					{
-						m_vertices[index] = vertex;
-						m_indices.push_back(index);
-					}
-				}
+		// a hierarchy of a single leaf gets a node with the leaf as both children
+		if (innerNodeCount == 0)
+		{
+			appendChild(0);
+			appendChild(0);
+		}
 
-				newGroup.endIndex = uint(m_indices.size());
-				m_groups.push_back(newGroup);
+		for (std::size_t i = 0; i < nodes.size(); i++)
+		{
+			if (nodes[i].triangleCount == 0)
+			{
+				appendChild(i + 1);
+				appendChild(nodes[i].offset);
 			}
 		}
 
-		m_materials.reserve(materials.size());
+		triangleTexels.reserve(3 * bvh.triangles().size());
 
-		for (auto &m : materials)
+		for (const BvhTriangle &triangle : bvh.triangles())
 		{
-			Material newMaterial;
-			newMaterial.ambient = m.Ka;
-			newMaterial.diffuse = m.Kd;
-			newMaterial.specular = m.Ks;
-			newMaterial.shininess = m.Ns;
+			// the group containing the triangle is the last one starting before it
+			auto group = std::upper_bound(groups.begin(), groups.end(), triangle.triangle * 3, [](uint index, const Group &g) { return index < g.startIndex; });
+			const uint materialIndex = group != groups.begin() ? std::prev(group)->materialIndex : 0;
+
+			const vec3 position = vertices[triangle.indices[0]].position;
+			triangleTexels.emplace_back(position, uintBitsToFloat(triangle.triangle));
+			triangleTexels.emplace_back(vertices[triangle.indices[1]].position - position, uintBitsToFloat(materialIndex));
+			triangleTexels.emplace_back(vertices[triangle.indices[2]].position - position, 0.0f);
+		}
+	}
 
-			if (!m.map_Ka.empty())
-			{
-				std::filesystem::path texturePath = m.map_Ka;
+	std::lock_guard<std::mutex> lock(mutex);
+	this->bvh = std::move(bvh);
+	bvhNodeTexels = std::move(nodeTexels);
+	bvhTriangleTexels = std::move(triangleTexels);
+	bvhReady = true;
+}
 
-				if (!texturePath.is_absolute())
-				{
-					texturePath = path.parent_path();
-					texturePath.append(m.map_Ka);
-				}
+// the hierarchy only covers the triangles of the groups, not those of their levels of detail behind them
+void Model::LoadState::buildBvh(Bvh &bvh, const Vertex *vertices, const uint *indices, const std::vector<Group> &groups)
+{
+	setProgress("Building BVH", 0.0f);
+	bvh.build(vertices, indices, groups.empty() ? 0 : groups.back().endIndex, options.threadCount);
 
-				newMaterial.ambientTexture = std::move(loadTexture(texturePath.string()));
-			}
+	const Bvh::Statistics &statistics = bvh.statistics();
+	globjects::debug() << "Built BVH over " << statistics.triangleCount << " triangles in " << statistics.buildTime << " s, " << statistics.nodeCount << " nodes (" << statistics.leafCount << " leaves, depth " << statistics.depth << "), SAH cost " << statistics.sahCost;
+}
 
-			if (!m.map_Kd.empty())
-			{
-				std::filesystem::path texturePath = m.map_Kd;
+Model::Model() : m_textureCache(std::make_shared<TextureCache>())
+{
+}
 
-				if (!texturePath.is_absolute())
-				{
-					texturePath = path.parent_path();
-					texturePath.append(m.map_Kd);
-				}
+Model::Model(const std::string &filename, const LoadOptions &options) : m_textureCache(std::make_shared<TextureCache>())
+{
+	load(filename, options);
+}
 
-				newMaterial.diffuseTexture = std::move(loadTexture(texturePath.string()));
-			}
+Model::Model(Model &&model) noexcept = default;
 
-			if (!m.map_Ks.empty())
-			{
-				std::filesystem::path texturePath = m.map_Ks;
+Model::~Model()
+{
+}
 
-				if (!texturePath.is_absolute())
-				{
-					texturePath = path.parent_path();
-					texturePath.append(m.map_Ks);
-				}
+Model &Model::operator=(Model &&model) noexcept = default;
 
-				newMaterial.specularTexture = std::move(loadTexture(texturePath.string()));
-			}
+void Model::load(const std::string &filename, const LoadOptions &options)
+{
+	cancelLoading();
 
-			if (!m.map_Ns.empty())
-			{
-				std::filesystem::path texturePath = m.map_Ns;
+	globjects::debug() << "Loading file " << filename << " ...";
 
-				if (!texturePath.is_absolute())
-				{
-					texturePath = path.parent_path();
-					texturePath.append(m.map_Ns);
-				}
+	m_filename = filename;
+	m_groups.clear();
+	m_meshlets.clear();
+	m_levelsOfDetail.clear();
+	m_bvh.clear();
+	m_bvhNodeTexture.reset();
+	m_bvhTriangleTexture.reset();
+	m_bvhNodeBuffer.reset();
+	m_bvhTriangleBuffer.reset();
+	m_vertices.clear();
+	m_indices.clear();
+	m_materials.clear();
+
+	m_minimumBounds = vec3(0.0f);
+	m_maximumBounds = vec3(0.0f);
+
+	m_vertexFormat = options.vertexFormat;
+	m_positionOffset = vec3(0.0f);
+	m_positionScale = vec3(1.0f);
+
+	m_vertexCount = 0;
+	m_indexCount = 0;
+	m_indexBufferSize = 0;
+	m_vertexBufferCapacity = 0;
+	m_indexBufferCapacity = 0;
+
+	m_textureLoader = std::make_shared<TextureLoader>(options, m_textureCache);
+
+	m_loadState = std::make_unique<LoadState>();
+	m_loadState->textureLoader = m_textureLoader;
+	m_loadState->filename = filename;
+	m_loadState->options = options;
+	m_loadState->start = std::chrono::steady_clock::now();
+
+	if (options.background)
+	{
+		m_loadState->thread = std::thread(&LoadState::run, m_loadState.get());
+	}
+	else
+	{
+		m_loadState->run();
 
-				newMaterial.shininessTexture = std::move(loadTexture(texturePath.string()));
-			}
+		while (isLoading())
+			update();
+	}
+}
 
-			if (!m.map_bump.empty())
-			{
-				std::filesystem::path texturePath = m.map_bump;
+bool Model::update()
+{
+	if (!m_loadState && !m_textureLoader)
+		return false;
 
-				if (!texturePath.is_absolute())
-				{
-					texturePath = path.parent_path();
-					texturePath.append(m.map_bump);
-				}
+	// time spent on uploads per call, so that the frame rate stays interactive while loading
+	static constexpr std::chrono::milliseconds uploadBudget(8);
 
-				newMaterial.bumpTexture = std::move(loadTexture(texturePath.string()));
-			}
+	const auto updateStart = std::chrono::steady_clock::now();
+	bool changed = false;
 
-			m_materials.push_back(newMaterial);
+	while (std::chrono::steady_clock::now() - updateStart < uploadBudget)
+	{
+		// textures are handed out after loading as well, as long as they are requested by drawing
+		if (!m_loadState)
+		{
+			if (!uploadTexture())
+				break;
+
+			continue;
 		}
 
-		return true;
-	}
+		std::unique_lock<std::mutex> lock(m_loadState->mutex);
+
+		if (m_loadState->materialsReady)
+		{
+			m_materials = std::move(m_loadState->materials);
+			m_loadState->materialsReady = false;
+			changed = true;
+		}
+		else if (m_loadState->boundsReady)
+		{
+			m_positionOffset = m_loadState->positionOffset;
+			m_positionScale = m_loadState->positionScale;
+			m_loadState->boundsReady = false;
+		}
+		else if (!m_loadState->batches.empty())
+		{
+			LoadState::Batch batch = std::move(m_loadState->batches.front());
+			m_loadState->batches.pop_front();
+			lock.unlock();
 
-	bool loadMtlFile(const std::string &filename, std::vector<ObjMaterial> &materials, std::unordered_map<std::string, int> &materialMap)
-	{
-		std::ifstream is(filename);
+			const bool packed = m_vertexFormat == VertexFormat::Packed;
+			const std::size_t vertexSize = packed ? sizeof(PackedVertex) : sizeof(Vertex);
+			const std::size_t batchVertexCount = packed ? batch.packedVertices.size() : batch.vertices.size();
+			const void *vertexData = packed ? static_cast<const void *>(batch.packedVertices.data()) : static_cast<const void *>(batch.vertices.data());
 
-		if (!is.is_open())
-			return false;
+			const bool vertexBufferReplaced = appendToBuffer(m_vertexBuffer, m_vertexBufferCapacity, m_vertexCount * vertexSize, vertexData, batchVertexCount * vertexSize);
+			const bool indexBufferReplaced = appendToBuffer(m_indexBuffer, m_indexBufferCapacity, m_indexBufferSize, batch.indexData.data(), batch.indexData.size());
 
-		std::string buffer;
-		int currentMaterialIndex = 0;
+			if (vertexBufferReplaced || indexBufferReplaced)
+				initializeVertexArray();
 
-		while (is.good())
-		{
-			if (getline(is, buffer))
+			if (batchVertexCount > 0)
 			{
-				std::istringstream iss(buffer);
-				std::string token;
+				m_minimumBounds = m_vertexCount == 0 ? batch.minimumBounds : min(m_minimumBounds, batch.minimumBounds);
+				m_maximumBounds = m_vertexCount == 0 ? batch.maximumBounds : max(m_maximumBounds, batch.maximumBounds);
+			}
 
-				if (iss >> token)
-				{
-					if (token == "newmtl")
-					{
-						std::string materialName;
+			// batches are only needed for the upload, main memory copies are handed over at the end
+			m_vertexCount += batchVertexCount;
+			m_indexCount += batch.indexCount;
+			m_indexBufferSize += batch.indexData.size();
 
-						if (getline(iss, materialName))
-						{
-							materialName = trim(materialName);
+			if (!batch.groups.empty())
+			{
+				m_groups.resize(batch.firstGroup);
+				m_groups.insert(m_groups.end(), batch.groups.begin(), batch.groups.end());
+			}
 
-							auto i = materialMap.find(materialName);
+			m_meshlets.insert(m_meshlets.end(), batch.meshlets.begin(), batch.meshlets.end());
+			m_levelsOfDetail.insert(m_levelsOfDetail.end(), batch.levelsOfDetail.begin(), batch.levelsOfDetail.end());
 
-							if (i == materialMap.end())
-							{
-								ObjMaterial newMaterial;
-								newMaterial.name = materialName;
-								currentMaterialIndex = uint(materials.size());
-								materialMap.insert(std::make_pair(newMaterial.name, currentMaterialIndex));
-								materials.push_back(newMaterial);
-							}
-							else
-							{
-								currentMaterialIndex = i->second;
-							}
-						}
-					}
-					// Ambient Color
-					else if (token == "Ka")
-					{
-						vec3 Ka(0.0f);
-						if (iss >> Ka.x >> Ka.y >> Ka.z)
-							materials[currentMaterialIndex].Ka = Ka;
-					}
-					// Diffuse Color
-					else if (token == "Kd")
-					{
-						vec3 Kd(0.0f);
-						if (iss >> Kd.x >> Kd.y >> Kd.z)
-							materials[currentMaterialIndex].Kd = Kd;
-					}
-					// Specular Color
-					else if (token == "Ks")
-					{
-						vec3 Ks(0.0f);
-						if (iss >> Ks.x >> Ks.y >> Ks.z)
-							materials[currentMaterialIndex].Ks = Ks;
-					}
-					// Specular Exponent
-					else if (token == "Ns")
-					{
-						float Ns = 0.0f;
-						if (iss >> Ns)
-							materials[currentMaterialIndex].Ns = Ns;
-					}
-					// Dissolve
-					else if (token == "d")
-					{
-						float d = 0.0f;
-						if (iss >> d)
-							materials[currentMaterialIndex].d = d;
-					}
-					// Illumination
-					else if (token == "illum")
-					{
-						int illum = 0;
-						if (iss >> illum)
-							materials[currentMaterialIndex].illum = illum;
-					}
-					// Ambient Texture Map
-					else if (token == "map_Ka")
-					{
-						std::string map_Ka;
-						if (getline(iss, map_Ka))
-						{
-							map_Ka = trim(map_Ka);
-							materials[currentMaterialIndex].map_Ka = map_Ka;
-						}
-					}
-					// Diffuse Texture Map
-					else if (token == "map_Kd")
-					{
-						std::string map_Kd;
-						if (getline(iss, map_Kd))
-						{
-							map_Kd = trim(map_Kd);
-							materials[currentMaterialIndex].map_Kd = map_Kd;
-						}
-					}
-					// Specular Texture Map
-					else if (token == "map_Ks")
-					{
-						std::string map_Ks;
-						if (getline(iss, map_Ks))
-						{
-							map_Ks = trim(map_Ks);
-							materials[currentMaterialIndex].map_Ks = map_Ks;
-						}
-					}
-					// Specular Hightlight Map
-					else if (token == "map_Ns")
-					{
-						std::string map_Ns;
-						if (getline(iss, map_Ns))
-						{
-							map_Ns = trim(map_Ns);
-							materials[currentMaterialIndex].map_Ns = map_Ns;
-						}
-					}
-					// Alpha Texture Map
-					else if (token == "map_d")
-					{
-						std::string map_d;
-						if (getline(iss, map_d))
-						{
-							map_d = trim(map_d);
-							materials[currentMaterialIndex].map_d = map_d;
-						}
-					}
-					// Bump Map
-					else if (token == "map_bump" || token == "map_Bump" || token == "bump")
-					{
-						std::string map_bump;
-						if (getline(iss, map_bump))
-						{
-							map_bump = trim(map_bump);
-							materials[currentMaterialIndex].map_bump = map_bump;
-						}
-					}
-				}
-			}
+			changed = true;
 		}
+		else if (m_loadState->bvhReady)
+		{
+			m_bvh = std::move(m_loadState->bvh);
+			m_loadState->bvhReady = false;
 
-		return true;
-	}
+			if (!m_loadState->bvhNodeTexels.empty())
+			{
+				m_bvhNodeBuffer = std::make_unique<Buffer>();
+				m_bvhNodeBuffer->setData(m_loadState->bvhNodeTexels, GL_STATIC_DRAW);
+				m_bvhNodeTexture = Texture::create(GL_TEXTURE_BUFFER);
+				m_bvhNodeTexture->texBuffer(GL_RGBA32F, m_bvhNodeBuffer.get());
 
-	std::unique_ptr<Texture> loadTexture(const std::string &filename)
-	{
-		int width, height, channels;
+				m_bvhTriangleBuffer = std::make_unique<Buffer>();
+				m_bvhTriangleBuffer->setData(m_loadState->bvhTriangleTexels, GL_STATIC_DRAW);
+				m_bvhTriangleTexture = Texture::create(GL_TEXTURE_BUFFER);
+				m_bvhTriangleTexture->texBuffer(GL_RGBA32F, m_bvhTriangleBuffer.get());
 
-		stbi_set_flip_vertically_on_load(true);
-		unsigned char *data = stbi_load(filename.c_str(), &width, &height, &channels, 0);
+				globjects::debug() << "Uploaded BVH textures with " << m_loadState->bvhNodeTexels.size() / 4 << " nodes and " << m_loadState->bvhTriangleTexels.size() / 3 << " triangles (" << megabytes((m_loadState->bvhNodeTexels.size() + m_loadState->bvhTriangleTexels.size()) * sizeof(vec4)) << " MB)";
+			}
 
-		if (data)
+			m_loadState->bvhNodeTexels = std::vector<vec4>();
+			m_loadState->bvhTriangleTexels = std::vector<vec4>();
+		}
+		else if (m_loadState->geometryReady)
 		{
-			std::cout << "Loaded " << filename << std::endl;
-
-			auto texture = Texture::create(GL_TEXTURE_2D);
-			texture->setParameter(GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-			texture->setParameter(GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-			texture->setParameter(GL_TEXTURE_WRAP_S, GL_REPEAT);
-			texture->setParameter(GL_TEXTURE_WRAP_T, GL_REPEAT);
+			m_vertices = std::move(m_loadState->vertices);
+			m_indices = std::move(m_loadState->indices);
+			m_loadState->geometryReady = false;
+		}
+		else
+		{
+			// everything has been received once the loading thread is finished and the queues are empty
+			const bool finished = m_loadState->finished;
+			lock.unlock();
 
-			GLenum format = GL_RGBA;
+			if (uploadTexture())
+				continue;
 
-			switch (channels)
+			if (finished)
 			{
-			case 1:
-				format = GL_RED;
-				break;
+				if (m_loadState->thread.joinable())
+					m_loadState->thread.join();
 
-			case 2:
-				format = GL_RG;
-				break;
+				globjects::debug() << "Minimum bounds: " << m_minimumBounds;
+				globjects::debug() << "Maximum bounds: " << m_maximumBounds;
 
-			case 3:
-				format = GL_RGB;
-				break;
+				const std::chrono::duration<double> loadTime = std::chrono::steady_clock::now() - m_loadState->start;
+				globjects::debug() << "Loaded " << m_vertexCount << " vertices and " << m_indexCount / 3 << " triangles in " << loadTime.count() << " s";
+				globjects::debug() << "Index buffer uses " << megabytes(m_indexBufferSize) << " MB (" << megabytes(m_indexCount * sizeof(uint)) << " MB with 32-bit indices)";
+				globjects::debug() << "Process memory is " << megabytes(currentMemoryUsage()) << " MB (" << megabytes(peakMemoryUsage()) << " MB at peak)";
 
-			case 4:
-				format = GL_RGBA;
-				break;
+				const TextureCache::Statistics statistics = m_textureCache->statistics();
+				globjects::debug() << "Texture cache contains " << statistics.textureCount << " textures (" << megabytes(statistics.textureBytes) << " MB, " << megabytes(statistics.uncompressedBytes) << " MB uncompressed) after " << statistics.hits << " hits and " << statistics.misses << " misses, sharing saved " << megabytes(statistics.bytesSaved) << " MB";
+
+				m_loadState.reset();
+				changed = true;
 			}
 
-			texture->image2D(0, format, ivec2(width, height), 0, format, GL_UNSIGNED_BYTE, data);
-			texture->generateMipmap();
+			break;
+		}
+	}
 
-			stbi_image_free(data);
+	return changed;
+}
 
-			return texture;
-		}
+bool Model::uploadTexture()
+{
+	if (!m_textureLoader)
+		return false;
 
-		return std::unique_ptr<Texture>();
-	}
+	TextureLoader::TextureUpload upload;
 
-	const std::vector<Group> &groups() const
 	{
-		return m_groups;
-	}
+		std::lock_guard<std::mutex> lock(m_textureLoader->mutex);
 
-	const std::vector<Vertex> &vertices() const
-	{
-		return m_vertices;
+		if (m_textureLoader->textures.empty())
+			return false;
+
+		upload = std::move(m_textureLoader->textures.front());
+		m_textureLoader->textures.pop_front();
+		m_textureLoader->queuedTextureSize -= upload.image.size();
 	}
 
-	const std::vector<uint> &indices() const
+	m_textureLoader->textureSpace.notify_all();
+
+	std::shared_ptr<Texture> texture = m_textureCache->find(upload.key);
+
+	if (!texture)
 	{
-		return m_indices;
+		// the texture may have been released since the loading thread found it in the cache
+		if (!upload.image.data)
+			upload.image = loadTexture(upload.filename, m_textureLoader->options, upload.usage, nullptr);
+
+		// with streaming only the coarse levels are uploaded now
+		const std::size_t baseLevel = m_textureStreamer ? TextureStreamer::tailLevel(upload.image) : 0;
+		std::unique_ptr<Texture> created = upload.image.createTexture(baseLevel);
+		const Texture *createdTexture = created.get();
+
+		texture = m_textureCache->insert(upload.key, std::move(created), upload.image.size(), upload.image.uncompressedSize());
+
+		if (m_textureStreamer && texture.get() == createdTexture)
+			m_textureStreamer->add(texture, upload.image);
 	}
 
-	const std::vector<Material> &materials() const
+	for (std::size_t i = 0; i < upload.targets.size(); i++)
 	{
-		return m_materials;
+		const TextureLoader::TextureTarget &target = upload.targets[i];
+
+		// further references count as cache hits as well
+		if (i > 0)
+			texture = m_textureCache->find(upload.key);
+
+		if (target.first < m_materials.size())
+			m_materials[target.first].*target.second = texture;
 	}
 
-private:
-	std::vector<Group> m_groups;
-	std::vector<Vertex> m_vertices;
-	std::vector<glm::uint> m_indices;
-	std::vector<Material> m_materials;
-};
+	return true;
+}
+
+void Model::requestTextures(std::size_t materialIndex)
+{
+	if (!m_textureLoader || !m_textureLoader->options.lazyTextures || materialIndex >= m_materials.size())
+		return;
+
+	std::vector<bool> &requested = m_textureLoader->requestedMaterials;
 
-Model::Model()
+	if (requested.size() < m_materials.size())
+		requested.resize(m_materials.size(), false);
+
+	if (requested[materialIndex])
+		return;
+
+	requested[materialIndex] = true;
+	m_textureLoader->request(m_materials[materialIndex], materialIndex);
+}
+
+bool Model::isLoading() const
 {
+	return bool(m_loadState);
 }
 
-Model::Model(const std::string &filename)
+float Model::loadProgress() const
 {
-	load(filename);
+	return m_loadState ? m_loadState->progress.load() : 1.0f;
 }
 
-void Model::load(const std::string &filename)
+std::string Model::loadStage() const
 {
-	globjects::debug() << "Loading file " << filename << " ...";
+	if (!m_loadState)
+		return std::string();
 
-	m_minimumBounds = vec3(std::numeric_limits<float>::max());
-	m_maximumBounds = vec3(-std::numeric_limits<float>::max());
+	std::lock_guard<std::mutex> lock(m_loadState->mutex);
+	return m_loadState->stage;
+}
 
-	ObjLoader loader;
+void Model::cancelLoading()
+{
+	// the loading thread and the texture decoding tasks are stopped by the destructors of the load state and the texture loader
+	m_loadState.reset();
+	m_textureLoader.reset();
+}
 
-	if (loader.loadObjFile(filename))
+void Model::initializeVertexArray()
+{
+	if (m_vertexFormat == VertexFormat::Packed)
 	{
-		m_filename = filename;
-		m_vertices = loader.vertices();
-		m_indices = loader.indices();
-		m_materials = loader.materials();
-		m_groups = loader.groups();
-
-		for (auto i : m_indices)
-		{
-			const auto &v = m_vertices[i];
-			m_minimumBounds = min(m_minimumBounds, v.position);
-			m_maximumBounds = max(m_maximumBounds, v.position);
-		}
-
-		globjects::debug() << "Minimum bounds: " << m_minimumBounds;
-		globjects::debug() << "Maximum bounds: " << m_maximumBounds;
-
-		m_vertexBuffer->setData(m_vertices, gl::GL_STATIC_DRAW);
-		m_indexBuffer->setData(m_indices, gl::GL_STATIC_DRAW);
-
 		auto vertexBindingPosition = m_vertexArray->binding(0);
 		vertexBindingPosition->setAttribute(0);
-		vertexBindingPosition->setBuffer(m_vertexBuffer.get(), 0, sizeof(Vertex));
-		vertexBindingPosition->setFormat(3, GL_FLOAT);
+		vertexBindingPosition->setBuffer(m_vertexBuffer.get(), offsetof(PackedVertex, position), sizeof(PackedVertex));
+		vertexBindingPosition->setFormat(3, GL_UNSIGNED_SHORT, GL_TRUE);
 		m_vertexArray->enable(0);
 
 		auto vertexBindingNormal = m_vertexArray->binding(1);
 		vertexBindingNormal->setAttribute(1);
-		vertexBindingNormal->setBuffer(m_vertexBuffer.get(), sizeof(vec3), sizeof(Vertex));
-		vertexBindingNormal->setFormat(3, GL_FLOAT);
+		vertexBindingNormal->setBuffer(m_vertexBuffer.get(), offsetof(PackedVertex, normal), sizeof(PackedVertex));
+		vertexBindingNormal->setFormat(2, GL_SHORT, GL_TRUE);
 		m_vertexArray->enable(1);
 
 		auto vertexBindingTexCoord = m_vertexArray->binding(2);
 		vertexBindingTexCoord->setAttribute(2);
-		vertexBindingTexCoord->setBuffer(m_vertexBuffer.get(), sizeof(vec3) + sizeof(vec3), sizeof(Vertex));
-		vertexBindingTexCoord->setFormat(2, GL_FLOAT);
+		vertexBindingTexCoord->setBuffer(m_vertexBuffer.get(), offsetof(PackedVertex, texcoord), sizeof(PackedVertex));
+		vertexBindingTexCoord->setFormat(2, GL_HALF_FLOAT);
 		m_vertexArray->enable(2);
 
 		m_vertexArray->bindElementBuffer(m_indexBuffer.get());
+		return;
 	}
-	else
-	{
-		globjects::debug() << "Error loading << " << filename << "!";
-	}
+
+	auto vertexBindingPosition = m_vertexArray->binding(0);
+	vertexBindingPosition->setAttribute(0);
+	vertexBindingPosition->setBuffer(m_vertexBuffer.get(), 0, sizeof(Vertex));
+	vertexBindingPosition->setFormat(3, GL_FLOAT);
+	m_vertexArray->enable(0);
+
+	auto vertexBindingNormal = m_vertexArray->binding(1);
+	vertexBindingNormal->setAttribute(1);
+	vertexBindingNormal->setBuffer(m_vertexBuffer.get(), sizeof(vec3), sizeof(Vertex));
+	vertexBindingNormal->setFormat(3, GL_FLOAT);
+	m_vertexArray->enable(1);
+
+	auto vertexBindingTexCoord = m_vertexArray->binding(2);
+	vertexBindingTexCoord->setAttribute(2);
+	vertexBindingTexCoord->setBuffer(m_vertexBuffer.get(), sizeof(vec3) + sizeof(vec3), sizeof(Vertex));
+	vertexBindingTexCoord->setFormat(2, GL_FLOAT);
+	m_vertexArray->enable(2);
+
+	m_vertexArray->bindElementBuffer(m_indexBuffer.get());
 }
 
 const std::string &Model::filename() const
@@ -979,6 +3291,46 @@ const std::vector<uint> &Model::indices() const
 	return m_indices;
 }
 
+const Bvh &Model::bvh() const
+{
+	return m_bvh;
+}
+
+Texture *Model::bvhNodeTexture()
+{
+	return m_bvhNodeTexture.get();
+}
+
+Texture *Model::bvhTriangleTexture()
+{
+	return m_bvhTriangleTexture.get();
+}
+
+std::size_t Model::vertexCount() const
+{
+	return m_vertexCount;
+}
+
+std::size_t Model::indexCount() const
+{
+	return m_indexCount;
+}
+
+std::size_t Model::indexBufferSize() const
+{
+	return m_indexBufferSize;
+}
+
+const std::vector<Meshlet> &Model::meshlets() const
+{
+	return m_meshlets;
+}
+
+const std::vector<LevelOfDetail> &Model::levelsOfDetail() const
+{
+	return m_levelsOfDetail;
+}
+
 const std::vector<Material> &Model::materials() const
 {
 	return m_materials;
@@ -994,6 +3346,21 @@ vec3 Model::maximumBounds() const
 	return m_maximumBounds;
 }
 
+VertexFormat Model::vertexFormat() const
+{
+	return m_vertexFormat;
+}
+
+vec3 Model::positionOffset() const
+{
+	return m_positionOffset;
+}
+
+vec3 Model::positionScale() const
+{
+	return m_positionScale;
+}
+
 VertexArray &Model::vertexArray()
 {
 	return *m_vertexArray.get();
@@ -1004,6 +3371,26 @@ Buffer &Model::vertexBuffer()
 	return *m_vertexBuffer.get();
 }
 
+void Model::setTextureCache(const std::shared_ptr<TextureCache> &textureCache)
+{
+	m_textureCache = textureCache;
+}
+
+const std::shared_ptr<TextureCache> &Model::textureCache() const
+{
+	return m_textureCache;
+}
+
+void Model::setTextureStreamer(const std::shared_ptr<TextureStreamer> &textureStreamer)
+{
+	m_textureStreamer = textureStreamer;
+}
+
+const std::shared_ptr<TextureStreamer> &Model::textureStreamer() const
+{
+	return m_textureStreamer;
+}
+
 Buffer &Model::indexBuffer()
 {
 	return *m_indexBuffer.get();
@@ -10,9 +10,17 @@
 #include <globjects/Buffer.h>
 
 #include <vector>
+#include <memory>
+#include <string>
+#include <cstdint>
+
+#include "Bvh.h"
 
 namespace minity
 {
+	class TextureCache;
+	class TextureStreamer;
+
 	struct Vertex
 	{
 		glm::vec3 position;
@@ -20,20 +28,79 @@ namespace minity
 		glm::vec2 texcoord;
 	};
 
+	// compact vertex layout in the vertex buffer, decoded by the vertex shader
+	struct PackedVertex
+	{
+		// 16-bit fixed point relative to the bounds of the model, the fourth component is padding
+		std::uint16_t position[4];
+		// octahedral encoding as 16-bit signed normalized values
+		std::int16_t normal[2];
+		// half floats
+		std::uint16_t texcoord[2];
+	};
+
 	struct Group
 	{
 		std::string name;
 		glm::uint materialIndex = 0;
+		// range of the indices of the group, the end is exclusive
 		glm::uint startIndex = 0;
 		glm::uint endIndex = 0;
+
+		// bounds of the vertices used by the group, only valid once the group is complete
+		glm::vec3 minimumBounds = glm::vec3(0.0f);
+		glm::vec3 maximumBounds = glm::vec3(0.0f);
+		// sphere around the center of the bounds enclosing all vertices of the group, the radius is negative while the group is incomplete
+		glm::vec3 boundingSphereCenter = glm::vec3(0.0f);
+		float boundingSphereRadius = -1.0f;
+		// texture coordinate units per unit of object space, used to find the texture resolution that is visible on screen
+		float texCoordDensity = 0.0f;
+		// meshlets covering the indices of the group, only set once the group is complete
+		glm::uint firstMeshlet = 0;
+		glm::uint meshletCount = 0;
+		// simplified versions of the group in the order of increasing error, only set once loading has finished
+		glm::uint firstLevelOfDetail = 0;
+		glm::uint levelOfDetailCount = 0;
+		// layout of the indices of the group and its levels of detail in the index buffer, set when they are uploaded
+		// 16-bit indices are relative to the base vertex, the offset of the first index is in bytes
+		glm::uint indexOffset = 0;
+		glm::uint baseVertex = 0;
+		bool shortIndices = false;
 		
 		glm::uint count() const
 		{
-			return endIndex - startIndex + 1;
+			return endIndex - startIndex;
 		}
 
 	};
 
+	// consecutive triangles of a group that are culled together
+	struct Meshlet
+	{
+		static constexpr glm::uint maximumTriangleCount = 128;
+
+		glm::uint startIndex = 0;
+		glm::uint indexCount = 0;
+
+		glm::vec3 boundingSphereCenter = glm::vec3(0.0f);
+		float boundingSphereRadius = 0.0f;
+		// cone containing the normals of all triangles, the meshlet is backfacing for all viewing directions within the cutoff
+		// (the sine of the cone angle) around the axis, the cutoff is one if the triangles can not be culled together
+		glm::vec3 coneAxis = glm::vec3(0.0f);
+		float coneCutoff = 1.0f;
+	};
+
+	// simplified triangles of a group, stored in the index buffer behind the indices of all groups
+	struct LevelOfDetail
+	{
+		glm::uint startIndex = 0;
+		glm::uint indexCount = 0;
+		// largest distance between the simplified and the original surface in object space
+		float error = 0.0f;
+		// offset of the first index in the index buffer in bytes, the indices use the format of their group
+		glm::uint indexOffset = 0;
+	};
+
 	struct Material
 	{
 		std::string name;
@@ -42,6 +109,12 @@ namespace minity
 		glm::vec3 specular = glm::vec3(0.0f);
 		float shininess = 0.0f;
 
+		std::string ambientTextureFilename;
+		std::string diffuseTextureFilename;
+		std::string specularTextureFilename;
+		std::string shininessTextureFilename;
+		std::string bumpTextureFilename;
+
 		std::shared_ptr<globjects::Texture> ambientTexture;
 		std::shared_ptr<globjects::Texture> diffuseTexture;
 		std::shared_ptr<globjects::Texture> specularTexture;
@@ -49,41 +122,169 @@ namespace minity
 		std::shared_ptr<globjects::Texture> bumpTexture;
 	};
 
+	enum class ObjParser
+	{
+		// original parser based on std::istringstream, kept for comparison
+		Stream,
+		// parser working on a memory-mapped view of the file using std::from_chars
+		Mapped
+	};
+
+	enum class VertexFormat
+	{
+		// 32 bytes per vertex with full floats, kept for comparison
+		Full,
+		// 16 bytes per vertex as PackedVertex
+		Packed
+	};
+
+	struct LoadOptions
+	{
+		ObjParser parser = ObjParser::Mapped;
+		// number of threads used by the mapped parser, zero uses all hardware threads
+		unsigned int threadCount = 0;
+		// use binary caches of the final geometry and of the decoded textures with their mipmaps when loading the same files again
+		bool cache = true;
+		// directory for cache files, if empty they are stored next to the model and image files
+		std::string cacheDirectory;
+		// load on a separate thread and hand the geometry out in parts through update()
+		bool background = true;
+		// keep vertices and indices in main memory after the upload, otherwise only bounds and groups remain
+		bool keepGeometry = true;
+		// encode textures on the CPU to BC1, BC3, BC4 or BC5 depending on their channels and usage
+		bool compressTextures = false;
+		// decode the textures of a material when a group using it is drawn for the first time, instead of while loading
+		bool lazyTextures = true;
+		// reorder the triangles of each group for the post-transform vertex cache and for less overdraw, and the vertices by first use
+		bool optimizeGeometry = true;
+		// split groups into meshlets, which are culled separately against the view frustum and by their normal cones
+		bool buildMeshlets = true;
+		// simplify each group into a chain of coarser levels of detail, which are drawn depending on their error on screen
+		bool buildLevelsOfDetail = true;
+		// build a bounding volume hierarchy over the triangles of all groups for ray queries, which is stored in the geometry cache
+		bool buildBvh = true;
+		// layout of the vertex buffer, vertices in main memory always use full floats
+		VertexFormat vertexFormat = VertexFormat::Packed;
+		// upload the indices of groups spanning at most 65536 vertices with 16 bits, indices in main memory always use 32 bits
+		bool shortIndices = true;
+	};
+
 	class Model
 	{
 	public:
 		Model();
-		Model(const std::string& filename);
-		void load(const std::string& filename);
+		Model(const std::string& filename, const LoadOptions& options = LoadOptions());
+		Model(const Model&) = delete;
+		Model(Model&& model) noexcept;
+		~Model();
+
+		Model& operator=(const Model&) = delete;
+		Model& operator=(Model&& model) noexcept;
+
+		void load(const std::string& filename, const LoadOptions& options = LoadOptions());
+
+		// receives data from a background load, has to be called regularly on the thread owning the OpenGL context
+		// returns true if groups, materials or bounds have changed
+		bool update();
+		bool isLoading() const;
+		float loadProgress() const;
+		std::string loadStage() const;
+
 		const std::string & filename() const;
 
 		const std::vector<Group> & groups() const;
+		const std::vector<Meshlet> & meshlets() const;
+		const std::vector<LevelOfDetail> & levelsOfDetail() const;
+		const std::vector<Material> & materials() const;
+
+		// starts decoding the textures of a material if they are loaded lazily and have not been requested yet
+		// the material keeps its flat colors until the textures are handed out through update()
+		void requestTextures(std::size_t materialIndex);
+
+		// empty while loading and if the model does not keep its geometry in main memory
 		const std::vector<Vertex> & vertices() const;
 		const std::vector<glm::uint> & indices() const;
-		const std::vector<Material> & materials() const;
+
+		// hierarchy over the full detail triangles of all groups, empty while loading and if it is not built
+		const Bvh & bvh() const;
+
+		// the hierarchy in RGBA32F buffer textures for traversal in shaders, null until it has been received
+		// a node takes four texels with the bounds of both children, each followed by the index of the child node, or the first
+		// triangle and the triangle count for leaves (as bits in w); a triangle takes three texels with its first vertex and
+		// both edges, the triangle in the index buffer and its material are stored in w of the first two
+		// the nodes of these textures only cover the inner nodes of bvh(), a hierarchy of a single leaf gets a node with the leaf as both children
+		globjects::Texture * bvhNodeTexture();
+		globjects::Texture * bvhTriangleTexture();
+
+		// number of vertices and indices in the buffers, also available if the arrays are not kept
+		std::size_t vertexCount() const;
+		std::size_t indexCount() const;
+		// size of the index buffer in bytes, which mixes 16-bit and 32-bit indices depending on the groups
+		std::size_t indexBufferSize() const;
 
 		glm::vec3 minimumBounds() const;
 		glm::vec3 maximumBounds() const;
 
+		// positions in the vertex buffer are transformed to object space by scaling and adding the offset
+		VertexFormat vertexFormat() const;
+		glm::vec3 positionOffset() const;
+		glm::vec3 positionScale() const;
+
+		// textures are shared through this cache, which can be shared between models as well
+		void setTextureCache(const std::shared_ptr<TextureCache>& textureCache);
+		const std::shared_ptr<TextureCache>& textureCache() const;
+
+		// without a streamer all levels of the textures are uploaded at once
+		void setTextureStreamer(const std::shared_ptr<TextureStreamer>& textureStreamer);
+		const std::shared_ptr<TextureStreamer>& textureStreamer() const;
+
 		globjects::VertexArray & vertexArray();
 		globjects::Buffer & vertexBuffer();
 		globjects::Buffer & indexBuffer();
 
 	private:
+		struct LoadState;
+		struct TextureLoader;
+
+		void initializeVertexArray();
+		void cancelLoading();
+		bool uploadTexture();
 
 		std::string m_filename;
 		
 		std::vector < Group > m_groups;
+		std::vector < Meshlet > m_meshlets;
+		std::vector < LevelOfDetail > m_levelsOfDetail;
 		std::vector < Vertex > m_vertices;
 		std::vector < glm::uint > m_indices;
 		std::vector < Material > m_materials;
+		Bvh m_bvh;
+		std::size_t m_vertexCount = 0;
+		std::size_t m_indexCount = 0;
+		std::size_t m_indexBufferSize = 0;
 
 		glm::vec3 m_minimumBounds = glm::vec3(0.0);
 		glm::vec3 m_maximumBounds = glm::vec3(0.0);
 
+		VertexFormat m_vertexFormat = VertexFormat::Full;
+		glm::vec3 m_positionOffset = glm::vec3(0.0f);
+		glm::vec3 m_positionScale = glm::vec3(1.0f);
+
 		std::unique_ptr<globjects::VertexArray> m_vertexArray = std::make_unique<globjects::VertexArray>();
 		std::unique_ptr<globjects::Buffer> m_vertexBuffer = std::make_unique<globjects::Buffer>();
 		std::unique_ptr< globjects::Buffer > m_indexBuffer = std::make_unique<globjects::Buffer>();
+		std::size_t m_vertexBufferCapacity = 0;
+		std::size_t m_indexBufferCapacity = 0;
+		std::unique_ptr<globjects::Buffer> m_bvhNodeBuffer;
+		std::unique_ptr<globjects::Buffer> m_bvhTriangleBuffer;
+		std::unique_ptr<globjects::Texture> m_bvhNodeTexture;
+		std::unique_ptr<globjects::Texture> m_bvhTriangleTexture;
+
+		std::shared_ptr<TextureCache> m_textureCache;
+		std::shared_ptr<TextureStreamer> m_textureStreamer;
+		// shared with the load state, which requests all textures while loading unless they are loaded lazily
+		std::shared_ptr<TextureLoader> m_textureLoader;
+		std::unique_ptr<LoadState> m_loadState;
 
 	};
 }
\ No newline at end of file
@@ -0,0 +1,657 @@
+#include "ModelCache.h"
+#include "Model.h"
+#include "Bvh.h"
+
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <cstring>
+#include <type_traits>
+
+#include <globjects/globjects.h>
+#include <globjects/logging.h>
+
+using namespace minity;
+using namespace glm;
+
+struct ModelCacheHeader
+{
+	char magic[8];
+	std::uint32_t version;
+	std::uint32_t vertexSize;
+	// bits of the geometry options the cache was written with
+	std::uint32_t geometryOptions;
+	std::uint32_t reserved;
+	std::uint64_t sourceSize;
+	std::int64_t sourceTime;
+	std::uint64_t vertexOffset;
+	std::uint64_t vertexCount;
+	std::uint64_t indexOffset;
+	std::uint64_t indexCount;
+	std::uint64_t bvhNodeOffset;
+	std::uint64_t bvhNodeCount;
+	std::uint64_t bvhTriangleOffset;
+	std::uint64_t bvhTriangleCount;
+	std::uint64_t metadataOffset;
+	std::uint64_t metadataSize;
+	float minimumBounds[3];
+	float maximumBounds[3];
+};
+
+static const char modelCacheMagic[8] = { 'M', 'I', 'N', 'I', 'T', 'Y', 'M', 'C' };
+static const std::uint64_t modelCacheAlignment = 64;
+
+static std::uint32_t geometryOptionBits(const ModelCacheOptions& options)
+{
+	return (options.optimizeGeometry ? 1u : 0u) | (options.buildMeshlets ? 2u : 0u) | (options.buildLevelsOfDetail ? 4u : 0u);
+}
+
+// sequential writer/reader for the variable-sized part of the cache (groups and materials)
+class ModelCacheWriter
+{
+public:
+	ModelCacheWriter(std::string& buffer) : m_buffer(buffer)
+	{
+	}
+
+	template <class T>
+	void write(const T& value)
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "only trivially copyable types can be written directly");
+		m_buffer.append(reinterpret_cast<const char*>(&value), sizeof(T));
+	}
+
+	void write(const std::string& value)
+	{
+		write(std::uint64_t(value.size()));
+		m_buffer.append(value);
+	}
+
+private:
+	std::string& m_buffer;
+};
+
+class ModelCacheReader
+{
+public:
+	ModelCacheReader(const char* data, std::size_t size) : m_current(data), m_end(data + size)
+	{
+	}
+
+	template <class T>
+	bool read(T& value)
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "only trivially copyable types can be read directly");
+
+		if (std::size_t(m_end - m_current) < sizeof(T))
+			return m_valid = false;
+
+		std::memcpy(&value, m_current, sizeof(T));
+		m_current += sizeof(T);
+		return m_valid;
+	}
+
+	bool read(std::string& value)
+	{
+		std::uint64_t size = 0;
+
+		if (!read(size) || std::uint64_t(m_end - m_current) < size)
+			return m_valid = false;
+
+		value.assign(m_current, std::size_t(size));
+		m_current += size;
+		return m_valid;
+	}
+
+	bool isValid() const
+	{
+		return m_valid;
+	}
+
+private:
+	const char* m_current;
+	const char* m_end;
+	bool m_valid = true;
+};
+
+static std::uint64_t alignOffset(std::uint64_t offset)
+{
+	return (offset + modelCacheAlignment - 1) / modelCacheAlignment * modelCacheAlignment;
+}
+
+static std::uint64_t hashString(const std::string& s)
+{
+	// 64-bit FNV-1a
+	std::uint64_t hash = 14695981039346656037ull;
+
+	for (unsigned char c : s)
+	{
+		hash ^= c;
+		hash *= 1099511628211ull;
+	}
+
+	return hash;
+}
+
+ModelCache::ModelCache(const std::string& filename, const std::string& cacheDirectory, const ModelCacheOptions& options) : m_filename(filename), m_options(options)
+{
+	std::error_code error;
+	std::filesystem::path sourcePath = std::filesystem::weakly_canonical(filename, error);
+
+	if (error)
+		sourcePath = std::filesystem::path(filename);
+
+	m_sourcePath = sourcePath.string();
+
+	if (cacheDirectory.empty())
+	{
+		m_cacheFilename = filename + ".meshcache";
+	}
+	else
+	{
+		// the source path is part of the name, so that files with the same name in different directories do not collide
+		std::stringstream ss;
+		ss << sourcePath.stem().string() << "-" << std::hex << std::setw(16) << std::setfill('0') << hashString(m_sourcePath) << ".meshcache";
+
+		std::filesystem::path cachePath(cacheDirectory);
+		cachePath.append(ss.str());
+		m_cacheFilename = cachePath.string();
+	}
+}
+
+const std::string& ModelCache::filename() const
+{
+	return m_filename;
+}
+
+const std::string& ModelCache::cacheFilename() const
+{
+	return m_cacheFilename;
+}
+
+bool ModelCache::read()
+{
+	close();
+
+	std::uint64_t sourceSize = 0;
+	std::int64_t sourceTime = 0;
+
+	if (!sourceStatus(sourceSize, sourceTime))
+		return false;
+
+	if (!m_file.open(m_cacheFilename))
+		return false;
+
+	if (m_file.size() < sizeof(ModelCacheHeader))
+	{
+		close();
+		return false;
+	}
+
+	ModelCacheHeader header;
+	std::memcpy(&header, m_file.data(), sizeof(header));
+
+	if (std::memcmp(header.magic, modelCacheMagic, sizeof(modelCacheMagic)) != 0 || header.version != version || header.vertexSize != sizeof(Vertex))
+	{
+		globjects::debug() << "Ignoring outdated cache file " << m_cacheFilename;
+		close();
+		return false;
+	}
+
+	if (header.sourceSize != sourceSize || header.sourceTime != sourceTime)
+	{
+		globjects::debug() << "Ignoring cache file " << m_cacheFilename << ", since " << m_filename << " has changed";
+		close();
+		return false;
+	}
+
+	if (header.geometryOptions != geometryOptionBits(m_options))
+	{
+		globjects::debug() << "Ignoring cache file " << m_cacheFilename << ", since it was written with other geometry options";
+		close();
+		return false;
+	}
+
+	const std::uint64_t fileSize = m_file.size();
+
+	if (header.vertexOffset > fileSize || header.vertexCount > (fileSize - header.vertexOffset) / sizeof(Vertex) ||
+		header.indexOffset > fileSize || header.indexCount > (fileSize - header.indexOffset) / sizeof(uint) ||
+		header.bvhNodeOffset > fileSize || header.bvhNodeCount > (fileSize - header.bvhNodeOffset) / sizeof(BvhNode) ||
+		header.bvhTriangleOffset > fileSize || header.bvhTriangleCount > (fileSize - header.bvhTriangleOffset) / sizeof(BvhTriangle) ||
+		header.metadataOffset > fileSize || header.metadataSize > fileSize - header.metadataOffset ||
+		header.vertexOffset % alignof(Vertex) != 0 || header.indexOffset % alignof(uint) != 0 ||
+		header.bvhNodeOffset % alignof(BvhNode) != 0 || header.bvhTriangleOffset % alignof(BvhTriangle) != 0)
+	{
+		globjects::debug() << "Ignoring corrupted cache file " << m_cacheFilename;
+		close();
+		return false;
+	}
+
+	ModelCacheReader reader(m_file.data() + header.metadataOffset, std::size_t(header.metadataSize));
+
+	std::string sourcePath;
+	reader.read(sourcePath);
+
+	if (sourcePath != m_sourcePath)
+	{
+		close();
+		return false;
+	}
+
+	std::uint64_t groupCount = 0;
+	reader.read(groupCount);
+
+	for (std::uint64_t i = 0; i < groupCount && reader.isValid(); i++)
+	{
+		Group group;
+		reader.read(group.name);
+		reader.read(group.materialIndex);
+		reader.read(group.startIndex);
+		reader.read(group.endIndex);
+		reader.read(group.minimumBounds);
+		reader.read(group.maximumBounds);
+		reader.read(group.boundingSphereCenter);
+		reader.read(group.boundingSphereRadius);
+		reader.read(group.texCoordDensity);
+		reader.read(group.firstMeshlet);
+		reader.read(group.meshletCount);
+		reader.read(group.firstLevelOfDetail);
+		reader.read(group.levelOfDetailCount);
+		m_groups.push_back(group);
+	}
+
+	std::uint64_t meshletCount = 0;
+	reader.read(meshletCount);
+
+	for (std::uint64_t i = 0; i < meshletCount && reader.isValid(); i++)
+	{
+		Meshlet meshlet;
+		reader.read(meshlet.startIndex);
+		reader.read(meshlet.indexCount);
+		reader.read(meshlet.boundingSphereCenter);
+		reader.read(meshlet.boundingSphereRadius);
+		reader.read(meshlet.coneAxis);
+		reader.read(meshlet.coneCutoff);
+		m_meshlets.push_back(meshlet);
+	}
+
+	std::uint64_t levelOfDetailCount = 0;
+	reader.read(levelOfDetailCount);
+
+	for (std::uint64_t i = 0; i < levelOfDetailCount && reader.isValid(); i++)
+	{
+		LevelOfDetail level;
+		reader.read(level.startIndex);
+		reader.read(level.indexCount);
+		reader.read(level.error);
+		m_levelsOfDetail.push_back(level);
+	}
+
+	std::uint64_t materialCount = 0;
+	reader.read(materialCount);
+
+	for (std::uint64_t i = 0; i < materialCount && reader.isValid(); i++)
+	{
+		Material material;
+		reader.read(material.name);
+		reader.read(material.ambient);
+		reader.read(material.diffuse);
+		reader.read(material.specular);
+		reader.read(material.shininess);
+		reader.read(material.ambientTextureFilename);
+		reader.read(material.diffuseTextureFilename);
+		reader.read(material.specularTextureFilename);
+		reader.read(material.shininessTextureFilename);
+		reader.read(material.bumpTextureFilename);
+		m_materials.push_back(material);
+	}
+
+	for (VertexCacheStatistics* statistics : { &m_originalStatistics, &m_optimizedStatistics })
+	{
+		std::uint64_t triangleCount = 0;
+		std::uint64_t vertexCount = 0;
+		std::uint64_t transformedCount = 0;
+		reader.read(triangleCount);
+		reader.read(vertexCount);
+		reader.read(transformedCount);
+		statistics->triangleCount = std::size_t(triangleCount);
+		statistics->vertexCount = std::size_t(vertexCount);
+		statistics->transformedCount = std::size_t(transformedCount);
+	}
+
+	// the ranges are used to read from the mapped file without further checks
+	bool rangesValid = true;
+	std::uint64_t previousEndIndex = 0;
+
+	for (const Group& group : m_groups)
+	{
+		rangesValid = rangesValid && group.startIndex <= group.endIndex && group.endIndex <= header.indexCount && group.endIndex >= previousEndIndex &&
+			std::uint64_t(group.firstMeshlet) + group.meshletCount <= m_meshlets.size() &&
+			std::uint64_t(group.firstLevelOfDetail) + group.levelOfDetailCount <= m_levelsOfDetail.size() &&
+			(m_materials.empty() ? group.materialIndex == 0 : group.materialIndex < m_materials.size());
+		previousEndIndex = group.endIndex;
+	}
+
+	for (const Meshlet& meshlet : m_meshlets)
+		rangesValid = rangesValid && std::uint64_t(meshlet.startIndex) + meshlet.indexCount <= header.indexCount;
+
+	for (const LevelOfDetail& level : m_levelsOfDetail)
+		rangesValid = rangesValid && std::uint64_t(level.startIndex) + level.indexCount <= header.indexCount;
+
+	// the shaders index the vertices and follow the nodes as they are stored, so these are checked as well
+	const uint* indices = reinterpret_cast<const uint*>(m_file.data() + header.indexOffset);
+
+	for (std::uint64_t i = 0; rangesValid && i < header.indexCount; i++)
+		rangesValid = indices[i] < header.vertexCount;
+
+	const BvhNode* bvhNodes = reinterpret_cast<const BvhNode*>(m_file.data() + header.bvhNodeOffset);
+
+	// the second child has to follow its parent, which also keeps the traversal from running in circles
+	for (std::uint64_t i = 0; rangesValid && i < header.bvhNodeCount; i++)
+	{
+		const BvhNode& node = bvhNodes[i];
+
+		if (node.triangleCount == 0)
+			rangesValid = node.offset > i + 1 && node.offset < header.bvhNodeCount;
+		else
+			rangesValid = std::uint64_t(node.offset) + node.triangleCount <= header.bvhTriangleCount;
+	}
+
+	const BvhTriangle* bvhTriangles = reinterpret_cast<const BvhTriangle*>(m_file.data() + header.bvhTriangleOffset);
+
+	for (std::uint64_t i = 0; rangesValid && i < header.bvhTriangleCount; i++)
+	{
+		const BvhTriangle& triangle = bvhTriangles[i];
+		rangesValid = triangle.indices[0] < header.vertexCount && triangle.indices[1] < header.vertexCount && triangle.indices[2] < header.vertexCount &&
+			triangle.triangle < header.indexCount / 3;
+	}
+
+	if (!reader.isValid() || !rangesValid)
+	{
+		globjects::debug() << "Ignoring corrupted cache file " << m_cacheFilename;
+		close();
+		return false;
+	}
+
+	m_vertices = reinterpret_cast<const Vertex*>(m_file.data() + header.vertexOffset);
+	m_vertexCount = std::size_t(header.vertexCount);
+	m_indices = reinterpret_cast<const uint*>(m_file.data() + header.indexOffset);
+	m_indexCount = std::size_t(header.indexCount);
+	m_bvhNodes = reinterpret_cast<const BvhNode*>(m_file.data() + header.bvhNodeOffset);
+	m_bvhNodeCount = std::size_t(header.bvhNodeCount);
+	m_bvhTriangles = reinterpret_cast<const BvhTriangle*>(m_file.data() + header.bvhTriangleOffset);
+	m_bvhTriangleCount = std::size_t(header.bvhTriangleCount);
+	m_minimumBounds = vec3(header.minimumBounds[0], header.minimumBounds[1], header.minimumBounds[2]);
+	m_maximumBounds = vec3(header.maximumBounds[0], header.maximumBounds[1], header.maximumBounds[2]);
+
+	return true;
+}
+
+bool ModelCache::write(const std::vector<Vertex>& vertices, const std::vector<uint>& indices, const std::vector<Group>& groups, const std::vector<Meshlet>& meshlets, const std::vector<LevelOfDetail>& levelsOfDetail, const std::vector<Material>& materials, const Bvh& bvh, const VertexCacheStatistics& originalStatistics, const VertexCacheStatistics& optimizedStatistics, const vec3& minimumBounds, const vec3& maximumBounds)
+{
+	// the cache file might be replaced, so it must not be mapped anymore
+	close();
+
+	std::uint64_t sourceSize = 0;
+	std::int64_t sourceTime = 0;
+
+	if (!sourceStatus(sourceSize, sourceTime))
+		return false;
+
+	std::string metadata;
+	ModelCacheWriter writer(metadata);
+	writer.write(m_sourcePath);
+	writer.write(std::uint64_t(groups.size()));
+
+	for (const auto& g : groups)
+	{
+		writer.write(g.name);
+		writer.write(g.materialIndex);
+		writer.write(g.startIndex);
+		writer.write(g.endIndex);
+		writer.write(g.minimumBounds);
+		writer.write(g.maximumBounds);
+		writer.write(g.boundingSphereCenter);
+		writer.write(g.boundingSphereRadius);
+		writer.write(g.texCoordDensity);
+		writer.write(g.firstMeshlet);
+		writer.write(g.meshletCount);
+		writer.write(g.firstLevelOfDetail);
+		writer.write(g.levelOfDetailCount);
+	}
+
+	writer.write(std::uint64_t(meshlets.size()));
+
+	for (const auto& m : meshlets)
+	{
+		writer.write(m.startIndex);
+		writer.write(m.indexCount);
+		writer.write(m.boundingSphereCenter);
+		writer.write(m.boundingSphereRadius);
+		writer.write(m.coneAxis);
+		writer.write(m.coneCutoff);
+	}
+
+	writer.write(std::uint64_t(levelsOfDetail.size()));
+
+	for (const auto& l : levelsOfDetail)
+	{
+		writer.write(l.startIndex);
+		writer.write(l.indexCount);
+		writer.write(l.error);
+	}
+
+	writer.write(std::uint64_t(materials.size()));
+
+	for (const auto& m : materials)
+	{
+		writer.write(m.name);
+		writer.write(m.ambient);
+		writer.write(m.diffuse);
+		writer.write(m.specular);
+		writer.write(m.shininess);
+		writer.write(m.ambientTextureFilename);
+		writer.write(m.diffuseTextureFilename);
+		writer.write(m.specularTextureFilename);
+		writer.write(m.shininessTextureFilename);
+		writer.write(m.bumpTextureFilename);
+	}
+
+	for (const VertexCacheStatistics* statistics : { &originalStatistics, &optimizedStatistics })
+	{
+		writer.write(std::uint64_t(statistics->triangleCount));
+		writer.write(std::uint64_t(statistics->vertexCount));
+		writer.write(std::uint64_t(statistics->transformedCount));
+	}
+
+	ModelCacheHeader header;
+	std::memset(&header, 0, sizeof(header));
+	std::memcpy(header.magic, modelCacheMagic, sizeof(modelCacheMagic));
+	header.version = version;
+	header.vertexSize = sizeof(Vertex);
+	header.geometryOptions = geometryOptionBits(m_options);
+	header.sourceSize = sourceSize;
+	header.sourceTime = sourceTime;
+	header.vertexOffset = alignOffset(sizeof(header));
+	header.vertexCount = vertices.size();
+	header.indexOffset = alignOffset(header.vertexOffset + vertices.size() * sizeof(Vertex));
+	header.indexCount = indices.size();
+	header.bvhNodeOffset = alignOffset(header.indexOffset + indices.size() * sizeof(uint));
+	header.bvhNodeCount = bvh.nodes().size();
+	header.bvhTriangleOffset = alignOffset(header.bvhNodeOffset + bvh.nodes().size() * sizeof(BvhNode));
+	header.bvhTriangleCount = bvh.triangles().size();
+	header.metadataOffset = alignOffset(header.bvhTriangleOffset + bvh.triangles().size() * sizeof(BvhTriangle));
+	header.metadataSize = metadata.size();
+
+	for (int i = 0; i < 3; i++)
+	{
+		header.minimumBounds[i] = minimumBounds[i];
+		header.maximumBounds[i] = maximumBounds[i];
+	}
+
+	std::error_code error;
+	std::filesystem::path cachePath(m_cacheFilename);
+
+	if (cachePath.has_parent_path())
+		std::filesystem::create_directories(cachePath.parent_path(), error);
+
+	// the cache is written to a temporary file first, so that an interrupted write never leaves a corrupted cache behind
+	const std::string temporaryFilename = m_cacheFilename + ".tmp";
+
+	{
+		std::ofstream os(temporaryFilename, std::ios::binary | std::ios::trunc);
+
+		if (!os.is_open())
+			return false;
+
+		const std::string padding(modelCacheAlignment, '\0');
+
+		auto writeAt = [&](std::uint64_t offset, const void* data, std::uint64_t size) {
+			const std::uint64_t position = std::uint64_t(os.tellp());
+			os.write(padding.data(), std::streamsize(offset - position));
+			os.write(static_cast<const char*>(data), std::streamsize(size));
+		};
+
+		os.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		writeAt(header.vertexOffset, vertices.data(), vertices.size() * sizeof(Vertex));
+		writeAt(header.indexOffset, indices.data(), indices.size() * sizeof(uint));
+		writeAt(header.bvhNodeOffset, bvh.nodes().data(), bvh.nodes().size() * sizeof(BvhNode));
+		writeAt(header.bvhTriangleOffset, bvh.triangles().data(), bvh.triangles().size() * sizeof(BvhTriangle));
+		writeAt(header.metadataOffset, metadata.data(), metadata.size());
+
+		if (!os.good())
+		{
+			os.close();
+			std::filesystem::remove(temporaryFilename, error);
+			return false;
+		}
+	}
+
+	std::filesystem::rename(temporaryFilename, m_cacheFilename, error);
+
+	if (error)
+	{
+		std::filesystem::remove(m_cacheFilename, error);
+		std::filesystem::rename(temporaryFilename, m_cacheFilename, error);
+	}
+
+	if (error)
+	{
+		std::filesystem::remove(temporaryFilename, error);
+		return false;
+	}
+
+	return true;
+}
+
+void ModelCache::close()
+{
+	m_file.close();
+	m_vertices = nullptr;
+	m_vertexCount = 0;
+	m_indices = nullptr;
+	m_indexCount = 0;
+	m_bvhNodes = nullptr;
+	m_bvhNodeCount = 0;
+	m_bvhTriangles = nullptr;
+	m_bvhTriangleCount = 0;
+	m_groups.clear();
+	m_meshlets.clear();
+	m_levelsOfDetail.clear();
+	m_materials.clear();
+	m_originalStatistics = VertexCacheStatistics();
+	m_optimizedStatistics = VertexCacheStatistics();
+}
+
+const Vertex* ModelCache::vertices() const
+{
+	return m_vertices;
+}
+
+std::size_t ModelCache::vertexCount() const
+{
+	return m_vertexCount;
+}
+
+const uint* ModelCache::indices() const
+{
+	return m_indices;
+}
+
+std::size_t ModelCache::indexCount() const
+{
+	return m_indexCount;
+}
+
+const BvhNode* ModelCache::bvhNodes() const
+{
+	return m_bvhNodes;
+}
+
+std::size_t ModelCache::bvhNodeCount() const
+{
+	return m_bvhNodeCount;
+}
+
+const BvhTriangle* ModelCache::bvhTriangles() const
+{
+	return m_bvhTriangles;
+}
+
+std::size_t ModelCache::bvhTriangleCount() const
+{
+	return m_bvhTriangleCount;
+}
+
+const std::vector<Group>& ModelCache::groups() const
+{
+	return m_groups;
+}
+
+const std::vector<Meshlet>& ModelCache::meshlets() const
+{
+	return m_meshlets;
+}
+
+const std::vector<LevelOfDetail>& ModelCache::levelsOfDetail() const
+{
+	return m_levelsOfDetail;
+}
+
+const std::vector<Material>& ModelCache::materials() const
+{
+	return m_materials;
+}
+
+const VertexCacheStatistics& ModelCache::originalStatistics() const
+{
+	return m_originalStatistics;
+}
+
+const VertexCacheStatistics& ModelCache::optimizedStatistics() const
+{
+	return m_optimizedStatistics;
+}
+
+vec3 ModelCache::minimumBounds() const
+{
+	return m_minimumBounds;
+}
+
+vec3 ModelCache::maximumBounds() const
+{
+	return m_maximumBounds;
+}
+
+bool ModelCache::sourceStatus(std::uint64_t& size, std::int64_t& time) const
+{
+	std::error_code error;
+	size = std::filesystem::file_size(m_filename, error);
+
+	if (error)
+		return false;
+
+	time = std::int64_t(std::filesystem::last_write_time(m_filename, error).time_since_epoch().count());
+	return !error;
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "MappedFile.h"
+#include "MeshOptimizer.h"
+
+namespace minity
+{
+	struct Vertex;
+	struct Group;
+	struct Meshlet;
+	struct LevelOfDetail;
+	struct Material;
+	struct BvhNode;
+	struct BvhTriangle;
+	class Bvh;
+
+	// options of the loader that change the cached geometry, a cache written with other options is ignored
+	struct ModelCacheOptions
+	{
+		bool optimizeGeometry = true;
+		bool buildMeshlets = true;
+		bool buildLevelsOfDetail = true;
+	};
+
+	// binary cache of the final geometry of a model, stored next to the source file or in a cache directory
+	class ModelCache
+	{
+	public:
+		// has to be increased whenever the file layout or the output of the loader changes
+		static constexpr std::uint32_t version = 11;
+
+		ModelCache(const std::string& filename, const std::string& cacheDirectory = std::string(), const ModelCacheOptions& options = ModelCacheOptions());
+
+		const std::string& filename() const;
+		const std::string& cacheFilename() const;
+
+		// maps the cache file and checks whether it is valid for the current source file
+		bool read();
+		bool write(const std::vector<Vertex>& vertices, const std::vector<glm::uint>& indices, const std::vector<Group>& groups, const std::vector<Meshlet>& meshlets, const std::vector<LevelOfDetail>& levelsOfDetail, const std::vector<Material>& materials, const Bvh& bvh, const VertexCacheStatistics& originalStatistics, const VertexCacheStatistics& optimizedStatistics, const glm::vec3& minimumBounds, const glm::vec3& maximumBounds);
+		void close();
+
+		// pointers into the mapped cache file, only valid after a successful read() and until close()
+		const Vertex* vertices() const;
+		std::size_t vertexCount() const;
+		const glm::uint* indices() const;
+		std::size_t indexCount() const;
+		// empty if the hierarchy was not built when writing the cache
+		const BvhNode* bvhNodes() const;
+		std::size_t bvhNodeCount() const;
+		const BvhTriangle* bvhTriangles() const;
+		std::size_t bvhTriangleCount() const;
+
+		const std::vector<Group>& groups() const;
+		const std::vector<Meshlet>& meshlets() const;
+		const std::vector<LevelOfDetail>& levelsOfDetail() const;
+		const std::vector<Material>& materials() const;
+		// vertex cache efficiency of the geometry before and after it was optimized, empty if it was not optimized
+		const VertexCacheStatistics& originalStatistics() const;
+		const VertexCacheStatistics& optimizedStatistics() const;
+
+		glm::vec3 minimumBounds() const;
+		glm::vec3 maximumBounds() const;
+
+	private:
+		bool sourceStatus(std::uint64_t& size, std::int64_t& time) const;
+
+		std::string m_filename;
+		std::string m_sourcePath;
+		std::string m_cacheFilename;
+		ModelCacheOptions m_options;
+
+		MappedFile m_file;
+
+		const Vertex* m_vertices = nullptr;
+		std::size_t m_vertexCount = 0;
+		const glm::uint* m_indices = nullptr;
+		std::size_t m_indexCount = 0;
+		const BvhNode* m_bvhNodes = nullptr;
+		std::size_t m_bvhNodeCount = 0;
+		const BvhTriangle* m_bvhTriangles = nullptr;
+		std::size_t m_bvhTriangleCount = 0;
+
+		std::vector<Group> m_groups;
+		std::vector<Meshlet> m_meshlets;
+		std::vector<LevelOfDetail> m_levelsOfDetail;
+		std::vector<Material> m_materials;
+		VertexCacheStatistics m_originalStatistics;
+		VertexCacheStatistics m_optimizedStatistics;
+
+		glm::vec3 m_minimumBounds = glm::vec3(0.0f);
+		glm::vec3 m_maximumBounds = glm::vec3(0.0f);
+	};
+}
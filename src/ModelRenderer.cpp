@@ -7,6 +7,10 @@
 #include "Viewer.h"
 #include "Scene.h"
 #include "Model.h"
+#include "TextureCache.h"
+#include "TextureStreamer.h"
+#include "Frustum.h"
+#include "GBuffer.h"
 #include <sstream>
 
 #include <glm/gtc/type_ptr.hpp>
@@ -73,10 +77,26 @@ void ModelRenderer::display()
 	const std::vector<Group> &groups = viewer()->scene()->model()->groups();
 	const std::vector<Material> &materials = viewer()->scene()->model()->materials();
 
-	static std::vector<bool> groupEnabled(groups.size(), true);
+	// groups are added while a model is still loading
+	static std::vector<bool> groupEnabled;
+	groupEnabled.resize(groups.size(), true);
 	static bool wireframeEnabled = true;
 	static bool lightSourceEnabled = true;
 	static vec4 wireframeLineColor = vec4(1.0f);
+	static bool frustumCullingEnabled = true;
+	// counts of the last frame, since the menu is shown before drawing
+	static std::size_t drawnGroupCount = 0;
+	static std::size_t culledGroupCount = 0;
+	static bool meshletCullingEnabled = true;
+	// both sides of the triangles are shown unless backface culling is enabled, which also culls meshlets by their normal cones
+	static bool backfaceCullingEnabled = false;
+	static std::size_t drawnMeshletCount = 0;
+	static std::size_t outsideMeshletCount = 0;
+	static std::size_t backfacingMeshletCount = 0;
+	static bool levelOfDetailEnabled = true;
+	static float levelOfDetailThreshold = 1.0f;
+	static std::size_t simplifiedGroupCount = 0;
+	static std::size_t drawnTriangleCount = 0;
 
 	if (ImGui::BeginMenu("Model"))
 	{
@@ -101,6 +121,40 @@ void ModelRenderer::display()
 			}
 		}
 
+		if (ImGui::CollapsingHeader("Culling"))
+		{
+			ImGui::Checkbox("Frustum Culling Enabled", &frustumCullingEnabled);
+			ImGui::Text("%zu groups drawn, %zu culled", drawnGroupCount, culledGroupCount);
+			ImGui::Checkbox("Meshlet Culling Enabled", &meshletCullingEnabled);
+			ImGui::Checkbox("Backface Culling Enabled", &backfaceCullingEnabled);
+			ImGui::Text("%zu meshlets drawn, %zu outside, %zu backfacing", drawnMeshletCount, outsideMeshletCount, backfacingMeshletCount);
+		}
+
+		if (ImGui::CollapsingHeader("Level of Detail"))
+		{
+			ImGui::Checkbox("Level of Detail Enabled", &levelOfDetailEnabled);
+			ImGui::SliderFloat("Error Threshold (Pixels)", &levelOfDetailThreshold, 0.1f, 16.0f, "%.1f");
+			ImGui::Text("%zu groups simplified, %zu triangles drawn", simplifiedGroupCount, drawnTriangleCount);
+		}
+
+		if (ImGui::CollapsingHeader("Textures"))
+		{
+			const TextureCache::Statistics statistics = viewer()->scene()->textureCache()->statistics();
+			ImGui::Text("%zu textures using %.1f MB", statistics.textureCount, double(statistics.textureBytes) / (1024.0 * 1024.0));
+			ImGui::Text("%.1f MB uncompressed, %.1f MB saved", double(statistics.uncompressedBytes) / (1024.0 * 1024.0), double(statistics.uncompressedBytes - statistics.textureBytes) / (1024.0 * 1024.0));
+			ImGui::Text("%zu hits, %zu misses, %.1f MB saved", statistics.hits, statistics.misses, double(statistics.bytesSaved) / (1024.0 * 1024.0));
+
+			TextureStreamer *textureStreamer = viewer()->scene()->textureStreamer();
+			const TextureStreamer::Statistics streaming = textureStreamer->statistics();
+			ImGui::Text("%.1f MB of %.1f MB resident", double(streaming.residentBytes) / (1024.0 * 1024.0), double(streaming.totalBytes) / (1024.0 * 1024.0));
+			ImGui::Text("%zu levels streamed, %zu released", streaming.uploadedLevels, streaming.releasedLevels);
+
+			int budget = int(textureStreamer->budget() / (1024 * 1024));
+
+			if (ImGui::SliderInt("Budget (MB)", &budget, 16, 8192))
+				textureStreamer->setBudget(std::size_t(budget) * 1024 * 1024);
+		}
+
 		ImGui::EndMenu();
 	}
 
@@ -113,16 +167,176 @@ void ModelRenderer::display()
 	shaderProgramModelBase->setUniform("worldLightPosition", vec3(worldLightPosition));
 	shaderProgramModelBase->setUniform("wireframeEnabled", wireframeEnabled);
 	shaderProgramModelBase->setUniform("wireframeLineColor", wireframeLineColor);
+	shaderProgramModelBase->setUniform("packedVertices", viewer()->scene()->model()->vertexFormat() == VertexFormat::Packed);
+	shaderProgramModelBase->setUniform("positionOffset", viewer()->scene()->model()->positionOffset());
+	shaderProgramModelBase->setUniform("positionScale", viewer()->scene()->model()->positionScale());
+
+	// another renderer traces secondary rays from the visible surfaces and shows the result instead
+	GBuffer *gBuffer = viewer()->gBuffer();
+	const bool gBufferEnabled = gBuffer->begin(ivec2(viewportSize));
+
+	if (backfaceCullingEnabled)
+		glEnable(GL_CULL_FACE);
 
 	shaderProgramModelBase->use();
 
+	// pixels covered by one unit of object space at unit distance (at any distance for orthographic projections), assuming a uniform scale in the model view transform
+	TextureStreamer *textureStreamer = viewer()->scene()->textureStreamer();
+	const bool orthographic = projectionMatrix[2][3] == 0.0f;
+	const float modelViewScale = length(vec3(modelViewMatrix[0]));
+	const float pixelsPerUnit = projectionMatrix[1][1] * viewportSize.y * 0.5f * modelViewScale;
+
+	// the frustum planes are in object space, so that the bounds of the groups can be tested directly
+	const Frustum frustum(modelViewProjectionMatrix);
+	drawnGroupCount = 0;
+	culledGroupCount = 0;
+	drawnMeshletCount = 0;
+	outsideMeshletCount = 0;
+	backfacingMeshletCount = 0;
+	simplifiedGroupCount = 0;
+	drawnTriangleCount = 0;
+
+	// meshlets are backfacing if all directions from the camera to them lie within their normal cones
+	const std::vector<Meshlet> &meshlets = viewer()->scene()->model()->meshlets();
+	const vec3 cameraPosition = vec3(worldCameraPosition);
+	const vec3 viewDirection = normalize(vec3(inverseModelViewMatrix * vec4(0.0f, 0.0f, -1.0f, 0.0f)));
+
+	auto isBackfacing = [&](const Meshlet &meshlet) {
+		if (orthographic)
+			return dot(viewDirection, meshlet.coneAxis) >= meshlet.coneCutoff;
+
+		const vec3 direction = meshlet.boundingSphereCenter - cameraPosition;
+		return dot(direction, meshlet.coneAxis) >= meshlet.coneCutoff * length(direction) + meshlet.boundingSphereRadius;
+	};
+
+	// the coarsest level of a group whose error covers at most the threshold in pixels where the group is closest to the camera
+	const std::vector<LevelOfDetail> &levelsOfDetail = viewer()->scene()->model()->levelsOfDetail();
+
+	auto selectLevelOfDetail = [&](const Group &group) -> const LevelOfDetail * {
+		if (!levelOfDetailEnabled || group.levelOfDetailCount == 0 || group.firstLevelOfDetail + group.levelOfDetailCount > levelsOfDetail.size())
+			return nullptr;
+
+		const float distance = orthographic ? 1.0f : (length(group.boundingSphereCenter - cameraPosition) - group.boundingSphereRadius) * modelViewScale;
+
+		if (distance <= 0.0f)
+			return nullptr;
+
+		for (uint j = group.firstLevelOfDetail + group.levelOfDetailCount; j > group.firstLevelOfDetail; j--)
+		{
+			if (levelsOfDetail[j - 1].error * pixelsPerUnit / distance <= levelOfDetailThreshold)
+				return &levelsOfDetail[j - 1];
+		}
+
+		return nullptr;
+	};
+
+	// visible meshlets of a group, consecutive ones are merged into one range
+	std::vector<GLsizei> drawCounts;
+	std::vector<const void *> drawOffsets;
+	std::vector<GLint> drawBaseVertices;
+
 	for (uint i = 0; i < groups.size(); i++)
 	{
 		if (groupEnabled.at(i))
 		{
-			const Material &material = materials.at(groups.at(i).materialIndex);
+			const Group &group = groups.at(i);
+
+			// groups that are still incomplete have no bounds yet and are always drawn, the sphere test is cheaper and rejects most groups
+			if (frustumCullingEnabled && group.boundingSphereRadius >= 0.0f)
+			{
+				if (!frustum.intersectsSphere(group.boundingSphereCenter, group.boundingSphereRadius) || !frustum.intersectsBox(group.minimumBounds, group.maximumBounds))
+				{
+					culledGroupCount++;
+					continue;
+				}
+			}
+
+			// meshlets only cover the full detail of a group
+			const LevelOfDetail *levelOfDetail = selectLevelOfDetail(group);
+			const bool drawMeshlets = !levelOfDetail && meshletCullingEnabled && group.meshletCount > 0 && group.firstMeshlet + group.meshletCount <= meshlets.size();
+
+			// groups spanning at most 65536 vertices use 16-bit indices relative to their base vertex
+			const GLenum indexType = group.shortIndices ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+			const std::size_t indexSize = group.shortIndices ? sizeof(GLushort) : sizeof(GLuint);
+
+			if (drawMeshlets)
+			{
+				drawCounts.clear();
+				drawOffsets.clear();
+				uint rangeEnd = 0;
+
+				for (uint j = group.firstMeshlet; j < group.firstMeshlet + group.meshletCount; j++)
+				{
+					const Meshlet &meshlet = meshlets[j];
+
+					if (!frustum.intersectsSphere(meshlet.boundingSphereCenter, meshlet.boundingSphereRadius))
+					{
+						outsideMeshletCount++;
+						continue;
+					}
+
+					if (backfaceCullingEnabled && isBackfacing(meshlet))
+					{
+						backfacingMeshletCount++;
+						continue;
+					}
+
+					drawnMeshletCount++;
+
+					if (!drawCounts.empty() && rangeEnd == meshlet.startIndex)
+					{
+						drawCounts.back() += GLsizei(meshlet.indexCount);
+					}
+					else
+					{
+						drawCounts.push_back(GLsizei(meshlet.indexCount));
+						drawOffsets.push_back((void *)(group.indexOffset + indexSize * (meshlet.startIndex - group.startIndex)));
+					}
+
+					rangeEnd = meshlet.startIndex + meshlet.indexCount;
+				}
+
+				if (drawCounts.empty())
+				{
+					culledGroupCount++;
+					continue;
+				}
+			}
+
+			drawnGroupCount++;
+
+			if (levelOfDetail)
+			{
+				simplifiedGroupCount++;
+				drawnTriangleCount += levelOfDetail->indexCount / 3;
+			}
+			else if (drawMeshlets)
+			{
+				for (GLsizei count : drawCounts)
+					drawnTriangleCount += std::size_t(count) / 3;
+			}
+			else
+			{
+				drawnTriangleCount += (group.endIndex - group.startIndex) / 3;
+			}
+
+			const Material &material = materials.at(group.materialIndex);
+
+			// textures are only decoded once a group using them is drawn, until then the flat colors are used
+			viewer()->scene()->model()->requestTextures(group.materialIndex);
+
+			// the texture resolution needed for the part of the group closest to the camera
+			if (material.diffuseTexture && group.texCoordDensity > 0.0f)
+			{
+				const vec3 center = 0.5f * (group.minimumBounds + group.maximumBounds);
+				const float radius = 0.5f * length(group.maximumBounds - group.minimumBounds) * modelViewScale;
+				const float distance = orthographic ? 1.0f : max(-(modelViewMatrix * vec4(center, 1.0f)).z - radius, 0.0f);
+
+				textureStreamer->request(material.diffuseTexture.get(), group.texCoordDensity * distance / pixelsPerUnit);
+			}
 
 			shaderProgramModelBase->setUniform("diffuseColor", material.diffuse);
+			shaderProgramModelBase->setUniform("materialIndex", group.materialIndex);
 
 			if (material.diffuseTexture)
 			{
@@ -130,7 +344,19 @@ void ModelRenderer::display()
 				material.diffuseTexture->bindActive(0);
 			}
 
-			viewer()->scene()->model()->vertexArray().drawElements(GL_TRIANGLES, groups.at(i).count(), GL_UNSIGNED_INT, (void *)(sizeof(GLuint) * groups.at(i).startIndex));
+			if (levelOfDetail)
+			{
+				viewer()->scene()->model()->vertexArray().drawElementsBaseVertex(GL_TRIANGLES, GLsizei(levelOfDetail->indexCount), indexType, (void *)std::size_t(levelOfDetail->indexOffset), GLint(group.baseVertex));
+			}
+			else if (drawMeshlets)
+			{
+				drawBaseVertices.assign(drawCounts.size(), GLint(group.baseVertex));
+				viewer()->scene()->model()->vertexArray().multiDrawElementsBaseVertex(GL_TRIANGLES, drawCounts.data(), indexType, drawOffsets.data(), GLsizei(drawCounts.size()), drawBaseVertices.data());
+			}
+			else
+			{
+				viewer()->scene()->model()->vertexArray().drawElementsBaseVertex(GL_TRIANGLES, GLsizei(group.count()), indexType, (void *)std::size_t(group.indexOffset), GLint(group.baseVertex));
+			}
 
 			if (material.diffuseTexture)
 			{
@@ -141,8 +367,13 @@ void ModelRenderer::display()
 
 	shaderProgramModelBase->release();
 
+	glDisable(GL_CULL_FACE);
+
 	viewer()->scene()->model()->vertexArray().unbind();
 
+	if (gBufferEnabled)
+		gBuffer->end();
+
 	if (lightSourceEnabled)
 	{
 		auto shaderProgramModelLight = shaderProgram("model-light");
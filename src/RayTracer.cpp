@@ -0,0 +1,404 @@
+#include "RayTracer.h"
+#include "Model.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <limits>
+#include <mutex>
+
+using namespace minity;
+using namespace glm;
+
+namespace
+{
+	constexpr int packetSize = RayTracer::packetWidth * RayTracer::packetHeight;
+	constexpr uint noTriangle = std::numeric_limits<uint>::max();
+	constexpr float infinity = std::numeric_limits<float>::infinity();
+
+	// rays of a packet with the closest hit found so far, rays outside of the image have a negative distance and never hit
+	struct RayPacket
+	{
+		alignas(32) float originX[packetSize];
+		alignas(32) float originY[packetSize];
+		alignas(32) float originZ[packetSize];
+		alignas(32) float directionX[packetSize];
+		alignas(32) float directionY[packetSize];
+		alignas(32) float directionZ[packetSize];
+		alignas(32) float inverseDirectionX[packetSize];
+		alignas(32) float inverseDirectionY[packetSize];
+		alignas(32) float inverseDirectionZ[packetSize];
+		alignas(32) float distance[packetSize];
+		alignas(32) float u[packetSize];
+		alignas(32) float v[packetSize];
+		alignas(32) uint triangle[packetSize];
+	};
+
+	struct StackEntry
+	{
+		uint node = 0;
+		// distance at which the first ray of the packet enters the node
+		float distance = 0.0f;
+	};
+
+	// tiles of one thread, threads without tiles left take over the back half of the tiles of another thread
+	struct alignas(64) TileQueue
+	{
+		std::mutex mutex;
+		std::size_t begin = 0;
+		std::size_t end = 0;
+	};
+
+	float reciprocal(float direction)
+	{
+		// avoids infinite products with zero distances to the slabs, which would result in NaN
+		const float minimumDirection = 1e-20f;
+		return 1.0f / (std::abs(direction) > minimumDirection ? direction : std::copysign(minimumDirection, direction));
+	}
+
+	// returns whether any ray of the packet enters the node before its closest hit, and the smallest entry distance
+	bool intersectNode(const RayPacket& packet, const BvhNode& node, float& entry)
+	{
+		float entries[packetSize];
+
+		for (int i = 0; i < packetSize; i++)
+		{
+			const float x0 = (node.minimumBounds.x - packet.originX[i]) * packet.inverseDirectionX[i];
+			const float x1 = (node.maximumBounds.x - packet.originX[i]) * packet.inverseDirectionX[i];
+			const float y0 = (node.minimumBounds.y - packet.originY[i]) * packet.inverseDirectionY[i];
+			const float y1 = (node.maximumBounds.y - packet.originY[i]) * packet.inverseDirectionY[i];
+			const float z0 = (node.minimumBounds.z - packet.originZ[i]) * packet.inverseDirectionZ[i];
+			const float z1 = (node.maximumBounds.z - packet.originZ[i]) * packet.inverseDirectionZ[i];
+
+			const float near = std::max(std::max(std::min(x0, x1), std::min(y0, y1)), std::max(std::min(z0, z1), 0.0f));
+			const float far = std::min(std::min(std::max(x0, x1), std::max(y0, y1)), std::min(std::max(z0, z1), packet.distance[i]));
+			entries[i] = near <= far ? near : infinity;
+		}
+
+		entry = infinity;
+
+		for (int i = 0; i < packetSize; i++)
+			entry = std::min(entry, entries[i]);
+
+		return entry < infinity;
+	}
+
+	// intersects all rays of the packet with a triangle (Moeller and Trumbore) and keeps the closer hits
+	void intersectTriangle(RayPacket& packet, const BvhTriangle& triangle, uint index, const Vertex* vertices)
+	{
+		const vec3 p0 = vertices[triangle.indices[0]].position;
+		const vec3 edge1 = vertices[triangle.indices[1]].position - p0;
+		const vec3 edge2 = vertices[triangle.indices[2]].position - p0;
+
+		for (int i = 0; i < packetSize; i++)
+		{
+			const float px = packet.directionY[i] * edge2.z - packet.directionZ[i] * edge2.y;
+			const float py = packet.directionZ[i] * edge2.x - packet.directionX[i] * edge2.z;
+			const float pz = packet.directionX[i] * edge2.y - packet.directionY[i] * edge2.x;
+			const float determinant = edge1.x * px + edge1.y * py + edge1.z * pz;
+			const float inverseDeterminant = 1.0f / determinant;
+
+			const float sx = packet.originX[i] - p0.x;
+			const float sy = packet.originY[i] - p0.y;
+			const float sz = packet.originZ[i] - p0.z;
+			const float u = (sx * px + sy * py + sz * pz) * inverseDeterminant;
+
+			const float qx = sy * edge1.z - sz * edge1.y;
+			const float qy = sz * edge1.x - sx * edge1.z;
+			const float qz = sx * edge1.y - sy * edge1.x;
+			const float v = (packet.directionX[i] * qx + packet.directionY[i] * qy + packet.directionZ[i] * qz) * inverseDeterminant;
+			const float t = (edge2.x * qx + edge2.y * qy + edge2.z * qz) * inverseDeterminant;
+
+			// comparisons with NaN from parallel rays fail as well
+			const bool hit = determinant != 0.0f && u >= 0.0f && v >= 0.0f && u + v <= 1.0f && t > 0.0f && t < packet.distance[i];
+			packet.distance[i] = hit ? t : packet.distance[i];
+			packet.u[i] = hit ? u : packet.u[i];
+			packet.v[i] = hit ? v : packet.v[i];
+			packet.triangle[i] = hit ? index : packet.triangle[i];
+		}
+	}
+
+	// visits the nodes hit by any ray of the packet, closer children first, and skips nodes behind all hits found so far
+	void trace(RayPacket& packet, const Bvh& bvh, const Vertex* vertices, StackEntry* stack)
+	{
+		const BvhNode* nodes = bvh.nodes().data();
+		const BvhTriangle* triangles = bvh.triangles().data();
+		std::size_t stackSize = 0;
+		uint node = 0;
+		float entry = 0.0f;
+
+		if (!intersectNode(packet, nodes[0], entry))
+			return;
+
+		while (true)
+		{
+			const BvhNode& current = nodes[node];
+
+			if (current.triangleCount == 0)
+			{
+				float firstEntry = 0.0f;
+				float secondEntry = 0.0f;
+				const bool first = intersectNode(packet, nodes[node + 1], firstEntry);
+				const bool second = intersectNode(packet, nodes[current.offset], secondEntry);
+
+				if (first && second)
+				{
+					if (secondEntry < firstEntry)
+					{
+						stack[stackSize++] = { node + 1, firstEntry };
+						node = current.offset;
+					}
+					else
+					{
+						stack[stackSize++] = { current.offset, secondEntry };
+						node = node + 1;
+					}
+
+					continue;
+				}
+				else if (first)
+				{
+					node = node + 1;
+					continue;
+				}
+				else if (second)
+				{
+					node = current.offset;
+					continue;
+				}
+			}
+			else
+			{
+				for (uint i = current.offset; i < current.offset + current.triangleCount; i++)
+					intersectTriangle(packet, triangles[i], i, vertices);
+			}
+
+			float farthestHit = 0.0f;
+
+			for (int i = 0; i < packetSize; i++)
+				farthestHit = std::max(farthestHit, packet.distance[i]);
+
+			while (stackSize > 0 && stack[stackSize - 1].distance > farthestHit)
+				stackSize--;
+
+			if (stackSize == 0)
+				return;
+
+			node = stack[--stackSize].node;
+		}
+	}
+}
+
+RayTracer::RayTracer(unsigned int threadCount) : m_pool(std::make_unique<ThreadPool>(threadCount))
+{
+}
+
+RayTracer::~RayTracer()
+{
+}
+
+void RayTracer::render(const Model& model, const mat4& modelViewProjectionMatrix, const vec3& lightPosition, const ivec2& size, const vec2& samplePosition)
+{
+	const auto start = std::chrono::steady_clock::now();
+
+	m_size = size;
+	m_colors.assign(std::size_t(size.x) * std::size_t(size.y) * 4, 0);
+	m_depths.assign(std::size_t(size.x) * std::size_t(size.y), 1.0f);
+	m_statistics = Statistics();
+
+	const Bvh& bvh = model.bvh();
+	const std::vector<Vertex>& vertices = model.vertices();
+	const std::vector<Group>& groups = model.groups();
+	const std::vector<Material>& materials = model.materials();
+
+	if (bvh.empty() || vertices.empty() || size.x <= 0 || size.y <= 0)
+		return;
+
+	const mat4 inverseModelViewProjectionMatrix = glm::inverse(modelViewProjectionMatrix);
+	const ivec2 tiles = (size + ivec2(tileSize - 1)) / tileSize;
+	const std::size_t tileCount = std::size_t(tiles.x) * std::size_t(tiles.y);
+	const std::size_t workerCount = m_pool->threadCount() + 1;
+
+	// every thread starts with a contiguous band of tiles, so that neighboring tiles share the nodes in the caches
+	std::vector<TileQueue> queues(workerCount);
+
+	for (std::size_t i = 0; i < workerCount; i++)
+	{
+		queues[i].begin = tileCount * i / workerCount;
+		queues[i].end = tileCount * (i + 1) / workerCount;
+	}
+
+	std::atomic<std::size_t> stolenTileCount = 0;
+
+	auto shade = [&](const RayPacket& packet, int lane, std::size_t pixel) {
+		const BvhTriangle& triangle = bvh.triangles()[packet.triangle[lane]];
+		const Vertex& v0 = vertices[triangle.indices[0]];
+		const Vertex& v1 = vertices[triangle.indices[1]];
+		const Vertex& v2 = vertices[triangle.indices[2]];
+
+		const vec3 direction = vec3(packet.directionX[lane], packet.directionY[lane], packet.directionZ[lane]);
+		const vec3 position = vec3(packet.originX[lane], packet.originY[lane], packet.originZ[lane]) + packet.distance[lane] * direction;
+		const float u = packet.u[lane];
+		const float v = packet.v[lane];
+		vec3 normal = (1.0f - u - v) * v0.normal + u * v1.normal + v * v2.normal;
+
+		if (dot(normal, normal) == 0.0f)
+			normal = cross(v1.position - v0.position, v2.position - v0.position);
+
+		// both sides of a triangle are lit
+		normal = normalize(normal);
+
+		if (dot(normal, direction) > 0.0f)
+			normal = -normal;
+
+		// the group containing the triangle is the last one starting before it
+		const uint index = triangle.triangle * 3;
+		auto group = std::upper_bound(groups.begin(), groups.end(), index, [](uint i, const Group& g) { return i < g.startIndex; });
+		vec3 diffuse = vec3(0.8f);
+
+		if (group != groups.begin() && std::prev(group)->materialIndex < materials.size())
+			diffuse = materials[std::prev(group)->materialIndex].diffuse;
+
+		const vec3 lightDirection = normalize(lightPosition - position);
+		const vec3 color = diffuse * (0.2f + 0.8f * std::max(dot(normal, lightDirection), 0.0f));
+
+		for (int c = 0; c < 3; c++)
+			m_colors[pixel * 4 + c] = std::uint8_t(clamp(color[c], 0.0f, 1.0f) * 255.0f + 0.5f);
+
+		m_colors[pixel * 4 + 3] = 255;
+
+		// same as calcDepth() in the shader
+		const vec4 clipPosition = modelViewProjectionMatrix * vec4(position, 1.0f);
+		m_depths[pixel] = clamp(0.5f * clipPosition.z / clipPosition.w + 0.5f, 0.0f, 1.0f);
+	};
+
+	auto renderTile = [&](std::size_t tile, StackEntry* stack) {
+		const ivec2 tileStart = ivec2(int(tile % std::size_t(tiles.x)), int(tile / std::size_t(tiles.x))) * tileSize;
+		const ivec2 tileEnd = min(tileStart + ivec2(tileSize), size);
+		RayPacket packet;
+
+		for (int y = tileStart.y; y < tileEnd.y; y += packetHeight)
+		{
+			for (int x = tileStart.x; x < tileEnd.x; x += packetWidth)
+			{
+				for (int i = 0; i < packetSize; i++)
+				{
+					const ivec2 pixel = ivec2(x + i % packetWidth, y + i / packetWidth);
+					const vec2 ndc = (vec2(pixel) + samplePosition) / vec2(size) * 2.0f - 1.0f;
+
+					vec4 near = inverseModelViewProjectionMatrix * vec4(ndc, -1.0f, 1.0f);
+					vec4 far = inverseModelViewProjectionMatrix * vec4(ndc, 1.0f, 1.0f);
+					near /= near.w;
+					far /= far.w;
+					const vec3 direction = normalize(vec3(far - near));
+
+					packet.originX[i] = near.x;
+					packet.originY[i] = near.y;
+					packet.originZ[i] = near.z;
+					packet.directionX[i] = direction.x;
+					packet.directionY[i] = direction.y;
+					packet.directionZ[i] = direction.z;
+					packet.inverseDirectionX[i] = reciprocal(direction.x);
+					packet.inverseDirectionY[i] = reciprocal(direction.y);
+					packet.inverseDirectionZ[i] = reciprocal(direction.z);
+					packet.distance[i] = pixel.x < tileEnd.x && pixel.y < tileEnd.y ? infinity : -1.0f;
+					packet.u[i] = 0.0f;
+					packet.v[i] = 0.0f;
+					packet.triangle[i] = noTriangle;
+				}
+
+				trace(packet, bvh, vertices.data(), stack);
+
+				for (int i = 0; i < packetSize; i++)
+				{
+					if (packet.triangle[i] != noTriangle)
+						shade(packet, i, std::size_t(y + i / packetWidth) * std::size_t(size.x) + std::size_t(x + i % packetWidth));
+				}
+			}
+		}
+	};
+
+	m_pool->parallelFor(workerCount, [&](std::size_t worker) {
+		// at most one entry per level is pushed while descending
+		std::vector<StackEntry> stack(bvh.statistics().depth + 1);
+		TileQueue& queue = queues[worker];
+
+		while (true)
+		{
+			std::size_t tile = 0;
+			bool found = false;
+
+			{
+				std::lock_guard<std::mutex> lock(queue.mutex);
+
+				if (queue.begin < queue.end)
+				{
+					tile = queue.begin++;
+					found = true;
+				}
+			}
+
+			if (found)
+			{
+				renderTile(tile, stack.data());
+				continue;
+			}
+
+			// takes the back half of the first other queue that has tiles left, which keeps the taken tiles close to each other
+			for (std::size_t i = 1; i < workerCount && !found; i++)
+			{
+				TileQueue& victim = queues[(worker + i) % workerCount];
+				std::size_t begin = 0;
+				std::size_t end = 0;
+
+				{
+					std::lock_guard<std::mutex> lock(victim.mutex);
+					end = victim.end;
+					begin = end - (victim.end - victim.begin) / 2;
+
+					// a single tile is left to its owner
+					if (begin == end)
+						continue;
+
+					victim.end = begin;
+				}
+
+				std::lock_guard<std::mutex> lock(queue.mutex);
+				queue.begin = begin;
+				queue.end = end;
+				stolenTileCount += end - begin;
+				found = true;
+			}
+
+			if (!found)
+				break;
+		}
+	});
+
+	m_statistics.rayCount = std::size_t(size.x) * std::size_t(size.y);
+	m_statistics.tileCount = tileCount;
+	m_statistics.stolenTileCount = stolenTileCount;
+	m_statistics.threadCount = unsigned(workerCount);
+	m_statistics.renderTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+const ivec2& RayTracer::size() const
+{
+	return m_size;
+}
+
+const std::vector<std::uint8_t>& RayTracer::colors() const
+{
+	return m_colors;
+}
+
+const std::vector<float>& RayTracer::depths() const
+{
+	return m_depths;
+}
+
+const RayTracer::Statistics& RayTracer::statistics() const
+{
+	return m_statistics;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace minity
+{
+	class Model;
+	class ThreadPool;
+
+	// traces primary rays through the bounding volume hierarchy of a model on the CPU
+	// the image is split into tiles, which are distributed over the threads and taken over by threads running out of work
+	// within a tile, rays are traced in packets of neighboring pixels that share their traversal of the hierarchy
+	class RayTracer
+	{
+	public:
+		struct Statistics
+		{
+			std::size_t rayCount = 0;
+			std::size_t tileCount = 0;
+			// tiles that were rendered by another thread than the one they were assigned to
+			std::size_t stolenTileCount = 0;
+			unsigned int threadCount = 0;
+			double renderTime = 0.0;
+		};
+
+		static constexpr int tileSize = 16;
+		// pixels per packet, stored as one array per component so that the loops over the rays are vectorized
+		static constexpr int packetWidth = 4;
+		static constexpr int packetHeight = 2;
+
+		// zero threads uses all hardware threads
+		RayTracer(unsigned int threadCount = 0);
+		~RayTracer();
+
+		// renders the model with one ray per pixel, lit by a point light given in object space
+		// the rays pass through the sample position within their pixels, which is jittered for accumulating several images
+		// needs the hierarchy and the vertices of the model in main memory, otherwise the image stays empty
+		void render(const Model& model, const glm::mat4& modelViewProjectionMatrix, const glm::vec3& lightPosition, const glm::ivec2& size, const glm::vec2& samplePosition = glm::vec2(0.5f));
+
+		const glm::ivec2& size() const;
+		// RGBA with eight bits per channel, in rows from bottom to top like OpenGL textures, alpha is zero for pixels without a hit
+		const std::vector<std::uint8_t>& colors() const;
+		// window space depth for the default depth range, 1 for pixels without a hit
+		const std::vector<float>& depths() const;
+		const Statistics& statistics() const;
+
+	private:
+		std::unique_ptr<ThreadPool> m_pool;
+		glm::ivec2 m_size = glm::ivec2(0);
+		std::vector<std::uint8_t> m_colors;
+		std::vector<float> m_depths;
+		Statistics m_statistics;
+	};
+}
@@ -7,6 +7,8 @@
 #include "Viewer.h"
 #include "Scene.h"
 #include "Model.h"
+#include "RayTracer.h"
+#include "GBuffer.h"
 #include <sstream>
 
 #include <glm/gtc/type_ptr.hpp>
@@ -20,6 +22,24 @@ using namespace gl;
 using namespace glm;
 using namespace globjects;
 
+namespace
+{
+	// low discrepancy sequence in [0, 1) for the sample positions within the pixels
+	float halton(int index, int base)
+	{
+		float result = 0.0f;
+		float fraction = 1.0f / float(base);
+
+		for (int i = index; i > 0; i /= base)
+		{
+			result += fraction * float(i % base);
+			fraction /= float(base);
+		}
+
+		return result;
+	}
+}
+
 RaytraceRenderer::RaytraceRenderer(Viewer *viewer) : Renderer(viewer)
 {
 	m_quadVertices->setData(std::array<vec2, 4>({vec2(-1.0f, 1.0f), vec2(-1.0f, -1.0f), vec2(1.0f, 1.0f), vec2(1.0f, -1.0f)}), gl::GL_STATIC_DRAW);
@@ -34,6 +54,23 @@ RaytraceRenderer::RaytraceRenderer(Viewer *viewer) : Renderer(viewer)
 										{GL_FRAGMENT_SHADER, "./res/raytrace/raytrace-fs.glsl"},
 									},
 						{"./res/raytrace/raytrace-globals.glsl"});
+
+	createShaderProgram("raytrace-accumulation", {
+													 {GL_VERTEX_SHADER, "./res/raytrace/raytrace-vs.glsl"},
+													 {GL_FRAGMENT_SHADER, "./res/raytrace/raytrace-accumulation-fs.glsl"},
+												 },
+						{"./res/raytrace/raytrace-globals.glsl"});
+}
+
+RaytraceRenderer::~RaytraceRenderer()
+{
+}
+
+bool RaytraceRenderer::AccumulationState::operator==(const AccumulationState &state) const
+{
+	return modelTransform == state.modelTransform && viewTransform == state.viewTransform && lightTransform == state.lightTransform && projectionTransform == state.projectionTransform &&
+		   viewportSize == state.viewportSize && cpuBackendEnabled == state.cpuBackendEnabled && bvhNodeTexture == state.bvhNodeTexture && vertexCount == state.vertexCount &&
+		   hybridEnabled == state.hybridEnabled && shadowsEnabled == state.shadowsEnabled && ambientOcclusionSampleCount == state.ambientOcclusionSampleCount && ambientOcclusionRadius == state.ambientOcclusionRadius;
 }
 
 void RaytraceRenderer::display()
@@ -44,22 +81,324 @@ void RaytraceRenderer::display()
 	// retrieve/compute all necessary matrices and related properties
 	const mat4 modelViewProjectionMatrix = viewer()->modelViewProjectionTransform();
 	const mat4 inverseModelViewProjectionMatrix = inverse(modelViewProjectionMatrix);
+	const mat4 modelLightMatrix = viewer()->modelLightTransform();
+	const mat4 inverseModelLightMatrix = inverse(modelLightMatrix);
+	const ivec2 viewportSize = viewer()->viewportSize();
+	const vec4 worldLightPosition = inverseModelLightMatrix * vec4(0.0f, 0.0f, 0.0f, 1.0f);
+
+	Model &model = *viewer()->scene()->model();
+	const bool bvhEnabled = model.bvhNodeTexture() != nullptr;
+	// hierarchies from older builds may not fit the traversal stack of the shader, which then tests all triangles
+	const bool bvhTooDeep = bvhEnabled && model.bvh().statistics().depth > Bvh::maximumDepth;
+
+	static bool cpuBackendEnabled = false;
+	static bool bruteForceEnabled = false;
+	static bool accumulationEnabled = false;
+	static int sampleTarget = 64;
+	static int samplesPerFrame = 1;
+	static bool hybridEnabled = false;
+	static bool shadowsEnabled = true;
+	static int ambientOcclusionSampleCount = 4;
+	static float ambientOcclusionRadius = 0.1f;
+
+	// the model renderer fills the G-buffer in the frames after it was requested
+	GBuffer *gBuffer = viewer()->gBuffer();
+	const bool hybridRequested = hybridEnabled && !cpuBackendEnabled && bvhEnabled;
+	const bool hybridActive = hybridRequested && gBuffer->isFilled() && gBuffer->size() == viewportSize;
+
+	if (ImGui::BeginMenu("Raytrace"))
+	{
+		ImGui::Checkbox("CPU Backend Enabled", &cpuBackendEnabled);
+
+		if (!cpuBackendEnabled)
+		{
+			ImGui::Checkbox("Brute Force Enabled", &bruteForceEnabled);
+
+			if (bvhEnabled)
+			{
+				// the frame rate includes the other renderers, so this is a lower bound
+				// the hybrid mode traces its rays only from pixels covered by the model, so the count is an upper bound there
+				const double raysPerPixel = hybridActive ? double(shadowsEnabled ? 1 : 0) + double(ambientOcclusionSampleCount) : 1.0;
+				const double rayCount = double(viewportSize.x) * double(viewportSize.y) * raysPerPixel;
+				ImGui::Text("%.0f rays per frame, %.1f Mrays/s", rayCount, rayCount * double(ImGui::GetIO().Framerate) / 1000000.0);
+				ImGui::Text("BVH with %zu nodes and depth %zu", model.bvh().statistics().nodeCount, model.bvh().statistics().depth);
+
+				if (bvhTooDeep)
+					ImGui::Text("BVH deeper than %zu levels, testing all triangles", Bvh::maximumDepth);
+			}
+			else
+			{
+				ImGui::Text("Needs the BVH");
+			}
+		}
+
+		if (cpuBackendEnabled && m_rayTracer)
+		{
+			const RayTracer::Statistics &statistics = m_rayTracer->statistics();
+
+			if (statistics.rayCount > 0)
+			{
+				ImGui::Text("%zu rays in %.1f ms, %.1f Mrays/s", statistics.rayCount, statistics.renderTime, double(statistics.rayCount) / (1000.0 * statistics.renderTime));
+				ImGui::Text("%zu tiles on %u threads, %zu taken over", statistics.tileCount, statistics.threadCount, statistics.stolenTileCount);
+			}
+			else
+			{
+				ImGui::Text("Needs the BVH and the geometry in main memory");
+			}
+		}
+
+		if (!cpuBackendEnabled && ImGui::CollapsingHeader("Hybrid"))
+		{
+			ImGui::Checkbox("Hybrid Enabled", &hybridEnabled);
+			ImGui::Checkbox("Shadows Enabled", &shadowsEnabled);
+			ImGui::SliderInt("Occlusion Samples", &ambientOcclusionSampleCount, 0, 32);
+			ImGui::SliderFloat("Occlusion Radius", &ambientOcclusionRadius, 0.01f, 1.0f, "%.2f");
+
+			if (hybridEnabled && !hybridActive)
+				ImGui::Text("Needs the BVH and the model renderer");
+		}
+
+		if (ImGui::CollapsingHeader("Accumulation"))
+		{
+			ImGui::Checkbox("Accumulation Enabled", &accumulationEnabled);
+			ImGui::SliderInt("Sample Target", &sampleTarget, 1, 1024);
+			ImGui::SliderInt("Samples per Frame", &samplesPerFrame, 1, 16);
+			ImGui::Text("%d of %d samples", accumulationEnabled ? m_sampleCount : 0, sampleTarget);
+		}
+
+		ImGui::EndMenu();
+	}
 
 	auto shaderProgramRaytrace = shaderProgram("raytrace");
 
-	glEnable(GL_DEPTH_TEST);
-	glDepthFunc(GL_LESS);
+	if (!cpuBackendEnabled && bvhEnabled)
+	{
+		// diffuse colors of the materials, indexed by the triangles of the hierarchy
+		std::vector<vec4> materialColors;
+
+		for (const Material &material : model.materials())
+			materialColors.push_back(vec4(material.diffuse, 1.0f));
+
+		if (materialColors.empty())
+			materialColors.push_back(vec4(0.8f, 0.8f, 0.8f, 1.0f));
+
+		m_materialBuffer->setData(materialColors, GL_DYNAMIC_DRAW);
+		m_materialTexture->texBuffer(GL_RGBA32F, m_materialBuffer.get());
+
+		model.bvhNodeTexture()->bindActive(2);
+		model.bvhTriangleTexture()->bindActive(3);
+		m_materialTexture->bindActive(4);
+		shaderProgramRaytrace->setUniform("bruteForceEnabled", bruteForceEnabled || bvhTooDeep);
+		shaderProgramRaytrace->setUniform("triangleCount", int(model.bvh().triangles().size()));
+		shaderProgramRaytrace->setUniform("minimumBounds", model.minimumBounds());
+		shaderProgramRaytrace->setUniform("maximumBounds", model.maximumBounds());
+		shaderProgramRaytrace->setUniform("worldLightPosition", vec3(worldLightPosition));
+	}
+
+	if (hybridActive)
+	{
+		gBuffer->depthTexture()->bindActive(5);
+		gBuffer->normalTexture()->bindActive(6);
+		gBuffer->materialTexture()->bindActive(7);
+		shaderProgramRaytrace->setUniform("shadowsEnabled", shadowsEnabled);
+		shaderProgramRaytrace->setUniform("ambientOcclusionSampleCount", ambientOcclusionSampleCount);
+		shaderProgramRaytrace->setUniform("ambientOcclusionRadius", ambientOcclusionRadius);
+	}
+
+	// samplers of different types must not share a unit, even if they are not used
+	shaderProgramRaytrace->setUniform("colorTexture", 0);
+	shaderProgramRaytrace->setUniform("depthTexture", 1);
+	shaderProgramRaytrace->setUniform("bvhNodes", 2);
+	shaderProgramRaytrace->setUniform("bvhTriangles", 3);
+	shaderProgramRaytrace->setUniform("materialColors", 4);
+	shaderProgramRaytrace->setUniform("gBufferDepth", 5);
+	shaderProgramRaytrace->setUniform("gBufferNormal", 6);
+	shaderProgramRaytrace->setUniform("gBufferMaterial", 7);
 
+	shaderProgramRaytrace->setUniform("cpuBackendEnabled", cpuBackendEnabled);
+	shaderProgramRaytrace->setUniform("bvhEnabled", !cpuBackendEnabled && bvhEnabled);
+	shaderProgramRaytrace->setUniform("hybridEnabled", hybridActive);
+	shaderProgramRaytrace->setUniform("sampleIndex", 0);
 	shaderProgramRaytrace->setUniform("modelViewProjectionMatrix", modelViewProjectionMatrix);
 	shaderProgramRaytrace->setUniform("inverseModelViewProjectionMatrix", inverseModelViewProjectionMatrix);
+	shaderProgramRaytrace->setUniform("accumulationEnabled", accumulationEnabled);
 
-	m_quadArray->bind();
-	shaderProgramRaytrace->use();
-	// we are rendering a screen filling quad (as a tringle strip), so we can cast rays for every pixel
-	m_quadArray->drawArrays(GL_TRIANGLE_STRIP, 0, 4);
-	shaderProgramRaytrace->release();
-	m_quadArray->unbind();
+	// traces one sample per pixel through the given position within the pixels
+	auto trace = [&](const vec2 &samplePosition) {
+		if (cpuBackendEnabled)
+		{
+			if (!m_rayTracer)
+				m_rayTracer = std::make_unique<RayTracer>();
+
+			m_rayTracer->render(model, modelViewProjectionMatrix, vec3(worldLightPosition), viewportSize, samplePosition);
+
+			if (!m_colorTexture || m_textureSize != viewportSize)
+			{
+				m_colorTexture = Texture::create(GL_TEXTURE_2D);
+				m_depthTexture = Texture::create(GL_TEXTURE_2D);
+
+				for (Texture *texture : { m_colorTexture.get(), m_depthTexture.get() })
+				{
+					texture->setParameter(GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+					texture->setParameter(GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+					texture->setParameter(GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+					texture->setParameter(GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+				}
+
+				m_colorTexture->image2D(0, GL_RGBA8, viewportSize, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+				m_depthTexture->image2D(0, GL_R32F, viewportSize, 0, GL_RED, GL_FLOAT, nullptr);
+				m_textureSize = viewportSize;
+			}
+
+			m_colorTexture->subImage2D(0, ivec2(0), viewportSize, GL_RGBA, GL_UNSIGNED_BYTE, m_rayTracer->colors().data());
+			m_depthTexture->subImage2D(0, ivec2(0), viewportSize, GL_RED, GL_FLOAT, m_rayTracer->depths().data());
+
+			m_colorTexture->bindActive(0);
+			m_depthTexture->bindActive(1);
+		}
+
+		shaderProgramRaytrace->setUniform("jitter", (samplePosition - vec2(0.5f)) * 2.0f / vec2(viewportSize));
+
+		m_quadArray->bind();
+		shaderProgramRaytrace->use();
+		// we are rendering a screen filling quad (as a tringle strip), so we can cast rays for every pixel
+		m_quadArray->drawArrays(GL_TRIANGLE_STRIP, 0, 4);
+		shaderProgramRaytrace->release();
+		m_quadArray->unbind();
+
+		if (cpuBackendEnabled)
+		{
+			m_colorTexture->unbindActive(0);
+			m_depthTexture->unbindActive(1);
+		}
+	};
+
+	if (accumulationEnabled)
+	{
+		AccumulationState state;
+		state.modelTransform = viewer()->modelTransform();
+		state.viewTransform = viewer()->viewTransform();
+		state.lightTransform = viewer()->lightTransform();
+		state.projectionTransform = viewer()->projectionTransform();
+		state.viewportSize = viewportSize;
+		state.cpuBackendEnabled = cpuBackendEnabled;
+		state.bvhNodeTexture = model.bvhNodeTexture();
+		state.vertexCount = model.vertexCount();
+		state.hybridEnabled = hybridActive;
+		state.shadowsEnabled = shadowsEnabled;
+		state.ambientOcclusionSampleCount = ambientOcclusionSampleCount;
+		state.ambientOcclusionRadius = ambientOcclusionRadius;
+
+		if (!m_accumulationFramebuffer || !(state == m_accumulationState))
+		{
+			if (!m_accumulationFramebuffer || state.viewportSize != m_accumulationState.viewportSize)
+			{
+				m_accumulationTexture = Texture::create(GL_TEXTURE_2D);
+				m_accumulationDepthTexture = Texture::create(GL_TEXTURE_2D);
+
+				for (Texture *texture : { m_accumulationTexture.get(), m_accumulationDepthTexture.get() })
+				{
+					texture->setParameter(GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+					texture->setParameter(GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+					texture->setParameter(GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+					texture->setParameter(GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+				}
+
+				m_accumulationTexture->image2D(0, GL_RGBA32F, viewportSize, 0, GL_RGBA, GL_FLOAT, nullptr);
+				m_accumulationDepthTexture->image2D(0, GL_R32F, viewportSize, 0, GL_RED, GL_FLOAT, nullptr);
+
+				m_accumulationFramebuffer = Framebuffer::create();
+				m_accumulationFramebuffer->attachTexture(GL_COLOR_ATTACHMENT0, m_accumulationTexture.get());
+				m_accumulationFramebuffer->attachTexture(GL_COLOR_ATTACHMENT1, m_accumulationDepthTexture.get());
+				m_accumulationFramebuffer->setDrawBuffers({ GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 });
+			}
+
+			m_accumulationFramebuffer->clearBuffer(GL_COLOR, 0, vec4(0.0f));
+			m_accumulationFramebuffer->clearBuffer(GL_COLOR, 1, vec4(0.0f));
+			m_accumulationState = state;
+			m_sampleCount = 0;
+		}
+
+		// once the target is reached, the frames only show the average
+		const int sampleCount = std::min(samplesPerFrame, sampleTarget - m_sampleCount);
+
+		if (sampleCount > 0)
+		{
+			m_accumulationFramebuffer->bind();
+			glDisable(GL_DEPTH_TEST);
+			glEnable(GL_BLEND);
+			glBlendFunc(GL_ONE, GL_ONE);
+
+			for (int i = 0; i < sampleCount; i++)
+			{
+				// the first sample is in the center of the pixels, so that its depth matches the rasterized geometry
+				const vec2 samplePosition = m_sampleCount == 0 ? vec2(0.5f) : vec2(halton(m_sampleCount, 2), halton(m_sampleCount, 3));
+				shaderProgramRaytrace->setUniform("firstSample", m_sampleCount == 0);
+				shaderProgramRaytrace->setUniform("sampleIndex", m_sampleCount);
+				trace(samplePosition);
+				m_sampleCount++;
+			}
+
+			glDisable(GL_BLEND);
+			Framebuffer::unbind();
+		}
+
+		auto shaderProgramAccumulation = shaderProgram("raytrace-accumulation");
+
+		// pixels without a hit of the first sample still show the coverage of the others in front of the background
+		glEnable(GL_DEPTH_TEST);
+		glDepthFunc(GL_LEQUAL);
+		glEnable(GL_BLEND);
+		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+		m_accumulationTexture->bindActive(0);
+		m_accumulationDepthTexture->bindActive(1);
+		shaderProgramAccumulation->setUniform("accumulationTexture", 0);
+		shaderProgramAccumulation->setUniform("depthTexture", 1);
+		shaderProgramAccumulation->setUniform("sampleCount", m_sampleCount);
+
+		m_quadArray->bind();
+		shaderProgramAccumulation->use();
+		m_quadArray->drawArrays(GL_TRIANGLE_STRIP, 0, 4);
+		shaderProgramAccumulation->release();
+		m_quadArray->unbind();
+
+		m_accumulationTexture->unbindActive(0);
+		m_accumulationDepthTexture->unbindActive(1);
+
+		glDisable(GL_BLEND);
+		glDepthFunc(GL_LESS);
+	}
+	else
+	{
+		m_accumulationFramebuffer.reset();
+		m_accumulationTexture.reset();
+		m_accumulationDepthTexture.reset();
+
+		glEnable(GL_DEPTH_TEST);
+		glDepthFunc(GL_LESS);
+
+		trace(vec2(0.5f));
+	}
+
+	if (!cpuBackendEnabled && bvhEnabled)
+	{
+		model.bvhNodeTexture()->unbindActive(2);
+		model.bvhTriangleTexture()->unbindActive(3);
+		m_materialTexture->unbindActive(4);
+	}
+
+	if (hybridActive)
+	{
+		gBuffer->depthTexture()->unbindActive(5);
+		gBuffer->normalTexture()->unbindActive(6);
+		gBuffer->materialTexture()->unbindActive(7);
+	}
+
+	// without a new request, the model is drawn to the screen again
+	if (hybridRequested)
+		gBuffer->request();
 
 	// Restore OpenGL state (disabled to to issues with some Intel drivers)
 	// currentState->apply();
-}
\ No newline at end of file
+}
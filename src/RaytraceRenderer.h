@@ -23,14 +23,52 @@
 namespace minity
 {
 	class Viewer;
+	class RayTracer;
 
 	class RaytraceRenderer : public Renderer
 	{
 	public:
 		RaytraceRenderer(Viewer *viewer);
+		~RaytraceRenderer();
 		virtual void display();
 
 	private:
+		// traces the image on the CPU, the result is uploaded to the textures and drawn with its depth by the quad
+		std::unique_ptr<RayTracer> m_rayTracer;
+		std::unique_ptr<globjects::Texture> m_colorTexture;
+		std::unique_ptr<globjects::Texture> m_depthTexture;
+		glm::ivec2 m_textureSize = glm::ivec2(0);
+
+		// diffuse colors of the materials for the traversal in the shader, the hierarchy itself is provided by the model
+		std::unique_ptr<globjects::Buffer> m_materialBuffer = std::make_unique<globjects::Buffer>();
+		std::unique_ptr<globjects::Texture> m_materialTexture = globjects::Texture::create(gl::GL_TEXTURE_BUFFER);
+
+		// everything the accumulated samples depend on, any change starts the accumulation over
+		struct AccumulationState
+		{
+			glm::mat4 modelTransform = glm::mat4(1.0f);
+			glm::mat4 viewTransform = glm::mat4(1.0f);
+			glm::mat4 lightTransform = glm::mat4(1.0f);
+			glm::mat4 projectionTransform = glm::mat4(1.0f);
+			glm::ivec2 viewportSize = glm::ivec2(0);
+			bool cpuBackendEnabled = false;
+			const globjects::Texture *bvhNodeTexture = nullptr;
+			std::size_t vertexCount = 0;
+			bool hybridEnabled = false;
+			bool shadowsEnabled = false;
+			int ambientOcclusionSampleCount = 0;
+			float ambientOcclusionRadius = 0.0f;
+
+			bool operator==(const AccumulationState &state) const;
+		};
+
+		// sums of jittered samples with their coverage in alpha, and the depth of the first sample
+		std::unique_ptr<globjects::Framebuffer> m_accumulationFramebuffer;
+		std::unique_ptr<globjects::Texture> m_accumulationTexture;
+		std::unique_ptr<globjects::Texture> m_accumulationDepthTexture;
+		AccumulationState m_accumulationState;
+		int m_sampleCount = 0;
+
 		std::unique_ptr<globjects::VertexArray> m_quadArray = std::make_unique<globjects::VertexArray>();
 		std::unique_ptr<globjects::Buffer> m_quadVertices = std::make_unique<globjects::Buffer>();
 	};
@@ -1,15 +1,32 @@
 #include "Scene.h"
 #include "Model.h"
+#include "TextureCache.h"
+#include "TextureStreamer.h"
 #include <iostream>
 
 using namespace minity;
 
 Scene::Scene()
 {
+	// all models of the scene share their textures
+	m_textureCache = std::make_shared<TextureCache>();
+	m_textureStreamer = std::make_shared<TextureStreamer>();
 	m_model = std::make_unique<Model>();
+	m_model->setTextureCache(m_textureCache);
+	m_model->setTextureStreamer(m_textureStreamer);
 }
 
 Model * Scene::model()
 {
 	return m_model.get();
+}
+
+TextureCache * Scene::textureCache()
+{
+	return m_textureCache.get();
+}
+
+TextureStreamer * Scene::textureStreamer()
+{
+	return m_textureStreamer.get();
 }
\ No newline at end of file
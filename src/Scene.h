@@ -5,14 +5,20 @@
 namespace minity
 {
 	class Model;
+	class TextureCache;
+	class TextureStreamer;
 
 	class Scene
 	{
 	public:
 		Scene();
 		Model* model();
+		TextureCache* textureCache();
+		TextureStreamer* textureStreamer();
 
 	private:
+		std::shared_ptr<TextureCache> m_textureCache;
+		std::shared_ptr<TextureStreamer> m_textureStreamer;
 		std::unique_ptr<Model> m_model;
 	};
 
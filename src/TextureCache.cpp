@@ -0,0 +1,181 @@
+#include "TextureCache.h"
+#include "MappedFile.h"
+
+#include <filesystem>
+#include <cstring>
+
+using namespace minity;
+using namespace globjects;
+
+namespace
+{
+	std::uint64_t hashContents(const char* data, std::size_t size)
+	{
+		// 64-bit FNV-1a over words, finished with the finalizer of MurmurHash3
+		std::uint64_t hash = 14695981039346656037ull;
+		std::size_t i = 0;
+
+		for (; i + sizeof(std::uint64_t) <= size; i += sizeof(std::uint64_t))
+		{
+			std::uint64_t word;
+			std::memcpy(&word, data + i, sizeof(word));
+			hash ^= word;
+			hash *= 1099511628211ull;
+		}
+
+		for (; i < size; i++)
+		{
+			hash ^= static_cast<unsigned char>(data[i]);
+			hash *= 1099511628211ull;
+		}
+
+		hash ^= hash >> 33;
+		hash *= 0xFF51AFD7ED558CCDull;
+		hash ^= hash >> 33;
+		hash *= 0xC4CEB9FE1A85EC53ull;
+		hash ^= hash >> 33;
+
+		return hash;
+	}
+}
+
+bool TextureCache::Key::operator==(const Key& other) const
+{
+	return hash == other.hash && size == other.size && variant == other.variant;
+}
+
+bool TextureCache::Key::operator<(const Key& other) const
+{
+	if (hash != other.hash)
+		return hash < other.hash;
+
+	if (size != other.size)
+		return size < other.size;
+
+	return variant < other.variant;
+}
+
+std::size_t TextureCache::KeyHash::operator()(const Key& key) const
+{
+	return std::size_t(key.hash ^ (std::uint64_t(key.variant) * 0x9e3779b97f4a7c15ull));
+}
+
+bool TextureCache::identify(const std::string& filename, Key& key)
+{
+	std::error_code error;
+	const std::filesystem::path path = std::filesystem::weakly_canonical(filename, error);
+
+	if (error)
+		return false;
+
+	const std::uint64_t size = std::filesystem::file_size(path, error);
+
+	if (error)
+		return false;
+
+	const std::int64_t time = std::filesystem::last_write_time(path, error).time_since_epoch().count();
+
+	if (error)
+		return false;
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		auto i = m_files.find(path.string());
+
+		if (i != m_files.end() && i->second.size == size && i->second.time == time)
+		{
+			key = i->second.key;
+			return true;
+		}
+	}
+
+	MappedFile file;
+
+	if (!file.open(path.string()))
+		return false;
+
+	key.hash = hashContents(file.data(), file.size());
+	key.size = file.size();
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_files[path.string()] = { size, time, key };
+
+	return true;
+}
+
+bool TextureCache::contains(const Key& key) const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	auto i = m_entries.find(key);
+
+	return i != m_entries.end() && !i->second.texture.expired();
+}
+
+std::shared_ptr<Texture> TextureCache::find(const Key& key)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	auto i = m_entries.find(key);
+
+	if (i == m_entries.end())
+		return std::shared_ptr<Texture>();
+
+	std::shared_ptr<Texture> texture = i->second.texture.lock();
+
+	if (!texture)
+	{
+		m_entries.erase(i);
+		return texture;
+	}
+
+	m_hits++;
+	m_bytesSaved += i->second.size;
+
+	return texture;
+}
+
+std::shared_ptr<Texture> TextureCache::insert(const Key& key, std::unique_ptr<Texture> texture, std::size_t size, std::size_t uncompressedSize)
+{
+	if (!texture)
+		return std::shared_ptr<Texture>();
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	Entry& entry = m_entries[key];
+
+	// another load may have created the same texture in the meantime
+	if (std::shared_ptr<Texture> existing = entry.texture.lock())
+	{
+		m_hits++;
+		m_bytesSaved += entry.size;
+		return existing;
+	}
+
+	std::shared_ptr<Texture> shared(std::move(texture));
+	entry.texture = shared;
+	entry.size = size;
+	entry.uncompressedSize = uncompressedSize;
+	m_misses++;
+
+	return shared;
+}
+
+TextureCache::Statistics TextureCache::statistics() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	Statistics statistics;
+	statistics.hits = m_hits;
+	statistics.misses = m_misses;
+	statistics.bytesSaved = m_bytesSaved;
+
+	for (const auto& e : m_entries)
+	{
+		if (!e.second.texture.expired())
+		{
+			statistics.textureCount++;
+			statistics.textureBytes += e.second.size;
+			statistics.uncompressedBytes += e.second.uncompressedSize;
+		}
+	}
+
+	return statistics;
+}
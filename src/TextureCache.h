@@ -0,0 +1,80 @@
+#pragma once
+
+#include <globjects/Texture.h>
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace minity
+{
+	// textures shared between all materials and models, identified by the contents of their image files
+	class TextureCache
+	{
+	public:
+		struct Key
+		{
+			std::uint64_t hash = 0;
+			std::uint64_t size = 0;
+			// distinguishes differently encoded textures created from the same image
+			std::uint32_t variant = 0;
+
+			bool operator==(const Key& other) const;
+			bool operator<(const Key& other) const;
+		};
+
+		struct KeyHash
+		{
+			std::size_t operator()(const Key& key) const;
+		};
+
+		struct Statistics
+		{
+			std::size_t hits = 0;
+			std::size_t misses = 0;
+			// texture memory that would have been used without sharing
+			std::size_t bytesSaved = 0;
+			std::size_t textureCount = 0;
+			std::size_t textureBytes = 0;
+			// texture memory that would have been used without block compression
+			std::size_t uncompressedBytes = 0;
+		};
+
+		// determines the key of an image file, files that did not change since they were last identified are not read again
+		// can be called from any thread
+		bool identify(const std::string& filename, Key& key);
+
+		// whether a texture with this key is currently in use, can be called from any thread
+		bool contains(const Key& key) const;
+
+		// have to be called on the thread owning the OpenGL context, since unused textures are released here
+		std::shared_ptr<globjects::Texture> find(const Key& key);
+		std::shared_ptr<globjects::Texture> insert(const Key& key, std::unique_ptr<globjects::Texture> texture, std::size_t size, std::size_t uncompressedSize);
+
+		Statistics statistics() const;
+
+	private:
+		struct Entry
+		{
+			std::weak_ptr<globjects::Texture> texture;
+			std::size_t size = 0;
+			std::size_t uncompressedSize = 0;
+		};
+
+		struct FileEntry
+		{
+			std::uint64_t size = 0;
+			std::int64_t time = 0;
+			Key key;
+		};
+
+		mutable std::mutex m_mutex;
+		std::unordered_map<Key, Entry, KeyHash> m_entries;
+		std::unordered_map<std::string, FileEntry> m_files;
+		std::size_t m_hits = 0;
+		std::size_t m_misses = 0;
+		std::size_t m_bytesSaved = 0;
+	};
+}
@@ -0,0 +1,395 @@
+#include "TextureEncoder.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+using namespace minity;
+using namespace glm;
+
+namespace
+{
+	// pixels of a 4x4 block in row order, missing channels are zero and missing alpha is opaque
+	struct PixelBlock
+	{
+		unsigned char pixels[16][4];
+	};
+
+	void fetchBlock(const TextureImage& image, std::size_t level, int blockX, int blockY, PixelBlock& block)
+	{
+		const ivec2 size = image.levelSize(level);
+		const unsigned char* data = image.levelData(level);
+		const int channels = image.channels;
+
+		// blocks reaching over the border repeat the last row or column
+		for (int y = 0; y < 4; y++)
+		{
+			const int sourceY = std::min(blockY * 4 + y, size.y - 1);
+
+			for (int x = 0; x < 4; x++)
+			{
+				const int sourceX = std::min(blockX * 4 + x, size.x - 1);
+				const unsigned char* source = data + (std::size_t(sourceY) * std::size_t(size.x) + std::size_t(sourceX)) * std::size_t(channels);
+				unsigned char* target = block.pixels[y * 4 + x];
+
+				target[0] = target[1] = target[2] = 0;
+				target[3] = 255;
+
+				for (int c = 0; c < channels; c++)
+					target[c] = source[c];
+			}
+		}
+	}
+
+	void storeLittleEndian(unsigned char* target, std::uint64_t value, int byteCount)
+	{
+		for (int i = 0; i < byteCount; i++)
+			target[i] = static_cast<unsigned char>(value >> (8 * i));
+	}
+
+	// BC4 block with eight interpolated values between the minimum and maximum of one channel
+	void encodeChannelBlock(const PixelBlock& block, int channel, unsigned char* target)
+	{
+		int minimum = 255;
+		int maximum = 0;
+
+		for (int i = 0; i < 16; i++)
+		{
+			minimum = std::min(minimum, int(block.pixels[i][channel]));
+			maximum = std::max(maximum, int(block.pixels[i][channel]));
+		}
+
+		target[0] = static_cast<unsigned char>(maximum);
+		target[1] = static_cast<unsigned char>(minimum);
+
+		std::uint64_t indices = 0;
+
+		if (maximum > minimum)
+		{
+			const float scale = 7.0f / float(maximum - minimum);
+
+			// index 0 is the maximum, index 1 the minimum and indices 2 to 7 lie in between, starting next to the maximum
+			for (int i = 0; i < 16; i++)
+			{
+				const int step = int(float(block.pixels[i][channel] - minimum) * scale + 0.5f);
+				const int index = step == 7 ? 0 : (step == 0 ? 1 : 8 - step);
+				indices |= std::uint64_t(index) << (3 * i);
+			}
+		}
+
+		storeLittleEndian(target + 2, indices, 6);
+	}
+
+	std::uint16_t packColor(const vec3& color)
+	{
+		const vec3 c = clamp(color, vec3(0.0f), vec3(255.0f));
+		const int r = int(c.r * (31.0f / 255.0f) + 0.5f);
+		const int g = int(c.g * (63.0f / 255.0f) + 0.5f);
+		const int b = int(c.b * (31.0f / 255.0f) + 0.5f);
+
+		return static_cast<std::uint16_t>((r << 11) | (g << 5) | b);
+	}
+
+	vec3 unpackColor(std::uint16_t color)
+	{
+		const int r = (color >> 11) & 31;
+		const int g = (color >> 5) & 63;
+		const int b = color & 31;
+
+		return vec3(float((r << 3) | (r >> 2)), float((g << 2) | (g >> 4)), float((b << 3) | (b >> 2)));
+	}
+
+	// BC1 block with endpoints along the principal axis of the colors, refined once by least squares
+	void encodeColorBlock(const PixelBlock& block, unsigned char* target)
+	{
+		// separate channel arrays, so that the loops over the 16 pixels are vectorized
+		float r[16], g[16], b[16];
+
+		for (int i = 0; i < 16; i++)
+		{
+			r[i] = float(block.pixels[i][0]);
+			g[i] = float(block.pixels[i][1]);
+			b[i] = float(block.pixels[i][2]);
+		}
+
+		vec3 mean(0.0f);
+		vec3 minimum(255.0f);
+		vec3 maximum(0.0f);
+
+		for (int i = 0; i < 16; i++)
+		{
+			mean += vec3(r[i], g[i], b[i]);
+			minimum = min(minimum, vec3(r[i], g[i], b[i]));
+			maximum = max(maximum, vec3(r[i], g[i], b[i]));
+		}
+
+		mean /= 16.0f;
+
+		vec3 endpoint0 = mean;
+		vec3 endpoint1 = mean;
+
+		if (minimum != maximum)
+		{
+			float covariance[6] = {};
+
+			for (int i = 0; i < 16; i++)
+			{
+				const float dr = r[i] - mean.r;
+				const float dg = g[i] - mean.g;
+				const float db = b[i] - mean.b;
+				covariance[0] += dr * dr;
+				covariance[1] += dr * dg;
+				covariance[2] += dr * db;
+				covariance[3] += dg * dg;
+				covariance[4] += dg * db;
+				covariance[5] += db * db;
+			}
+
+			// power iteration, starting with the diagonal of the bounding box
+			vec3 axis = maximum - minimum;
+
+			for (int iteration = 0; iteration < 4; iteration++)
+			{
+				const vec3 next(
+					covariance[0] * axis.x + covariance[1] * axis.y + covariance[2] * axis.z,
+					covariance[1] * axis.x + covariance[3] * axis.y + covariance[4] * axis.z,
+					covariance[2] * axis.x + covariance[4] * axis.y + covariance[5] * axis.z);
+
+				const float largest = max(abs(next.x), max(abs(next.y), abs(next.z)));
+
+				if (largest <= 0.0f)
+					break;
+
+				axis = next / largest;
+			}
+
+			axis = normalize(axis);
+
+			float projections[16];
+			float lowest = 0.0f;
+			float highest = 0.0f;
+
+			for (int i = 0; i < 16; i++)
+			{
+				projections[i] = (r[i] - mean.r) * axis.r + (g[i] - mean.g) * axis.g + (b[i] - mean.b) * axis.b;
+				lowest = std::min(lowest, projections[i]);
+				highest = std::max(highest, projections[i]);
+			}
+
+			endpoint0 = mean + axis * highest;
+			endpoint1 = mean + axis * lowest;
+
+			// weights of the first endpoint for the palette position closest to each pixel, then the endpoints that fit these best
+			if (highest > lowest)
+			{
+				float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+				vec3 ap(0.0f), bp(0.0f);
+
+				for (int i = 0; i < 16; i++)
+				{
+					const float a = std::round((projections[i] - lowest) / (highest - lowest) * 3.0f) / 3.0f;
+					const float c = 1.0f - a;
+					const vec3 p(r[i], g[i], b[i]);
+					aa += a * a;
+					ab += a * c;
+					bb += c * c;
+					ap += a * p;
+					bp += c * p;
+				}
+
+				const float determinant = aa * bb - ab * ab;
+
+				if (abs(determinant) > 1e-6f)
+				{
+					endpoint0 = (ap * bb - bp * ab) / determinant;
+					endpoint1 = (bp * aa - ap * ab) / determinant;
+				}
+			}
+		}
+
+		std::uint16_t color0 = packColor(endpoint0);
+		std::uint16_t color1 = packColor(endpoint1);
+
+		// the first color has to be larger for the four color mode
+		if (color0 < color1)
+			std::swap(color0, color1);
+
+		std::uint32_t indices = 0;
+
+		if (color0 != color1)
+		{
+			const vec3 c0 = unpackColor(color0);
+			const vec3 c1 = unpackColor(color1);
+			const vec3 palette[4] = { c0, c1, (2.0f * c0 + c1) / 3.0f, (c0 + 2.0f * c1) / 3.0f };
+
+			float bestDistance[16];
+			int bestIndex[16];
+
+			for (int i = 0; i < 16; i++)
+			{
+				bestDistance[i] = 1e30f;
+				bestIndex[i] = 0;
+			}
+
+			for (int p = 0; p < 4; p++)
+			{
+				for (int i = 0; i < 16; i++)
+				{
+					const float dr = r[i] - palette[p].r;
+					const float dg = g[i] - palette[p].g;
+					const float db = b[i] - palette[p].b;
+					const float distance = dr * dr + dg * dg + db * db;
+
+					bestIndex[i] = distance < bestDistance[i] ? p : bestIndex[i];
+					bestDistance[i] = std::min(distance, bestDistance[i]);
+				}
+			}
+
+			for (int i = 0; i < 16; i++)
+				indices |= std::uint32_t(bestIndex[i]) << (2 * i);
+		}
+
+		storeLittleEndian(target, color0, 2);
+		storeLittleEndian(target + 2, color1, 2);
+		storeLittleEndian(target + 4, indices, 4);
+	}
+
+	void encodeBlock(const PixelBlock& block, TextureCompression compression, unsigned char* target)
+	{
+		switch (compression)
+		{
+		case TextureCompression::BC1:
+			encodeColorBlock(block, target);
+			break;
+
+		case TextureCompression::BC3:
+			encodeChannelBlock(block, 3, target);
+			encodeColorBlock(block, target + 8);
+			break;
+
+		case TextureCompression::BC4:
+			encodeChannelBlock(block, 0, target);
+			break;
+
+		case TextureCompression::BC5:
+			encodeChannelBlock(block, 0, target);
+			encodeChannelBlock(block, 1, target + 8);
+			break;
+
+		default:
+			break;
+		}
+	}
+
+	bool isOpaque(const TextureImage& image)
+	{
+		if (image.channels != 4)
+			return true;
+
+		const unsigned char* data = image.levelData(0);
+		const std::size_t pixelCount = image.levelDataSize(0) / 4;
+
+		for (std::size_t i = 0; i < pixelCount; i++)
+			if (data[i * 4 + 3] != 255)
+				return false;
+
+		return true;
+	}
+
+	bool isGrayscale(const TextureImage& image)
+	{
+		if (image.channels < 3)
+			return true;
+
+		const unsigned char* data = image.levelData(0);
+		const std::size_t pixelCount = image.levelDataSize(0) / std::size_t(image.channels);
+
+		for (std::size_t i = 0; i < pixelCount; i++)
+		{
+			const unsigned char* p = data + i * std::size_t(image.channels);
+
+			if (p[0] != p[1] || p[0] != p[2])
+				return false;
+		}
+
+		return true;
+	}
+}
+
+TextureCompression minity::chooseTextureCompression(const TextureImage& image, TextureUsage usage)
+{
+	if (!image.data || image.compression != TextureCompression::None)
+		return image.compression;
+
+	if (usage == TextureUsage::Scalar || image.channels == 1)
+		return TextureCompression::BC4;
+
+	if (image.channels == 2)
+		return TextureCompression::BC5;
+
+	if (usage == TextureUsage::Bump)
+		return isGrayscale(image) ? TextureCompression::BC4 : TextureCompression::BC5;
+
+	return isOpaque(image) ? TextureCompression::BC1 : TextureCompression::BC3;
+}
+
+TextureImage minity::compressTexture(const TextureImage& image, TextureCompression compression, ThreadPool* pool)
+{
+	if (!image.data || image.compression != TextureCompression::None || compression == TextureCompression::None)
+		return image;
+
+	TextureImage result;
+	result.width = image.width;
+	result.height = image.height;
+	result.channels = image.channels;
+	result.compression = compression;
+
+	struct BlockRow
+	{
+		std::size_t level;
+		int y;
+	};
+
+	std::vector<BlockRow> rows;
+	std::size_t total = 0;
+
+	for (std::size_t i = 0; i < image.levelCount(); i++)
+	{
+		result.levelOffsets.push_back(total);
+		total += result.levelDataSize(i);
+
+		for (int y = 0; y < (image.levelSize(i).y + 3) / 4; y++)
+			rows.push_back({ i, y });
+	}
+
+	std::shared_ptr<unsigned char> data(new unsigned char[total], std::default_delete<unsigned char[]>());
+	const std::size_t blockSize = TextureImage::blockSize(compression);
+
+	auto encodeRow = [&](std::size_t index) {
+		const BlockRow& row = rows[index];
+		const int blockCount = (image.levelSize(row.level).x + 3) / 4;
+		unsigned char* target = data.get() + result.levelOffsets[row.level] + std::size_t(row.y) * std::size_t(blockCount) * blockSize;
+		PixelBlock block;
+
+		for (int x = 0; x < blockCount; x++)
+		{
+			fetchBlock(image, row.level, x, row.y, block);
+			encodeBlock(block, compression, target + std::size_t(x) * blockSize);
+		}
+	};
+
+	if (pool)
+	{
+		pool->parallelFor(rows.size(), encodeRow);
+	}
+	else
+	{
+		for (std::size_t i = 0; i < rows.size(); i++)
+			encodeRow(i);
+	}
+
+	result.data = std::move(data);
+
+	return result;
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "TextureImage.h"
+
+namespace minity
+{
+	class ThreadPool;
+
+	// how a material uses a texture, which decides the block compression format
+	enum class TextureUsage
+	{
+		// ambient, diffuse and specular colors
+		Color,
+		// shininess, only the first channel is used
+		Scalar,
+		// height maps or normal maps
+		Bump
+	};
+
+	// BC1 or BC3 for colors depending on alpha, BC4 for single channels and grayscale height maps, BC5 for two channels and normal maps
+	TextureCompression chooseTextureCompression(const TextureImage& image, TextureUsage usage);
+
+	// encodes all levels of an uncompressed image, the block rows are distributed over the pool if one is given
+	TextureImage compressTexture(const TextureImage& image, TextureCompression compression, ThreadPool* pool = nullptr);
+}
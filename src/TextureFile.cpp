@@ -0,0 +1,240 @@
+#include "TextureFile.h"
+
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <cstring>
+
+#include <globjects/globjects.h>
+#include <globjects/logging.h>
+
+using namespace minity;
+using namespace glm;
+
+struct TextureFileHeader
+{
+	char magic[8];
+	std::uint32_t version;
+	std::int32_t width;
+	std::int32_t height;
+	std::int32_t channels;
+	std::uint32_t levelCount;
+	std::uint32_t compression;
+	std::uint64_t sourceSize;
+	std::int64_t sourceTime;
+	std::uint64_t dataOffset;
+	std::uint64_t dataSize;
+};
+
+static const char textureFileMagic[8] = { 'M', 'I', 'N', 'I', 'T', 'Y', 'T', 'C' };
+static const std::uint64_t textureFileAlignment = 64;
+
+static std::uint64_t hashString(const std::string& s)
+{
+	// 64-bit FNV-1a
+	std::uint64_t hash = 14695981039346656037ull;
+
+	for (unsigned char c : s)
+	{
+		hash ^= c;
+		hash *= 1099511628211ull;
+	}
+
+	return hash;
+}
+
+TextureFile::TextureFile(const std::string& filename, const std::string& cacheDirectory, const std::string& variant) : m_filename(filename)
+{
+	const std::string extension = variant.empty() ? ".texcache" : "." + variant + ".texcache";
+
+	if (cacheDirectory.empty())
+	{
+		m_cacheFilename = filename + extension;
+	}
+	else
+	{
+		std::error_code error;
+		std::filesystem::path sourcePath = std::filesystem::weakly_canonical(filename, error);
+
+		if (error)
+			sourcePath = std::filesystem::path(filename);
+
+		// the source path is part of the name, so that files with the same name in different directories do not collide
+		std::stringstream ss;
+		ss << sourcePath.stem().string() << "-" << std::hex << std::setw(16) << std::setfill('0') << hashString(sourcePath.string()) << extension;
+
+		std::filesystem::path cachePath(cacheDirectory);
+		cachePath.append(ss.str());
+		m_cacheFilename = cachePath.string();
+	}
+}
+
+const std::string& TextureFile::filename() const
+{
+	return m_filename;
+}
+
+const std::string& TextureFile::cacheFilename() const
+{
+	return m_cacheFilename;
+}
+
+bool TextureFile::read()
+{
+	close();
+
+	std::uint64_t sourceSize = 0;
+	std::int64_t sourceTime = 0;
+
+	if (!sourceStatus(sourceSize, sourceTime))
+		return false;
+
+	auto file = std::make_shared<MappedFile>();
+
+	if (!file->open(m_cacheFilename) || file->size() < sizeof(TextureFileHeader))
+		return false;
+
+	TextureFileHeader header;
+	std::memcpy(&header, file->data(), sizeof(header));
+
+	if (std::memcmp(header.magic, textureFileMagic, sizeof(textureFileMagic)) != 0 || header.version != version)
+	{
+		globjects::debug() << "Ignoring outdated texture cache file " << m_cacheFilename;
+		return false;
+	}
+
+	if (header.sourceSize != sourceSize || header.sourceTime != sourceTime)
+	{
+		globjects::debug() << "Ignoring texture cache file " << m_cacheFilename << ", since " << m_filename << " has changed";
+		return false;
+	}
+
+	TextureImage image;
+	image.width = header.width;
+	image.height = header.height;
+	image.channels = header.channels;
+	image.compression = TextureCompression(header.compression);
+
+	const bool validSize = image.width > 0 && image.height > 0 && image.channels >= 1 && image.channels <= 4 && header.compression <= std::uint32_t(TextureCompression::BC5);
+	std::uint64_t dataSize = 0;
+
+	if (validSize && header.levelCount == TextureImage::mipmapLevelCount(image.width, image.height))
+	{
+		for (std::size_t i = 0; i < header.levelCount; i++)
+		{
+			image.levelOffsets.push_back(std::size_t(dataSize));
+			dataSize += image.levelDataSize(i);
+		}
+	}
+
+	if (image.levelOffsets.empty() || header.dataSize != dataSize || header.dataOffset > file->size() || header.dataSize > file->size() - header.dataOffset)
+	{
+		globjects::debug() << "Ignoring corrupted texture cache file " << m_cacheFilename;
+		return false;
+	}
+
+	// the image shares ownership of the mapping, so that the levels can be uploaded after this object is gone
+	image.data = std::shared_ptr<const unsigned char>(file, reinterpret_cast<const unsigned char*>(file->data() + header.dataOffset));
+
+	m_file = std::move(file);
+	m_image = std::move(image);
+
+	return true;
+}
+
+bool TextureFile::write(const TextureImage& image)
+{
+	close();
+
+	std::uint64_t sourceSize = 0;
+	std::int64_t sourceTime = 0;
+
+	if (!image.data || !sourceStatus(sourceSize, sourceTime))
+		return false;
+
+	TextureFileHeader header;
+	std::memset(&header, 0, sizeof(header));
+	std::memcpy(header.magic, textureFileMagic, sizeof(textureFileMagic));
+	header.version = version;
+	header.width = image.width;
+	header.height = image.height;
+	header.channels = image.channels;
+	header.levelCount = std::uint32_t(image.levelCount());
+	header.compression = std::uint32_t(image.compression);
+	header.sourceSize = sourceSize;
+	header.sourceTime = sourceTime;
+	header.dataOffset = (sizeof(header) + textureFileAlignment - 1) / textureFileAlignment * textureFileAlignment;
+	header.dataSize = image.size();
+
+	std::error_code error;
+	std::filesystem::path cachePath(m_cacheFilename);
+
+	if (cachePath.has_parent_path())
+		std::filesystem::create_directories(cachePath.parent_path(), error);
+
+	// written to a temporary file first, several threads or processes may write the same texture at once
+	std::stringstream ss;
+	ss << m_cacheFilename << "." << std::hex << reinterpret_cast<std::uintptr_t>(this) << ".tmp";
+	const std::string temporaryFilename = ss.str();
+
+	{
+		std::ofstream os(temporaryFilename, std::ios::binary | std::ios::trunc);
+
+		if (!os.is_open())
+			return false;
+
+		const std::string padding(std::size_t(header.dataOffset - sizeof(header)), '\0');
+		os.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		os.write(padding.data(), std::streamsize(padding.size()));
+
+		for (std::size_t i = 0; i < image.levelCount(); i++)
+			os.write(reinterpret_cast<const char*>(image.levelData(i)), std::streamsize(image.levelDataSize(i)));
+
+		if (!os.good())
+		{
+			os.close();
+			std::filesystem::remove(temporaryFilename, error);
+			return false;
+		}
+	}
+
+	std::filesystem::rename(temporaryFilename, m_cacheFilename, error);
+
+	if (error)
+	{
+		std::filesystem::remove(m_cacheFilename, error);
+		std::filesystem::rename(temporaryFilename, m_cacheFilename, error);
+	}
+
+	if (error)
+	{
+		std::filesystem::remove(temporaryFilename, error);
+		return false;
+	}
+
+	return true;
+}
+
+void TextureFile::close()
+{
+	m_file.reset();
+	m_image = TextureImage();
+}
+
+TextureImage TextureFile::image() const
+{
+	return m_image;
+}
+
+bool TextureFile::sourceStatus(std::uint64_t& size, std::int64_t& time) const
+{
+	std::error_code error;
+	size = std::filesystem::file_size(m_filename, error);
+
+	if (error)
+		return false;
+
+	time = std::int64_t(std::filesystem::last_write_time(m_filename, error).time_since_epoch().count());
+	return !error;
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <string>
+#include <memory>
+#include <cstdint>
+
+#include "MappedFile.h"
+#include "TextureImage.h"
+
+namespace minity
+{
+	// binary cache of a decoded texture with its complete mip chain, stored next to the image file or in a cache directory
+	class TextureFile
+	{
+	public:
+		// has to be increased whenever the file layout, the filtering of the mip levels or the block encoder changes
+		static constexpr std::uint32_t version = 2;
+
+		// the variant is part of the cache file name, so that differently encoded versions of one image can be cached side by side
+		TextureFile(const std::string& filename, const std::string& cacheDirectory = std::string(), const std::string& variant = std::string());
+
+		const std::string& filename() const;
+		const std::string& cacheFilename() const;
+
+		// maps the cache file and checks whether it is valid for the current image file
+		bool read();
+		bool write(const TextureImage& image);
+		void close();
+
+		// levels point into the mapped cache file, which stays mapped as long as the returned image data is referenced
+		TextureImage image() const;
+
+	private:
+		bool sourceStatus(std::uint64_t& size, std::int64_t& time) const;
+
+		std::string m_filename;
+		std::string m_cacheFilename;
+
+		std::shared_ptr<MappedFile> m_file;
+		TextureImage m_image;
+	};
+}
@@ -0,0 +1,322 @@
+#include "TextureImage.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+#include <glbinding/gl/gl.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TEXTURE_IMAGE_SSE2
+#include <emmintrin.h>
+#endif
+
+using namespace minity;
+using namespace gl;
+using namespace glm;
+using namespace globjects;
+
+// adds two rows of bytes into 16-bit sums, which is the vertical half of the 2x2 box filter
+static void sumRows(const unsigned char* first, const unsigned char* second, std::uint16_t* sums, std::size_t count)
+{
+	std::size_t i = 0;
+
+#ifdef TEXTURE_IMAGE_SSE2
+	const __m128i zero = _mm_setzero_si128();
+
+	for (; i + 16 <= count; i += 16)
+	{
+		const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(first + i));
+		const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(second + i));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(sums + i), _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero)));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(sums + i + 8), _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero)));
+	}
+#endif
+
+	for (; i < count; i++)
+		sums[i] = std::uint16_t(first[i] + second[i]);
+}
+
+// adds horizontally neighboring pixels of the row sums and stores the rounded mean of each 2x2 block
+template <int Channels>
+static void averageColumns(const std::uint16_t* sums, unsigned char* target, int sourceWidth, int targetWidth)
+{
+	int x = 0;
+
+#ifdef TEXTURE_IMAGE_SSE2
+	if constexpr (Channels == 4)
+	{
+		// each register holds two source pixels, four target pixels are written at once
+		const __m128i rounding = _mm_set1_epi16(2);
+
+		for (; x + 4 <= targetWidth && 2 * (x + 4) <= sourceWidth; x += 4)
+		{
+			const std::uint16_t* s = sums + std::size_t(x) * 8;
+			__m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s));
+			__m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + 8));
+			__m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + 16));
+			__m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + 24));
+
+			a = _mm_add_epi16(a, _mm_srli_si128(a, 8));
+			b = _mm_add_epi16(b, _mm_srli_si128(b, 8));
+			c = _mm_add_epi16(c, _mm_srli_si128(c, 8));
+			d = _mm_add_epi16(d, _mm_srli_si128(d, 8));
+
+			const __m128i low = _mm_srli_epi16(_mm_add_epi16(_mm_unpacklo_epi64(a, b), rounding), 2);
+			const __m128i high = _mm_srli_epi16(_mm_add_epi16(_mm_unpacklo_epi64(c, d), rounding), 2);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(target + std::size_t(x) * 4), _mm_packus_epi16(low, high));
+		}
+	}
+#endif
+
+	// remaining pixels, a single column is averaged with itself
+	for (; x < targetWidth; x++)
+	{
+		const std::size_t first = std::size_t(2 * x) * Channels;
+		const std::size_t second = std::size_t(std::min(2 * x + 1, sourceWidth - 1)) * Channels;
+
+		for (int c = 0; c < Channels; c++)
+			target[std::size_t(x) * Channels + c] = static_cast<unsigned char>((sums[first + c] + sums[second + c] + 2) >> 2);
+	}
+}
+
+static void averageColumns(const std::uint16_t* sums, unsigned char* target, int sourceWidth, int targetWidth, int channels)
+{
+	switch (channels)
+	{
+	case 1:
+		averageColumns<1>(sums, target, sourceWidth, targetWidth);
+		break;
+
+	case 2:
+		averageColumns<2>(sums, target, sourceWidth, targetWidth);
+		break;
+
+	case 3:
+		averageColumns<3>(sums, target, sourceWidth, targetWidth);
+		break;
+
+	case 4:
+		averageColumns<4>(sums, target, sourceWidth, targetWidth);
+		break;
+	}
+}
+
+std::size_t TextureImage::size() const
+{
+	std::size_t total = 0;
+
+	for (std::size_t i = 0; i < levelCount(); i++)
+		total += levelDataSize(i);
+
+	return total;
+}
+
+std::size_t TextureImage::uncompressedSize() const
+{
+	std::size_t total = 0;
+
+	for (std::size_t i = 0; i < levelCount(); i++)
+	{
+		const ivec2 size = levelSize(i);
+		total += std::size_t(size.x) * std::size_t(size.y) * std::size_t(channels);
+	}
+
+	return total;
+}
+
+std::size_t TextureImage::levelCount() const
+{
+	return data ? levelOffsets.size() : 0;
+}
+
+ivec2 TextureImage::levelSize(std::size_t level) const
+{
+	return ivec2(std::max(1, width >> level), std::max(1, height >> level));
+}
+
+std::size_t TextureImage::levelDataSize(std::size_t level) const
+{
+	const ivec2 size = levelSize(level);
+
+	if (compression != TextureCompression::None)
+		return std::size_t((size.x + 3) / 4) * std::size_t((size.y + 3) / 4) * blockSize(compression);
+
+	return std::size_t(size.x) * std::size_t(size.y) * std::size_t(channels);
+}
+
+const unsigned char* TextureImage::levelData(std::size_t level) const
+{
+	return data.get() + levelOffsets[level];
+}
+
+std::unique_ptr<Texture> TextureImage::createTexture(std::size_t baseLevel) const
+{
+	if (!data)
+		return std::unique_ptr<Texture>();
+
+	auto texture = Texture::create(GL_TEXTURE_2D);
+	texture->setParameter(GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	texture->setParameter(GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	texture->setParameter(GL_TEXTURE_WRAP_S, GL_REPEAT);
+	texture->setParameter(GL_TEXTURE_WRAP_T, GL_REPEAT);
+
+	if (levelCount() == 1)
+	{
+		uploadLevel(*texture, 0, levelData(0));
+		texture->generateMipmap();
+		return texture;
+	}
+
+	// levels are specified from coarse to fine, the ones below the base level are left empty
+	baseLevel = std::min(baseLevel, levelCount() - 1);
+	texture->setParameter(GL_TEXTURE_MAX_LEVEL, GLint(levelCount() - 1));
+
+	for (std::size_t i = levelCount(); i-- > baseLevel;)
+		uploadLevel(*texture, i, levelData(i));
+
+	return texture;
+}
+
+void TextureImage::uploadLevel(Texture& texture, std::size_t level, const unsigned char* data) const
+{
+	const ivec2 size = levelSize(level);
+
+	if (compression != TextureCompression::None)
+	{
+		GLenum format = GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+
+		switch (compression)
+		{
+		case TextureCompression::BC3:
+			format = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+			break;
+
+		case TextureCompression::BC4:
+			format = GL_COMPRESSED_RED_RGTC1;
+			break;
+
+		case TextureCompression::BC5:
+			format = GL_COMPRESSED_RG_RGTC2;
+			break;
+
+		default:
+			break;
+		}
+
+		texture.compressedImage2D(GLint(level), format, size, 0, GLsizei(levelDataSize(level)), data);
+	}
+	else
+	{
+		GLenum format = GL_RGBA;
+
+		switch (channels)
+		{
+		case 1:
+			format = GL_RED;
+			break;
+
+		case 2:
+			format = GL_RG;
+			break;
+
+		case 3:
+			format = GL_RGB;
+			break;
+
+		case 4:
+			format = GL_RGBA;
+			break;
+		}
+
+		// rows of the smaller levels are not padded to four bytes
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		texture.image2D(GLint(level), format, size, 0, format, GL_UNSIGNED_BYTE, data);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	}
+
+	if (levelCount() > 1)
+		texture.setParameter(GL_TEXTURE_BASE_LEVEL, GLint(level));
+}
+
+void TextureImage::releaseLevel(Texture& texture, std::size_t level) const
+{
+	if (level + 1 >= levelCount())
+		return;
+
+	texture.setParameter(GL_TEXTURE_BASE_LEVEL, GLint(level + 1));
+
+	// an empty image releases the memory of the level, its format does not matter since levels below the base level are ignored
+	texture.image2D(GLint(level), GL_RGBA, ivec2(0), 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+}
+
+void TextureImage::generateMipmaps()
+{
+	if (levelCount() != 1 || compression != TextureCompression::None || channels < 1 || channels > 4)
+		return;
+
+	const std::size_t count = mipmapLevelCount(width, height);
+	std::vector<std::size_t> offsets(count);
+	std::size_t total = 0;
+
+	for (std::size_t i = 0; i < count; i++)
+	{
+		offsets[i] = total;
+		total += levelDataSize(i);
+	}
+
+	std::shared_ptr<unsigned char> levels(new unsigned char[total], std::default_delete<unsigned char[]>());
+	std::memcpy(levels.get(), levelData(0), levelDataSize(0));
+
+	std::vector<std::uint16_t> sums(std::size_t(width) * std::size_t(channels));
+
+	for (std::size_t i = 1; i < count; i++)
+	{
+		const ivec2 sourceSize = levelSize(i - 1);
+		const ivec2 targetSize = levelSize(i);
+		const std::size_t sourceRowSize = std::size_t(sourceSize.x) * std::size_t(channels);
+		const std::size_t targetRowSize = std::size_t(targetSize.x) * std::size_t(channels);
+		const unsigned char* source = levels.get() + offsets[i - 1];
+		unsigned char* target = levels.get() + offsets[i];
+
+		// odd sizes drop the last row or column, a single row is averaged with itself
+		for (int y = 0; y < targetSize.y; y++)
+		{
+			const unsigned char* first = source + std::size_t(2 * y) * sourceRowSize;
+			const unsigned char* second = source + std::size_t(std::min(2 * y + 1, sourceSize.y - 1)) * sourceRowSize;
+
+			sumRows(first, second, sums.data(), sourceRowSize);
+			averageColumns(sums.data(), target + std::size_t(y) * targetRowSize, sourceSize.x, targetSize.x, channels);
+		}
+	}
+
+	levelOffsets = std::move(offsets);
+	data = std::move(levels);
+}
+
+std::size_t TextureImage::mipmapLevelCount(int width, int height)
+{
+	std::size_t count = 1;
+
+	for (int size = std::max(width, height); size > 1; size >>= 1)
+		count++;
+
+	return count;
+}
+
+std::size_t TextureImage::blockSize(TextureCompression compression)
+{
+	switch (compression)
+	{
+	case TextureCompression::BC1:
+	case TextureCompression::BC4:
+		return 8;
+
+	case TextureCompression::BC3:
+	case TextureCompression::BC5:
+		return 16;
+
+	default:
+		return 0;
+	}
+}
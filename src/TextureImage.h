@@ -0,0 +1,68 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <globjects/Texture.h>
+
+#include <memory>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+namespace minity
+{
+	// block compression formats, each block stores 4x4 pixels
+	enum class TextureCompression : std::uint32_t
+	{
+		None,
+		// rgb with 8 bytes per block
+		BC1,
+		// rgba with 16 bytes per block
+		BC3,
+		// single channel with 8 bytes per block
+		BC4,
+		// two channels with 16 bytes per block
+		BC5
+	};
+
+	// image data of a texture with the first row at the bottom, which can be created on any thread and uploaded later
+	struct TextureImage
+	{
+		int width = 0;
+		int height = 0;
+		// channels of the source image, also for compressed images
+		int channels = 0;
+		TextureCompression compression = TextureCompression::None;
+
+		// offsets of the mip levels into the data, starting with the full resolution
+		std::vector<std::size_t> levelOffsets;
+
+		// either owned by the image or pointing into a mapped cache file, which is kept open as long as the data is used
+		std::shared_ptr<const unsigned char> data;
+
+		std::size_t size() const;
+		std::size_t levelCount() const;
+		glm::ivec2 levelSize(std::size_t level) const;
+		std::size_t levelDataSize(std::size_t level) const;
+		const unsigned char* levelData(std::size_t level) const;
+
+		// size of the same image without block compression
+		std::size_t uncompressedSize() const;
+
+		// creates a texture with the levels starting at the base level, the finer levels can be added later with uploadLevel()
+		// has to be called on the thread owning the OpenGL context, like the other texture functions
+		std::unique_ptr<globjects::Texture> createTexture(std::size_t baseLevel = 0) const;
+		// specifies a level from the given data, which has the layout of levelData(level), and makes it the finest level used
+		void uploadLevel(globjects::Texture& texture, std::size_t level, const unsigned char* data) const;
+		// frees a level and makes the next coarser level the finest level used
+		void releaseLevel(globjects::Texture& texture, std::size_t level) const;
+
+		// replaces the data with the full resolution followed by a complete chain of box-filtered mip levels down to 1x1
+		void generateMipmaps();
+
+		// number of levels of a complete mip chain for the given size
+		static std::size_t mipmapLevelCount(int width, int height);
+
+		// size of a 4x4 block in bytes, zero for uncompressed images
+		static std::size_t blockSize(TextureCompression compression);
+	};
+}
@@ -0,0 +1,314 @@
+#include "TextureStreamer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+using namespace minity;
+using namespace glm;
+using namespace globjects;
+
+namespace
+{
+	std::size_t residentSize(const TextureImage& image, std::size_t baseLevel)
+	{
+		std::size_t size = 0;
+
+		for (std::size_t i = baseLevel; i < image.levelCount(); i++)
+			size += image.levelDataSize(i);
+
+		return size;
+	}
+}
+
+TextureStreamer::TextureStreamer(std::size_t budget) : m_budget(budget)
+{
+	m_thread = std::thread(&TextureStreamer::work, this);
+}
+
+TextureStreamer::~TextureStreamer()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stopping = true;
+	}
+
+	m_requestAdded.notify_all();
+	m_thread.join();
+}
+
+std::size_t TextureStreamer::budget() const
+{
+	return m_budget;
+}
+
+void TextureStreamer::setBudget(std::size_t budget)
+{
+	m_budget = budget;
+}
+
+std::size_t TextureStreamer::tailLevel(const TextureImage& image)
+{
+	for (std::size_t i = 0; i < image.levelCount(); i++)
+	{
+		const ivec2 size = image.levelSize(i);
+
+		if (size.x <= tailSize && size.y <= tailSize)
+			return i;
+	}
+
+	return image.levelCount() > 0 ? image.levelCount() - 1 : 0;
+}
+
+void TextureStreamer::add(const std::shared_ptr<Texture>& texture, const TextureImage& image)
+{
+	if (!texture || image.levelCount() == 0)
+		return;
+
+	auto entry = std::make_shared<Entry>();
+	entry->texture = texture;
+	entry->image = image;
+	entry->tailLevel = tailLevel(image);
+	entry->baseLevel = entry->tailLevel;
+	entry->requestedLevel = entry->tailLevel;
+	entry->visibleLevel = entry->tailLevel;
+
+	// a texture that has been released may have had the same address
+	auto i = m_entries.find(texture.get());
+
+	if (i != m_entries.end())
+		m_residentBytes -= residentSize(i->second->image, i->second->baseLevel);
+
+	m_residentBytes += residentSize(image, entry->baseLevel);
+	m_entries[texture.get()] = entry;
+}
+
+void TextureStreamer::request(const Texture* texture, float texCoordsPerPixel)
+{
+	auto i = m_entries.find(texture);
+
+	if (i == m_entries.end())
+		return;
+
+	Entry& entry = *i->second;
+	entry.lastUsed = m_frame;
+
+	// each level halves the number of texels per pixel, the level with at most one texel per pixel is sufficient
+	const ivec2 size = entry.image.levelSize(0);
+	const float texelsPerPixel = texCoordsPerPixel * float(std::max(size.x, size.y));
+	const std::size_t level = texelsPerPixel > 1.0f ? std::size_t(std::floor(std::log2(texelsPerPixel))) : 0;
+
+	entry.requestedLevel = std::min(entry.requestedLevel, level);
+}
+
+void TextureStreamer::update()
+{
+	// time spent on uploads per frame, so that the frame rate stays interactive while streaming
+	static constexpr std::chrono::milliseconds uploadBudget(4);
+
+	std::vector<std::shared_ptr<Entry>> requested;
+
+	for (auto i = m_entries.begin(); i != m_entries.end();)
+	{
+		Entry& entry = *i->second;
+
+		if (entry.texture.expired())
+		{
+			m_residentBytes -= residentSize(entry.image, entry.baseLevel);
+			i = m_entries.erase(i);
+			continue;
+		}
+
+		if (entry.lastUsed == m_frame)
+		{
+			entry.visibleLevel = entry.requestedLevel;
+
+			if (!entry.pending && entry.requestedLevel < entry.baseLevel)
+				requested.push_back(i->second);
+		}
+		else
+		{
+			entry.visibleLevel = entry.tailLevel;
+		}
+
+		entry.requestedLevel = entry.tailLevel;
+		i++;
+	}
+
+	// levels that could not be uploaded are not read, until other textures are used less or the budget grows
+	requested.erase(std::remove_if(requested.begin(), requested.end(), [this](const std::shared_ptr<Entry>& e) {
+		return !fitsBudget(*e, e->baseLevel - 1);
+	}), requested.end());
+
+	// textures lacking the most levels are streamed first, each one level at a time
+	std::sort(requested.begin(), requested.end(), [](const std::shared_ptr<Entry>& a, const std::shared_ptr<Entry>& b) {
+		return a->baseLevel - a->visibleLevel > b->baseLevel - b->visibleLevel;
+	});
+
+	if (!requested.empty())
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+
+			for (auto& e : requested)
+			{
+				e->pending = true;
+				m_requests.push_back({ e, e->baseLevel - 1, {} });
+			}
+		}
+
+		m_requestAdded.notify_one();
+	}
+
+	const auto updateStart = std::chrono::steady_clock::now();
+
+	while (std::chrono::steady_clock::now() - updateStart < uploadBudget)
+	{
+		Level level;
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+
+			if (m_levels.empty())
+				break;
+
+			level = std::move(m_levels.front());
+			m_levels.pop_front();
+		}
+
+		level.entry->pending = false;
+		upload(level);
+	}
+
+	m_frame++;
+}
+
+TextureStreamer::Statistics TextureStreamer::statistics() const
+{
+	Statistics statistics;
+	statistics.textureCount = m_entries.size();
+	statistics.residentBytes = m_residentBytes;
+	statistics.uploadedLevels = m_uploadedLevels;
+	statistics.releasedLevels = m_releasedLevels;
+
+	for (const auto& e : m_entries)
+		statistics.totalBytes += e.second->image.size();
+
+	return statistics;
+}
+
+void TextureStreamer::work()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	while (true)
+	{
+		m_requestAdded.wait(lock, [this]() { return m_stopping || !m_requests.empty(); });
+
+		if (m_stopping)
+			return;
+
+		Level level = std::move(m_requests.front());
+		m_requests.pop_front();
+		lock.unlock();
+
+		// reading the level here pages mapped cache files in on this thread instead of during the upload
+		const TextureImage& image = level.entry->image;
+		const unsigned char* data = image.levelData(level.level);
+		level.data.assign(data, data + image.levelDataSize(level.level));
+
+		lock.lock();
+		m_levels.push_back(std::move(level));
+	}
+}
+
+bool TextureStreamer::upload(Level& level)
+{
+	Entry& entry = *level.entry;
+	std::shared_ptr<Texture> texture = entry.texture.lock();
+	auto i = m_entries.find(texture.get());
+
+	// the texture may have been released or have changed its levels in the meantime
+	if (!texture || i == m_entries.end() || i->second != level.entry || level.level + 1 != entry.baseLevel)
+		return false;
+
+	const std::size_t size = entry.image.levelDataSize(level.level);
+
+	while (m_residentBytes + size > m_budget)
+	{
+		if (!releaseLeastRecentlyUsed(entry))
+			return false;
+	}
+
+	entry.image.uploadLevel(*texture, level.level, level.data.data());
+	entry.baseLevel = level.level;
+	m_residentBytes += size;
+	m_uploadedLevels++;
+
+	return true;
+}
+
+// whether the level fits into the budget once the levels that upload() is allowed to release for it are released
+bool TextureStreamer::fitsBudget(const Entry& entry, std::size_t level) const
+{
+	const std::size_t size = entry.image.levelDataSize(level);
+
+	if (m_residentBytes + size <= m_budget)
+		return true;
+
+	std::size_t releasableBytes = 0;
+
+	for (const auto& e : m_entries)
+	{
+		const Entry& other = *e.second;
+
+		if (&other == &entry)
+			continue;
+
+		// the same levels releaseLeastRecentlyUsed() takes one after the other
+		const std::size_t end = other.lastUsed < entry.lastUsed ? other.tailLevel : std::min(other.visibleLevel, other.tailLevel);
+
+		for (std::size_t i = other.baseLevel; i < end; i++)
+			releasableBytes += other.image.levelDataSize(i);
+	}
+
+	return m_residentBytes + size <= m_budget + releasableBytes;
+}
+
+bool TextureStreamer::releaseLeastRecentlyUsed(const Entry& entry)
+{
+	// levels finer than what was visible in the last frame go first, then those of textures used less recently than this one
+	Entry* candidate = nullptr;
+	bool candidateUnneeded = false;
+
+	for (auto& e : m_entries)
+	{
+		Entry& other = *e.second;
+
+		if (&other == &entry || other.baseLevel >= other.tailLevel)
+			continue;
+
+		const bool unneeded = other.baseLevel < other.visibleLevel;
+
+		if (!unneeded && other.lastUsed >= entry.lastUsed)
+			continue;
+
+		if (!candidate || (unneeded && !candidateUnneeded) || (unneeded == candidateUnneeded && other.lastUsed < candidate->lastUsed))
+		{
+			candidate = &other;
+			candidateUnneeded = unneeded;
+		}
+	}
+
+	if (!candidate)
+		return false;
+
+	if (std::shared_ptr<Texture> texture = candidate->texture.lock())
+		candidate->image.releaseLevel(*texture, candidate->baseLevel);
+
+	m_residentBytes -= candidate->image.levelDataSize(candidate->baseLevel);
+	candidate->baseLevel++;
+	m_releasedLevels++;
+
+	return true;
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <globjects/Texture.h>
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "TextureImage.h"
+
+namespace minity
+{
+	// keeps only the coarse levels of textures resident and streams the finer ones in as far as they are visible on screen
+	// levels of textures that have not been used for the longest time are released when the memory budget is reached
+	class TextureStreamer
+	{
+	public:
+		struct Statistics
+		{
+			std::size_t textureCount = 0;
+			std::size_t residentBytes = 0;
+			// memory of all levels of all textures
+			std::size_t totalBytes = 0;
+			std::size_t uploadedLevels = 0;
+			std::size_t releasedLevels = 0;
+		};
+
+		// levels up to this size are always resident
+		static constexpr int tailSize = 64;
+
+		TextureStreamer(std::size_t budget = 1024 * 1024 * 1024);
+		~TextureStreamer();
+
+		TextureStreamer(const TextureStreamer&) = delete;
+		TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+		std::size_t budget() const;
+		void setBudget(std::size_t budget);
+
+		// first level of an image that is created at once, which is the first one not larger than the tail size
+		static std::size_t tailLevel(const TextureImage& image);
+
+		// registers a texture created with the tail level of the image as its base level, the image data is kept for streaming
+		void add(const std::shared_ptr<globjects::Texture>& texture, const TextureImage& image);
+
+		// requests the level that is needed for the given number of texture coordinate units per pixel on screen
+		// has to be called for every frame in which the texture is used
+		void request(const globjects::Texture* texture, float texCoordsPerPixel);
+
+		// hands out requests to the streaming thread and uploads the levels it has prepared, has to be called once per frame
+		// on the thread owning the OpenGL context
+		void update();
+
+		Statistics statistics() const;
+
+	private:
+		struct Entry
+		{
+			std::weak_ptr<globjects::Texture> texture;
+			TextureImage image;
+			std::size_t tailLevel = 0;
+			// finest resident level
+			std::size_t baseLevel = 0;
+			// finest level requested in the current frame and in the last frame in which the texture was used
+			std::size_t requestedLevel = 0;
+			std::size_t visibleLevel = 0;
+			std::uint64_t lastUsed = 0;
+			bool pending = false;
+		};
+
+		// level data read by the streaming thread, so that uploads do not wait for the file system
+		struct Level
+		{
+			std::shared_ptr<Entry> entry;
+			std::size_t level = 0;
+			std::vector<unsigned char> data;
+		};
+
+		void work();
+		bool upload(Level& level);
+		bool fitsBudget(const Entry& entry, std::size_t level) const;
+		bool releaseLeastRecentlyUsed(const Entry& entry);
+
+		std::unordered_map<const globjects::Texture*, std::shared_ptr<Entry>> m_entries;
+		std::size_t m_budget;
+		std::size_t m_residentBytes = 0;
+		std::size_t m_uploadedLevels = 0;
+		std::size_t m_releasedLevels = 0;
+		std::uint64_t m_frame = 1;
+
+		std::thread m_thread;
+		bool m_stopping = false;
+
+		// protects the queues shared with the streaming thread
+		std::mutex m_mutex;
+		std::condition_variable m_requestAdded;
+		std::deque<Level> m_requests;
+		std::deque<Level> m_levels;
+	};
+}
@@ -0,0 +1,130 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+using namespace minity;
+
+ThreadPool::ThreadPool(unsigned int threadCount)
+{
+	if (threadCount == 0)
+		threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+	m_threads.reserve(threadCount);
+
+	for (unsigned int i = 0; i < threadCount; i++)
+		m_threads.emplace_back(&ThreadPool::work, this);
+}
+
+ThreadPool::~ThreadPool()
+{
+	wait();
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stopping = true;
+	}
+
+	m_taskAdded.notify_all();
+
+	for (auto& t : m_threads)
+		t.join();
+}
+
+void ThreadPool::add(std::function<void()> task)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_tasks.push_back(std::move(task));
+	}
+
+	m_taskAdded.notify_one();
+}
+
+void ThreadPool::wait()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_tasksFinished.wait(lock, [this]() { return m_tasks.empty() && m_activeTaskCount == 0; });
+}
+
+void ThreadPool::parallelFor(std::size_t count, const std::function<void(std::size_t)>& function)
+{
+	if (count == 0)
+		return;
+
+	// helpers that start after all indices have been taken return without touching the function
+	struct State
+	{
+		const std::function<void(std::size_t)>* function = nullptr;
+		std::size_t count = 0;
+		std::atomic<std::size_t> next = 0;
+		std::size_t finished = 0;
+		std::mutex mutex;
+		std::condition_variable done;
+	};
+
+	auto state = std::make_shared<State>();
+	state->function = &function;
+	state->count = count;
+
+	auto process = [](State& s) {
+		std::size_t processed = 0;
+
+		for (std::size_t i = s.next++; i < s.count; i = s.next++)
+		{
+			(*s.function)(i);
+			processed++;
+		}
+
+		if (processed > 0)
+		{
+			std::lock_guard<std::mutex> lock(s.mutex);
+			s.finished += processed;
+
+			if (s.finished == s.count)
+				s.done.notify_all();
+		}
+	};
+
+	const std::size_t helperCount = std::min(count - 1, m_threads.size());
+
+	for (std::size_t i = 0; i < helperCount; i++)
+		add([state, process]() { process(*state); });
+
+	process(*state);
+
+	std::unique_lock<std::mutex> lock(state->mutex);
+	state->done.wait(lock, [&]() { return state->finished == state->count; });
+}
+
+unsigned int ThreadPool::threadCount() const
+{
+	return static_cast<unsigned int>(m_threads.size());
+}
+
+void ThreadPool::work()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	while (true)
+	{
+		m_taskAdded.wait(lock, [this]() { return m_stopping || !m_tasks.empty(); });
+
+		if (m_tasks.empty())
+			return;
+
+		std::function<void()> task = std::move(m_tasks.front());
+		m_tasks.pop_front();
+		m_activeTaskCount++;
+
+		lock.unlock();
+		task();
+		lock.lock();
+
+		m_activeTaskCount--;
+
+		if (m_tasks.empty() && m_activeTaskCount == 0)
+			m_tasksFinished.notify_all();
+	}
+}
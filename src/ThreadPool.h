@@ -0,0 +1,46 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace minity
+{
+	// fixed set of worker threads that process tasks in the order in which they were added
+	class ThreadPool
+	{
+	public:
+		// zero threads uses all hardware threads
+		ThreadPool(unsigned int threadCount = 0);
+		~ThreadPool();
+
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool& operator=(const ThreadPool&) = delete;
+
+		void add(std::function<void()> task);
+
+		// blocks until all tasks added so far have been processed
+		void wait();
+
+		// calls the function for every index in [0, count) on the pool and returns when all calls are done
+		// the calling thread processes indices as well, so this can also be used from within a task of the same pool
+		void parallelFor(std::size_t count, const std::function<void(std::size_t)>& function);
+
+		unsigned int threadCount() const;
+
+	private:
+		void work();
+
+		std::vector<std::thread> m_threads;
+		std::deque<std::function<void()>> m_tasks;
+		std::size_t m_activeTaskCount = 0;
+		bool m_stopping = false;
+
+		std::mutex m_mutex;
+		std::condition_variable m_taskAdded;
+		std::condition_variable m_tasksFinished;
+	};
+}
@@ -12,13 +12,16 @@
 
 #define GLM_ENABLE_EXPERIMENTAL
 #include <glm/gtx/matrix_decompose.hpp>
+#include <glm/gtx/transform.hpp>
 
 #include "CameraInteractor.h"
+#include "GBuffer.h"
 #include "BoundingBoxRenderer.h"
 #include "ModelRenderer.h"
 #include "RaytraceRenderer.h"
 #include "Scene.h"
 #include "Model.h"
+#include "TextureStreamer.h"
 #include <fstream>
 #include <sstream>
 #include <list>
@@ -36,7 +39,7 @@ using namespace globjects;
 #include <imgui_impl_opengl3.h>
 #include <imgui_impl_glfw.h>
 
-Viewer::Viewer(GLFWwindow *window, Scene *scene) : m_window(window), m_scene(scene)
+Viewer::Viewer(GLFWwindow *window, Scene *scene) : m_window(window), m_scene(scene), m_gBuffer(std::make_unique<GBuffer>())
 {
 	ImGui::CreateContext();
 	ImGuiIO& io = ImGui::GetIO();
@@ -77,6 +80,13 @@ Viewer::~Viewer()
 
 void Viewer::display()
 {
+	// geometry of a model that is still loading arrives in parts
+	if (m_scene->model()->update())
+		fitModelTransform();
+
+	// texture levels requested while rendering the last frame
+	m_scene->textureStreamer()->update();
+
 	beginFrame();
 	mainMenu();
 
@@ -110,6 +120,11 @@ Scene* Viewer::scene()
 	return m_scene;
 }
 
+GBuffer* Viewer::gBuffer()
+{
+	return m_gBuffer.get();
+}
+
 ivec2 Viewer::viewportSize() const
 {
 	int width, height;
@@ -132,6 +147,20 @@ mat4 Viewer::viewTransform() const
 	return m_viewTransform;
 }
 
+void Viewer::fitModelTransform()
+{
+	// scaling the model's bounding box to the canonical view volume
+	vec3 boundingBoxSize = m_scene->model()->maximumBounds() - m_scene->model()->minimumBounds();
+	float maximumSize = std::max(std::max(boundingBoxSize.x, boundingBoxSize.y), boundingBoxSize.z);
+
+	if (maximumSize <= 0.0f)
+		return;
+
+	mat4 modelTransform = scale(vec3(2.0f) / vec3(maximumSize));
+	modelTransform = modelTransform * translate(-0.5f*(m_scene->model()->minimumBounds() + m_scene->model()->maximumBounds()));
+	setModelTransform(modelTransform);
+}
+
 void Viewer::setModelTransform(const glm::mat4& m)
 {
 	m_modelTransform = m;
@@ -361,6 +390,12 @@ void Viewer::endFrame()
 	stream << std::fixed << std::setprecision(2) << ImGui::GetIO().Framerate << " fps";
 	std::string s = stream.str();
 
+	if (scene()->model()->isLoading())
+	{
+		ImGui::SameLine(ImGui::GetWindowWidth() - 480.0f);
+		ImGui::ProgressBar(scene()->model()->loadProgress(), ImVec2(240.0f, 0.0f), scene()->model()->loadStage().c_str());
+	}
+
 	//		ImGui::Begin("Information");
 	ImGui::SameLine(ImGui::GetWindowWidth() - 220.0f);
 	ImGui::PlotLines(s.c_str(), framerates, int(frameratesList.size()), 0, 0, 0.0f, 200.0f,ImVec2(128.0f,0.0f));
@@ -14,6 +14,8 @@
 
 namespace minity
 {
+	class GBuffer;
+
 	class Viewer
 	{
 	public:
@@ -24,6 +26,8 @@ namespace minity
 
 		GLFWwindow * window();
 		Scene* scene();
+		// shared between the renderers, which draw into it one after the other
+		GBuffer* gBuffer();
 
 		glm::ivec2 viewportSize() const;
 
@@ -36,6 +40,7 @@ namespace minity
 		void setBackgroundColor(const glm::vec3& c);
 		void setViewTransform(const glm::mat4& m);
 		void setModelTransform(const glm::mat4& m);
+		void fitModelTransform();
 		void setLightTransform(const glm::mat4& m);
 		void setProjectionTransform(const glm::mat4& m);
 
@@ -62,6 +67,7 @@ namespace minity
 
 		GLFWwindow* m_window;
 		Scene *m_scene;
+		std::unique_ptr<GBuffer> m_gBuffer;
 
 		std::vector<std::unique_ptr<Interactor>> m_interactors;
 		std::vector<std::unique_ptr<Renderer>> m_renderers;
@@ -1,4 +1,6 @@
 #include <iostream>
+#include <cstdlib>
+#include <algorithm>
 
 #include <glbinding/Version.h>
 #include <glbinding/Binding.h>
@@ -24,6 +26,7 @@
 #include "Scene.h"
 #include "Model.h"
 #include "Viewer.h"
+#include "TextureStreamer.h"
 #include "Interactor.h"
 #include "Renderer.h"
 
@@ -81,10 +84,50 @@ int main(int argc, char *argv[])
 		<< "OpenGL Renderer: " << glbinding::aux::ContextInfo::renderer() << std::endl;
 
 	std::string fileName = "./dat/bunny.obj";
+	bool fileNameSpecified = false;
+	LoadOptions loadOptions;
+	std::size_t textureBudget = 0;
 
-	if (argc > 1)
-		fileName = std::string(argv[1]);
-	else
+	for (int i = 1; i < argc; i++)
+	{
+		const std::string argument(argv[i]);
+
+		if (argument == "--stream-parser")
+			loadOptions.parser = ObjParser::Stream;
+		else if (argument == "--threads" && i + 1 < argc)
+			loadOptions.threadCount = std::max(0, std::atoi(argv[++i]));
+		else if (argument == "--no-cache")
+			loadOptions.cache = false;
+		else if (argument == "--cache-directory" && i + 1 < argc)
+			loadOptions.cacheDirectory = argv[++i];
+		else if (argument == "--synchronous")
+			loadOptions.background = false;
+		else if (argument == "--no-cpu-geometry")
+			loadOptions.keepGeometry = false;
+		else if (argument == "--compress-textures")
+			loadOptions.compressTextures = true;
+		else if (argument == "--no-optimize")
+			loadOptions.optimizeGeometry = false;
+		else if (argument == "--no-lod")
+			loadOptions.buildLevelsOfDetail = false;
+		else if (argument == "--no-bvh")
+			loadOptions.buildBvh = false;
+		else if (argument == "--full-vertices")
+			loadOptions.vertexFormat = VertexFormat::Full;
+		else if (argument == "--full-indices")
+			loadOptions.shortIndices = false;
+		else if (argument == "--eager-textures")
+			loadOptions.lazyTextures = false;
+		else if (argument == "--texture-budget" && i + 1 < argc)
+			textureBudget = std::size_t(std::max(0, std::atoi(argv[++i]))) * 1024 * 1024;
+		else
+		{
+			fileName = argument;
+			fileNameSpecified = true;
+		}
+	}
+
+	if (!fileNameSpecified)
 	{
 		const char *filterExtensions[] = { "*.obj" };
 		const char *openfileName = tinyfd_openFileDialog("Open File", "./", 1, filterExtensions, "Wavefront Files (*.obj)", 0);
@@ -95,15 +138,14 @@ int main(int argc, char *argv[])
 
 	{
 		auto scene = std::make_unique<Scene>();
-		scene->model()->load(fileName);
 		auto viewer = std::make_unique<Viewer>(window, scene.get());
 
-		// Scaling the model's bounding box to the canonical view volume
-		vec3 boundingBoxSize = scene->model()->maximumBounds() - scene->model()->minimumBounds();
-		float maximumSize = std::max( std::max(boundingBoxSize.x, boundingBoxSize.y), boundingBoxSize.z );
-		mat4 modelTransform =  scale(vec3(2.0f) / vec3(maximumSize)); 
-		modelTransform = modelTransform * translate(-0.5f*(scene->model()->minimumBounds() + scene->model()->maximumBounds()));
-		viewer->setModelTransform(modelTransform);
+		if (textureBudget > 0)
+			scene->textureStreamer()->setBudget(textureBudget);
+
+		// the model is loaded in the background and displayed while it arrives
+		scene->model()->load(fileName, loadOptions);
+		viewer->fitModelTransform();
 
 
 		glfwSwapInterval(0);